@@ -0,0 +1,153 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include "bench_util.h"
+#include "data_segment.h"
+#include "session_accept.h"
+#include "udp_session.h"
+
+namespace safe_udp {
+namespace {
+/** 发送的文件长度：稀疏文件，读出的全是 0 */
+constexpr int BENCH_FILE_SIZE = 64 * 1024 * 1024;
+/** 发送窗口（数据段个数） */
+constexpr int BENCH_WINDOW = 100;
+/** ACK 回显的时间戳比当前时间早的时长，作为 RTT 样本 */
+constexpr int64_t BENCH_RTT_NS = 50 * 1000;
+
+int64_t monotonicNanos() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/**
+ * 一个完成握手、正在发送的会话。数据发往本机一个不读取的 socket，
+ * 接收缓冲区满后内核直接丢弃，发送路径的开销与实际相同
+ */
+class AckBench {
+ public:
+  AckBench() {
+    sink_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&sink_address_, 0, sizeof(sink_address_));
+    sink_address_.sin_family = AF_INET;
+    sink_address_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd_, (struct sockaddr *)&sink_address_, sizeof(sink_address_));
+    socklen_t length = sizeof(sink_address_);
+    getsockname(sink_fd_, (struct sockaddr *)&sink_address_, &length);
+    send_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+
+    char path[] = "/tmp/safe_udp_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+      if (ftruncate(fd, BENCH_FILE_SIZE) < 0) {
+        LOG(ERROR) << "Failed to size " << path;
+      }
+      close(fd);
+      file_path_ = path;
+    }
+  }
+
+  ~AckBench() {
+    session_.reset();
+    if (!file_path_.empty()) {
+      unlink(file_path_.c_str());
+    }
+    close(send_fd_);
+    close(sink_fd_);
+  }
+
+  /** 建立新会话并完成握手，第一个窗口随即发出 */
+  bool Start() {
+    SessionConfig config;
+    config.rwnd = BENCH_WINDOW;
+    SessionAccept accept;
+    accept.connectionId = 1;
+    accept.window = BENCH_WINDOW;
+    session_ = std::make_unique<UdpSession>(send_fd_, sink_address_, config,
+                                            accept);
+    if (file_path_.empty() || !session_->OpenFile(file_path_)) {
+      return false;
+    }
+    session_->SendAccept();
+    acked_ = 0;
+    Ack(0);
+    return session_->IsEstablished();
+  }
+
+  /** 客户端的一个累积 ACK：确认到第 acked 个数据段（不含）为止 */
+  void Ack(int acked) {
+    DataSegment ack_segment;
+    ack_segment.connectionId = 1;
+    ack_segment.ackFlag = true;
+    ack_segment.ackNum = acked * MAX_DATA_SIZE;
+    ack_segment.finflag = false;
+    ack_segment.seqNumber = 0;
+    ack_segment.dataLength = 0;
+    ack_segment.timestamp = monotonicNanos() - BENCH_RTT_NS;
+    unsigned char datagram[MAX_PACKET_SIZE];
+    int length = ack_segment.SerializeTo(reinterpret_cast<char *>(datagram));
+    session_->OnAck(datagram, length, sink_address_);
+    session_->OnAckBatchEnd();
+  }
+
+  /** 还能再确认 count 个数据段 */
+  bool CanAck(int count) const {
+    return (int64_t)(acked_ + count) * MAX_DATA_SIZE < BENCH_FILE_SIZE;
+  }
+
+  int acked_ = 0;
+
+ private:
+  int sink_fd_;
+  int send_fd_;
+  struct sockaddr_in sink_address_;
+  std::string file_path_;
+  std::unique_ptr<UdpSession> session_;
+};
+}  // namespace
+
+/**
+ * 服务器的 ACK 处理（UdpSession::OnAck 和 OnAckBatchEnd）：解析 ACK、
+ * RTT 估计、滑动窗口和拥塞窗口更新，以及随后发出的新数据段。
+ * 参数为每个 ACK 确认的数据段数，客户端默认每两个数据段确认一次
+ */
+static void BM_SessionAck(benchmark::State &state) {
+  int segments_per_ack = state.range(0);
+  AckBench bench;
+  if (!bench.Start()) {
+    state.SkipWithError("Failed to start the session");
+    return;
+  }
+
+  int64_t allocations = AllocationCount();
+  int64_t setup_allocations = 0;
+  for (auto _ : state) {
+    /** 文件发送完之后重新建立会话，不计入时间和内存分配次数 */
+    if (!bench.CanAck(segments_per_ack)) {
+      state.PauseTiming();
+      int64_t before = AllocationCount();
+      bench.Start();
+      setup_allocations += AllocationCount() - before;
+      state.ResumeTiming();
+    }
+    bench.acked_ += segments_per_ack;
+    bench.Ack(bench.acked_);
+  }
+  ReportAllocations(state, AllocationCount() - allocations - setup_allocations);
+  state.SetItemsProcessed(state.iterations() * segments_per_ack);
+}
+BENCHMARK(BM_SessionAck)->Arg(1)->Arg(2);
+}  // namespace safe_udp
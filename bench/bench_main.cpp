@@ -0,0 +1,43 @@
+#include <string.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+
+#include "bench_util.h"
+
+namespace safe_udp {
+void ReportAllocations(benchmark::State &state, int64_t allocations) {
+  state.counters["allocs/op"] = benchmark::Counter(
+      (double)allocations, benchmark::Counter::kAvgIterations);
+}
+}  // namespace safe_udp
+
+/**
+ * 默认以 JSON 输出（供 CI 按提交记录 ns/op 和 allocs/op），
+ * 命令行给出 --benchmark_format 时以命令行为准。
+ * 传输路径中的 INFO 日志照常生成，只是不输出，与服务器的实际开销一致
+ */
+int main(int argc, char *argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_minloglevel = google::GLOG_ERROR;
+
+  static char json_format[] = "--benchmark_format=json";
+  std::vector<char *> args(argv, argv + argc);
+  bool has_format = false;
+  for (int i = 1; i < argc; i++) {
+    has_format |= strncmp(argv[i], "--benchmark_format", 18) == 0;
+  }
+  if (!has_format) {
+    args.insert(args.begin() + 1, json_format);
+  }
+
+  int count = (int)args.size();
+  benchmark::Initialize(&count, args.data());
+  if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
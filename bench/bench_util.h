@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.h"
+
+namespace safe_udp {
+/**
+ * 把计时循环内的内存分配次数报告为 allocs/op（按迭代次数平均）。
+ * 分配次数是计时循环前后两次 AllocationCount 之差，包括 malloc 和 calloc
+ * @param state 基准测试状态
+ * @param allocations 计时循环内的内存分配次数
+ */
+void ReportAllocations(benchmark::State &state, int64_t allocations);
+}  // namespace safe_udp
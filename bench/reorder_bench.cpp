@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_util.h"
+#include "data_segment.h"
+#include "reorder_buffer.h"
+
+namespace safe_udp {
+/** 按序到达：插入后立即移出，客户端无丢包时的路径 */
+static void BM_ReorderBufferInOrder(benchmark::State &state) {
+  ReorderBuffer buffer(state.range(0));
+  int index = 0;
+  int length;
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    buffer.Insert(index++, MAX_DATA_SIZE);
+    while (buffer.PopInOrder(&length)) {
+    }
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_ReorderBufferInOrder)->Arg(128)->Arg(4096);
+
+/**
+ * 窗口的第一个数据段丢失：其余数据段乱序到达，重传填补空洞后一次移出整个窗口。
+ * 每次迭代是一个窗口，其间每收到一个数据段生成一次 SACK 区间
+ */
+static void BM_ReorderBufferHoleFill(benchmark::State &state) {
+  int window = state.range(0);
+  ReorderBuffer buffer(window);
+  SegmentRange ranges[MAX_SACK_BLOCKS];
+  int base = 0;
+  int length;
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    for (int i = 1; i < window; i++) {
+      buffer.Insert(base + i, MAX_DATA_SIZE);
+      benchmark::DoNotOptimize(
+          buffer.ReceivedRanges(base + i, ranges, MAX_SACK_BLOCKS));
+    }
+    buffer.Insert(base, MAX_DATA_SIZE);
+    while (buffer.PopInOrder(&length)) {
+    }
+    base += window;
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+  state.SetItemsProcessed(state.iterations() * window);
+}
+BENCHMARK(BM_ReorderBufferHoleFill)->Arg(128)->Arg(1024);
+}  // namespace safe_udp
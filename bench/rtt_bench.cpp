@@ -0,0 +1,21 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_util.h"
+#include "rtt_estimator.h"
+
+namespace safe_udp {
+/** 每个 ACK 一个 RTT 样本，样本在 100~164 微秒之间抖动 */
+static void BM_RttEstimatorSample(benchmark::State &state) {
+  RttEstimator estimator;
+  int64_t rtt_ns = 100 * 1000;
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    estimator.OnSample(rtt_ns, 32);
+    benchmark::DoNotOptimize(estimator.rto());
+    rtt_ns = 100 * 1000 + (rtt_ns * 31 + 17) % (64 * 1000);
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_RttEstimatorSample);
+}  // namespace safe_udp
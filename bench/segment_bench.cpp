@@ -0,0 +1,123 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_util.h"
+#include "data_segment.h"
+
+namespace safe_udp {
+namespace {
+/** 满载数据段的载荷，内容固定 */
+std::vector<char> makePayload() {
+  std::vector<char> payload(MAX_DATA_SIZE);
+  for (int i = 0; i < MAX_DATA_SIZE; i++) {
+    payload[i] = (char)(i * 131 + 7);
+  }
+  return payload;
+}
+
+void fillDataSegment(const std::vector<char> &payload, DataSegment *segment) {
+  segment->connectionId = 0x12345678;
+  segment->seqNumber = 1000;
+  segment->ackNum = 0;
+  segment->ackFlag = false;
+  segment->finflag = false;
+  segment->dataLength = MAX_DATA_SIZE;
+  segment->timestamp = 123456789;
+  segment->data_ = payload.data();
+}
+
+/** 带 MAX_SACK_BLOCKS 个 SACK 块的 ACK，与客户端发送的一致 */
+int serializeAck(char *buffer) {
+  char sack_payload[MAX_SACK_BLOCKS * SACK_BLOCK_LENGTH];
+  for (int i = 0; i < MAX_SACK_BLOCKS; i++) {
+    SackBlock block;
+    block.start = 1000 + (2 * i + 1) * MAX_DATA_SIZE;
+    block.end = block.start + MAX_DATA_SIZE;
+    block.SerializeTo(sack_payload + i * SACK_BLOCK_LENGTH);
+  }
+  DataSegment ack_segment;
+  ack_segment.connectionId = 0x12345678;
+  ack_segment.ackFlag = true;
+  ack_segment.ackNum = 1000;
+  ack_segment.finflag = false;
+  ack_segment.seqNumber = 0;
+  ack_segment.dataLength = sizeof(sack_payload);
+  ack_segment.timestamp = 123456789;
+  ack_segment.data_ = sack_payload;
+  return ack_segment.SerializeTo(buffer);
+}
+}  // namespace
+
+/** 发送路径：头部和载荷序列化到调用方的缓冲区（含整个数据报的 CRC32C） */
+static void BM_DataSegmentSerializeTo(benchmark::State &state) {
+  std::vector<char> payload = makePayload();
+  DataSegment segment;
+  fillDataSegment(payload, &segment);
+  char buffer[MAX_PACKET_SIZE];
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(segment.SerializeTo(buffer));
+    benchmark::ClobberMemory();
+    segment.seqNumber += MAX_DATA_SIZE;
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+  state.SetBytesProcessed(state.iterations() * MAX_PACKET_SIZE);
+}
+BENCHMARK(BM_DataSegmentSerializeTo);
+
+/** 每个数据段一个对象，序列化到缓冲池中的缓冲区，析构时归还 */
+static void BM_DataSegmentSerializeToCharArray(benchmark::State &state) {
+  std::vector<char> payload = makePayload();
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    DataSegment segment;
+    fillDataSegment(payload, &segment);
+    benchmark::DoNotOptimize(segment.SerializeToCharArray());
+    benchmark::ClobberMemory();
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+  state.SetBytesProcessed(state.iterations() * MAX_PACKET_SIZE);
+}
+BENCHMARK(BM_DataSegmentSerializeToCharArray);
+
+/** 接收路径：校验版本、长度和 CRC32C，载荷指向接收缓冲区 */
+static void BM_DataSegmentDeserialize(benchmark::State &state) {
+  std::vector<char> payload = makePayload();
+  DataSegment source;
+  fillDataSegment(payload, &source);
+  unsigned char datagram[MAX_PACKET_SIZE];
+  int length = source.SerializeTo(reinterpret_cast<char *>(datagram));
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    DataSegment segment;
+    benchmark::DoNotOptimize(segment.DeserializeToDataSegment(datagram, length));
+    benchmark::DoNotOptimize(segment.data_);
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_DataSegmentDeserialize);
+
+/** 服务器收到的 ACK：反序列化并取出全部 SACK 块 */
+static void BM_DataSegmentDeserializeAck(benchmark::State &state) {
+  unsigned char datagram[MAX_PACKET_SIZE];
+  int length = serializeAck(reinterpret_cast<char *>(datagram));
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    DataSegment segment;
+    benchmark::DoNotOptimize(segment.DeserializeToDataSegment(datagram, length));
+    int sack_count = segment.dataLength / SACK_BLOCK_LENGTH;
+    for (int i = 0; i < sack_count; i++) {
+      benchmark::DoNotOptimize(
+          SackBlock::Parse(segment.data_ + i * SACK_BLOCK_LENGTH));
+    }
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_DataSegmentDeserializeAck);
+}  // namespace safe_udp
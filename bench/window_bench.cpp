@@ -0,0 +1,73 @@
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_util.h"
+#include "sliding_window.h"
+
+namespace safe_udp {
+namespace {
+/** 发送满一个窗口：与 UdpSession 一样先 AddToBuffer，再推进 lastSendPacketSeq */
+void fillWindow(SlidingWindow *window, int count) {
+  for (int i = 0; i < count; i++) {
+    window->lastSendPacketSeq = window->AddToBuffer(i * MAX_DATA_SIZE,
+                                                    MAX_DATA_SIZE);
+  }
+}
+}  // namespace
+
+/** 记录新发送的数据段；窗口满时确认最早的一个，保持窗口始终满载 */
+static void BM_SlidingWindowAdd(benchmark::State &state) {
+  int window_size = state.range(0);
+  SlidingWindow window(0, window_size);
+  int seq_number = 0;
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    if (window.IsFull()) {
+      window.lastAckedPacketSeq++;
+    }
+    window.lastSendPacketSeq = window.AddToBuffer(seq_number, MAX_DATA_SIZE);
+    seq_number += MAX_DATA_SIZE;
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_SlidingWindowAdd)->Arg(128)->Arg(4096);
+
+/** 按序列号查找在途数据段（重传和 SACK 处理的查找） */
+static void BM_SlidingWindowFind(benchmark::State &state) {
+  int window_size = state.range(0);
+  SlidingWindow window(0, window_size);
+  fillWindow(&window, window_size);
+  /** 固定步长遍历整个窗口，避免总是命中同一个槽位 */
+  int stride = 7 * MAX_DATA_SIZE;
+  int span = window_size * MAX_DATA_SIZE;
+  int seq_number = 0;
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(window.Find(seq_number));
+    seq_number = (seq_number + stride) % span;
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_SlidingWindowFind)->Arg(128)->Arg(4096);
+
+/** 一个 ACK 中的全部 SACK 块：每隔一个数据段收到一个 */
+static void BM_SlidingWindowMarkSacked(benchmark::State &state) {
+  int window_size = state.range(0);
+  SlidingWindow window(0, window_size);
+  fillWindow(&window, window_size);
+
+  int64_t allocations = AllocationCount();
+  for (auto _ : state) {
+    for (int i = 0; i < MAX_SACK_BLOCKS; i++) {
+      int start = (2 * i + 1) * MAX_DATA_SIZE;
+      window.MarkSacked(start, start + MAX_DATA_SIZE);
+    }
+    benchmark::ClobberMemory();
+  }
+  ReportAllocations(state, AllocationCount() - allocations);
+}
+BENCHMARK(BM_SlidingWindowMarkSacked)->Arg(128)->Arg(4096);
+}  // namespace safe_udp
@@ -0,0 +1,65 @@
+#!/bin/bash
+# 文件块缓存测试：启动一个服务器，依次多次下载同一个文件，
+# 输出每次下载的耗时、读盘次数和读盘字节数（取自服务器日志的 Chunk cache 一行）。
+# 第一次下载之后文件已在缓存中，读盘应降为 0。命中率是服务器启动以来的累计值。
+# 需要先编译，在 build/bin 目录（或 BIN_DIR 指定的目录）中运行 server 和 client。
+
+if [ "$#" -lt 1 ]; then
+    echo "Usage: $0 <file> [runs]"
+    echo "Example: $0 big.bin 5"
+    echo "Environment: BIN_DIR, PORT, WINDOW, SERVER_ARGS, CLIENT_ARGS"
+    exit 1
+fi
+
+file=$1
+runs=${2:-5}
+
+bin_dir=${BIN_DIR:-$(pwd)}
+port=${PORT:-8080}
+window=${WINDOW:-100}
+server_file="/work/files/server_files/$file"
+client_file="/work/files/client_files/$file"
+server_log=$(mktemp)
+
+if [ ! -f "$server_file" ]; then
+    echo "Error: File $server_file does not exist."
+    exit 1
+fi
+
+"$bin_dir/server" $SERVER_ARGS "$port" "$window" 2>"$server_log" &
+server_pid=$!
+sleep 0.5
+
+printf "%-6s %-10s %-12s %-12s %-10s %s\n" run seconds "disk reads" "disk MB" "hit rate" result
+last_reads=0
+last_bytes=0
+for run in $(seq 1 "$runs"); do
+    rm -f "$client_file"
+    start=$(date +%s.%N)
+    "$bin_dir/client" $CLIENT_ARGS localhost "$port" "$file" "$window" 0 0 2>/dev/null
+    end=$(date +%s.%N)
+    sleep 0.2
+    if cmp -s "$client_file" "$server_file"; then
+        result="OK"
+    else
+        result="FAILED"
+    fi
+
+    # 统计是服务器启动以来的累计值，相减得到本次下载的读盘量
+    line=$(grep -a "Chunk cache" "$server_log" | tail -n 1)
+    reads=$(echo "$line" | sed -n 's/.*disk reads: \([0-9]*\).*/\1/p')
+    bytes=$(echo "$line" | sed -n 's/.*disk MB: \([0-9.e+-]*\).*/\1/p')
+    rate=$(echo "$line" | sed -n 's/.*hit rate: \([0-9.e+-]*\)%.*/\1/p')
+    awk -v r="$run" -v s="$start" -v e="$end" -v reads="${reads:-0}" \
+        -v last_reads="$last_reads" -v bytes="${bytes:-0}" \
+        -v last_bytes="$last_bytes" -v rate="${rate:-0}" -v res="$result" 'BEGIN {
+            printf "%-6d %-10.3f %-12d %-12.1f %-10s %s\n", r, e - s,
+                reads - last_reads, bytes - last_bytes, rate "%", res
+        }'
+    last_reads=${reads:-0}
+    last_bytes=${bytes:-0}
+done
+
+kill "$server_pid"
+wait "$server_pid" 2>/dev/null
+rm -f "$server_log"
@@ -0,0 +1,66 @@
+#!/bin/bash
+# 服务器工作线程数扩展性测试：对每个工作线程数启动服务器，
+# 同时运行多个客户端下载同一个文件，输出总的有效吞吐量（goodput）。
+# 需要先编译，在 build/bin 目录（或 BIN_DIR 指定的目录）中运行 server 和 client。
+
+if [ "$#" -lt 2 ]; then
+    echo "Usage: $0 <file> <clients> [workers...]"
+    echo "Example: $0 big.bin 32 1 2 4 8"
+    echo "Environment: BIN_DIR, PORT, WINDOW, SERVER_ARGS, CLIENT_ARGS"
+    exit 1
+fi
+
+file=$1
+clients=$2
+shift 2
+worker_counts=${@:-1 2 4}
+
+bin_dir=${BIN_DIR:-$(pwd)}
+port=${PORT:-8080}
+window=${WINDOW:-100}
+server_file="/work/files/server_files/$file"
+client_file="/work/files/client_files/$file"
+
+if [ ! -f "$server_file" ]; then
+    echo "Error: File $server_file does not exist."
+    exit 1
+fi
+file_size=$(stat -c %s "$server_file")
+
+printf "%-8s %-8s %-10s %-12s %s\n" workers clients seconds "goodput MB/s" result
+for workers in $worker_counts; do
+    "$bin_dir/server" --workers "$workers" --pin $SERVER_ARGS "$port" "$window" \
+        2>/dev/null &
+    server_pid=$!
+    sleep 0.5
+
+    rm -f "$client_file"
+    start=$(date +%s.%N)
+    client_pids=()
+    for i in $(seq 1 "$clients"); do
+        "$bin_dir/client" $CLIENT_ARGS localhost "$port" "$file" "$window" 0 0 \
+            2>/dev/null &
+        client_pids+=($!)
+    done
+    failed=0
+    for pid in "${client_pids[@]}"; do
+        wait "$pid" || failed=$((failed + 1))
+    done
+    end=$(date +%s.%N)
+
+    kill "$server_pid"
+    wait "$server_pid" 2>/dev/null
+
+    # 所有客户端写同一个文件，内容一致，最后比较一次即可
+    if [ "$failed" -eq 0 ] && cmp -s "$client_file" "$server_file"; then
+        result="OK"
+    else
+        result="FAILED"
+    fi
+    awk -v w="$workers" -v c="$clients" -v s="$start" -v e="$end" \
+        -v size="$file_size" -v r="$result" 'BEGIN {
+            t = e - s
+            printf "%-8d %-8d %-10.3f %-12.1f %s\n", w, c, t,
+                c * size / t / 1048576, r
+        }'
+done
@@ -0,0 +1,64 @@
+#include "alloc_counter.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <atomic>
+
+/** glibc 内部的分配函数，替换后的函数计数后转给它们 */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+/** 分配次数，静态初始化（常量初始化）早于任何分配 */
+static std::atomic<int64_t> allocation_count(0);
+
+static void countAllocation() {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" {
+void *malloc(size_t size) {
+  countAllocation();
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+  countAllocation();
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+  countAllocation();
+  return __libc_realloc(pointer, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+  countAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  countAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) {
+  countAllocation();
+  void *result = __libc_memalign(alignment, size);
+  if (result == nullptr) {
+    return ENOMEM;
+  }
+  *pointer = result;
+  return 0;
+}
+}
+
+namespace safe_udp {
+int64_t AllocationCount() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+}  // namespace safe_udp
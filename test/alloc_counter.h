@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/**
+ * 进程启动以来 malloc、calloc、realloc 和对齐分配函数的调用次数。
+ * alloc_counter.cpp 在可执行文件中替换了这些函数，共享库（包括 libstdc++ 的
+ * operator new）中的调用同样被计入。在被测代码前后各读一次，相减得到其间的
+ * 内存分配次数；计数对所有线程有效，测量期间其他线程不能分配内存
+ */
+int64_t AllocationCount();
+}  // namespace safe_udp
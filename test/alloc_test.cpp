@@ -0,0 +1,317 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include "alloc_counter.h"
+#include "data_segment.h"
+#include "file_request.h"
+#include "session_accept.h"
+#include "udp_client.h"
+#include "udp_session.h"
+
+/**
+ * 稳态路径的内存分配测试：数据段的序列化和反序列化、客户端收包并发送 ACK、
+ * 服务器处理 ACK（UdpSession::OnAck 和 OnAckBatchEnd）在预热之后都不能分配内存。
+ * 计数包括 malloc、calloc 和 realloc，任何一项分配次数不为 0 时以非 0 退出
+ */
+namespace safe_udp {
+namespace {
+/** 每项测量的迭代次数 */
+constexpr int TEST_ITERATIONS = 1000;
+/** 客户端测试发送的数据段个数，前后各 TEST_WARMUP_SEGMENTS 个不计入测量 */
+constexpr int TEST_SEGMENTS = 2000;
+constexpr int TEST_WARMUP_SEGMENTS = 200;
+/** 客户端测试的接收窗口和发送窗口（数据段个数） */
+constexpr int TEST_WINDOW = 64;
+constexpr int TEST_IN_FLIGHT = 32;
+/** 测试服务器等待客户端数据报的期限 */
+constexpr int TEST_TIMEOUT_MS = 2000;
+/** 服务器测试发送的文件长度：稀疏文件，读出的全是 0 */
+constexpr int TEST_FILE_SIZE = 16 * 1024 * 1024;
+/** 服务器测试中 ACK 回显的时间戳比当前时间早的时长，作为 RTT 样本 */
+constexpr int64_t TEST_RTT_NS = 50 * 1000;
+/** 客户端测试中的连接 ID */
+constexpr int TEST_CONNECTION_ID = 7;
+
+int64_t monotonicNanos() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/** 绑定到本机回环地址任意端口的 UDP socket，address 输出实际地址 */
+int bindLoopback(struct sockaddr_in *address) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(address, 0, sizeof(*address));
+  address->sin_family = AF_INET;
+  address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, (struct sockaddr *)address, sizeof(*address));
+  socklen_t length = sizeof(*address);
+  getsockname(fd, (struct sockaddr *)address, &length);
+  return fd;
+}
+
+/** 满载数据段的载荷，内容固定 */
+char payload[MAX_DATA_SIZE];
+
+/** 报告一项测量的结果，有分配时返回 false */
+bool report(const char *name, int64_t allocations, int iterations) {
+  printf("%-28s %lld allocations in %d iterations\n", name,
+         (long long)allocations, iterations);
+  if (allocations != 0) {
+    LOG(ERROR) << name << " allocated " << allocations << " times !!!";
+    return false;
+  }
+  return true;
+}
+
+/** 发送路径：头部和载荷序列化到调用方的缓冲区 */
+bool testSerializeTo() {
+  DataSegment segment;
+  segment.connectionId = TEST_CONNECTION_ID;
+  segment.seqNumber = 0;
+  segment.ackNum = 0;
+  segment.ackFlag = false;
+  segment.finflag = false;
+  segment.dataLength = MAX_DATA_SIZE;
+  segment.timestamp = monotonicNanos();
+  segment.data_ = payload;
+  char buffer[MAX_PACKET_SIZE];
+  segment.SerializeTo(buffer);
+
+  int64_t allocations = AllocationCount();
+  for (int i = 0; i < TEST_ITERATIONS; i++) {
+    segment.seqNumber += MAX_DATA_SIZE;
+    segment.SerializeTo(buffer);
+  }
+  return report("DataSegment::SerializeTo", AllocationCount() - allocations,
+                TEST_ITERATIONS);
+}
+
+/** 接收路径：校验版本、长度和 CRC32C，载荷指向接收缓冲区 */
+bool testDeserialize() {
+  DataSegment source;
+  source.connectionId = TEST_CONNECTION_ID;
+  source.seqNumber = 0;
+  source.ackNum = 0;
+  source.ackFlag = false;
+  source.finflag = false;
+  source.dataLength = MAX_DATA_SIZE;
+  source.timestamp = monotonicNanos();
+  source.data_ = payload;
+  unsigned char datagram[MAX_PACKET_SIZE];
+  int length = source.SerializeTo(reinterpret_cast<char *>(datagram));
+
+  int64_t allocations = AllocationCount();
+  bool valid = true;
+  for (int i = 0; i < TEST_ITERATIONS; i++) {
+    DataSegment segment;
+    valid &= segment.DeserializeToDataSegment(datagram, length);
+  }
+  if (!valid) {
+    LOG(ERROR) << "Failed to deserialize the test segment !!!";
+    return false;
+  }
+  return report("DeserializeToDataSegment", AllocationCount() - allocations,
+                TEST_ITERATIONS);
+}
+
+/**
+ * 服务器一侧的 ACK 处理：一个完成握手、正在发送的会话，数据发往本机一个
+ * 不读取的 socket，接收缓冲区满后内核直接丢弃
+ */
+bool testSessionAck() {
+  struct sockaddr_in sink_address;
+  int sink_fd = bindLoopback(&sink_address);
+  int send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  char path[] = "/tmp/safe_udp_alloc_test_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 || ftruncate(fd, TEST_FILE_SIZE) < 0) {
+    LOG(ERROR) << "Failed to create " << path << " !!!";
+    return false;
+  }
+  close(fd);
+
+  SessionConfig config;
+  config.rwnd = TEST_WINDOW;
+  SessionAccept accept;
+  accept.connectionId = 1;
+  accept.window = TEST_WINDOW;
+  auto session =
+      std::make_unique<UdpSession>(send_fd, sink_address, config, accept);
+  bool opened = session->OpenFile(path);
+  unlink(path);
+  if (!opened) {
+    LOG(ERROR) << "Failed to open " << path << " !!!";
+    return false;
+  }
+  session->SendAccept();
+
+  /** 每个 ACK 确认两个数据段，与客户端的默认确认策略一致 */
+  auto ack = [&](int acked) {
+    DataSegment ack_segment;
+    ack_segment.connectionId = 1;
+    ack_segment.ackFlag = true;
+    ack_segment.ackNum = acked * MAX_DATA_SIZE;
+    ack_segment.finflag = false;
+    ack_segment.seqNumber = 0;
+    ack_segment.dataLength = 0;
+    ack_segment.timestamp = monotonicNanos() - TEST_RTT_NS;
+    unsigned char datagram[MAX_PACKET_SIZE];
+    int length = ack_segment.SerializeTo(reinterpret_cast<char *>(datagram));
+    session->OnAck(datagram, length, sink_address);
+    session->OnAckBatchEnd();
+  };
+  int acked = 0;
+  ack(acked);
+  for (int i = 0; i < TEST_WARMUP_SEGMENTS / 2; i++) {
+    acked += 2;
+    ack(acked);
+  }
+  bool established = session->IsEstablished();
+
+  int64_t allocations = AllocationCount();
+  for (int i = 0; i < TEST_ITERATIONS; i++) {
+    acked += 2;
+    ack(acked);
+  }
+  allocations = AllocationCount() - allocations;
+
+  session.reset();
+  close(send_fd);
+  close(sink_fd);
+  if (!established) {
+    LOG(ERROR) << "The test session was not established !!!";
+    return false;
+  }
+  return report("UdpSession::OnAck", allocations, TEST_ITERATIONS);
+}
+
+/**
+ * 客户端的接收和 ACK 路径：真实的 UdpClient 从本线程扮演的服务器接收
+ * TEST_SEGMENTS 个按序数据段。服务器一侧只用栈上的缓冲区，
+ * 预热之后到结束之前的分配都来自客户端。
+ * 客户端目录不存在时数据段不写入文件，接收和 ACK 路径不受影响，
+ * 所以只要求服务器一侧收到了全部确认
+ */
+bool testClientAck() {
+  struct sockaddr_in server_address;
+  int server_fd = bindLoopback(&server_address);
+  UdpClient client;
+  client.receiverWindow = TEST_WINDOW;
+  client.CreateSocketAndServerConnection(
+      "127.0.0.1", std::to_string(ntohs(server_address.sin_port)));
+  std::string file_name = "safe_udp_alloc_test";
+  std::thread client_thread([&] { client.SendFileRequest(file_name); });
+
+  char buffer[MAX_PACKET_SIZE];
+  struct sockaddr_in client_address;
+  /** 等待下一个数据报，返回长度，超时返回 -1 */
+  auto receive = [&]() {
+    struct pollfd pfd = {server_fd, POLLIN, 0};
+    if (poll(&pfd, 1, TEST_TIMEOUT_MS) <= 0) {
+      return -1;
+    }
+    socklen_t length = sizeof(client_address);
+    return (int)recvfrom(server_fd, buffer, sizeof(buffer), 0,
+                         (struct sockaddr *)&client_address, &length);
+  };
+  auto send = [&](const DataSegment &segment) {
+    char datagram[MAX_PACKET_SIZE];
+    int length = segment.SerializeTo(datagram);
+    sendto(server_fd, datagram, length, 0, (struct sockaddr *)&client_address,
+           sizeof(client_address));
+  };
+
+  bool ok = false;
+  int64_t allocations = 0;
+  FileRequest request;
+  int n = receive();
+  if (n > 0 && FileRequest::Parse(buffer, n, &request)) {
+    SessionAccept accept;
+    accept.connectionId = TEST_CONNECTION_ID;
+    accept.initialSeqNumber = 0;
+    accept.clientToken = request.clientToken;
+    accept.window = TEST_WINDOW;
+    accept.maxSegmentSize = MAX_DATA_SIZE;
+    char accept_payload[SESSION_ACCEPT_LENGTH];
+    DataSegment accept_segment;
+    accept.ToSegment(accept_payload, &accept_segment);
+    accept_segment.timestamp = monotonicNanos();
+    send(accept_segment);
+    ok = receive() > 0;
+  }
+
+  /** 每次补满 TEST_IN_FLIGHT 个未确认的数据段，再等客户端的下一个 ACK */
+  int next = 0;
+  int acked = 0;
+  int64_t start_count = -1;
+  bool measured = false;
+  while (ok && acked < TEST_SEGMENTS) {
+    while (next < TEST_SEGMENTS && next < acked + TEST_IN_FLIGHT) {
+      DataSegment segment;
+      segment.connectionId = TEST_CONNECTION_ID;
+      segment.seqNumber = next * MAX_DATA_SIZE;
+      segment.ackNum = 0;
+      segment.ackFlag = false;
+      segment.finflag = next == TEST_SEGMENTS - 1;
+      segment.dataLength = MAX_DATA_SIZE;
+      segment.timestamp = monotonicNanos();
+      segment.data_ = payload;
+      send(segment);
+      next++;
+    }
+    DataSegment ack_segment;
+    n = receive();
+    if (n <= 0) {
+      LOG(ERROR) << "No ACK from the client !!!";
+      ok = false;
+    } else if (ack_segment.DeserializeToDataSegment(
+                   reinterpret_cast<unsigned char *>(buffer), n) &&
+               ack_segment.ackFlag) {
+      acked = ack_segment.ackNum / MAX_DATA_SIZE;
+    }
+    if (start_count < 0 && acked >= TEST_WARMUP_SEGMENTS) {
+      start_count = AllocationCount();
+    }
+    if (!measured && acked >= TEST_SEGMENTS - TEST_WARMUP_SEGMENTS) {
+      allocations = AllocationCount() - start_count;
+      measured = true;
+    }
+  }
+
+  client_thread.join();
+  close(server_fd);
+  unlink((std::string(CLIENT_FILE_PATH) + file_name).c_str());
+  if (!ok) {
+    LOG(ERROR) << "The test transfer did not complete !!!";
+    return false;
+  }
+  return report("UdpClient receive and ACK", allocations,
+                TEST_SEGMENTS - 2 * TEST_WARMUP_SEGMENTS);
+}
+}  // namespace
+}  // namespace safe_udp
+
+int main(int /*argc*/, char *argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_minloglevel = google::GLOG_ERROR;
+
+  bool ok = safe_udp::testSerializeTo();
+  ok &= safe_udp::testDeserialize();
+  ok &= safe_udp::testSessionAck();
+  ok &= safe_udp::testClientAck();
+  return ok ? 0 : 1;
+}
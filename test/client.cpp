@@ -1,4 +1,5 @@
 #pragma once
+#include <getopt.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <stdlib.h>
@@ -6,20 +7,85 @@
 #include <sys/types.h>
 #include <iostream>
 #include <glog/logging.h>
+#include "multi_flow_client.h"
 #include "udp_client.h"
 
+static void usage() {
+  LOG(ERROR) << "Please provide format: [--batch-size N] [--gro] "
+                "[--ack-every N] [--ack-delay US] [--flows N] [--resume] "
+                "[--compress none|zlib|lz4|zstd] [--bundle] <server-ip> "
+                "<server-port> <file-name[,file-name...]> <receiver-window> "
+                "<control-param> <drop/delay%>";
+}
+
 int main(int argc, char *argv[]) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_logtostderr = true;
   FLAGS_minloglevel = google::GLOG_INFO;
   LOG(INFO) << "Starting the client !!!";
-  if (argc != 7) {
-    LOG(ERROR) << "Please provide format: <server-ip> <server-port> "
-                  "<file-name> <receiver-window> <control-param> <drop/delay%>";
+
+  safe_udp::UdpClient *udp_client = new safe_udp::UdpClient();
+
+  /** 可选参数 */
+  static struct option long_options[] = {
+      {"batch-size", required_argument, NULL, 'b'},
+      {"gro", no_argument, NULL, 'g'},
+      {"ack-every", required_argument, NULL, 'a'},
+      {"ack-delay", required_argument, NULL, 'd'},
+      {"flows", required_argument, NULL, 'f'},
+      {"resume", no_argument, NULL, 'r'},
+      {"compress", required_argument, NULL, 'c'},
+      {"bundle", no_argument, NULL, 'm'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  int flows = 1;
+  bool resume = false;
+  while ((opt = getopt_long(argc, argv, "b:ga:d:f:rc:m", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+      case 'b':
+        udp_client->batchSize = atoi(optarg);
+        break;
+      case 'g':
+        udp_client->isGro = true;
+        break;
+      case 'a':
+        udp_client->ackEvery = atoi(optarg);
+        break;
+      case 'd':
+        udp_client->ackDelayUs = atoi(optarg);
+        break;
+      case 'f':
+        flows = atoi(optarg);
+        break;
+      case 'r':
+        resume = true;
+        break;
+      case 'c':
+        if (!safe_udp::BlockCodec::Parse(optarg, &udp_client->compression)) {
+          usage();
+          exit(1);
+        }
+        break;
+      case 'm':
+        udp_client->bundle = true;
+        break;
+      default:
+        usage();
+        exit(1);
+    }
+  }
+  if (argc - optind != 6) {
+    usage();
+    exit(1);
+  }
+  /** 多文件请求由一个会话连续发送，不拆分成多个流，也不支持续传 */
+  if (udp_client->bundle && (flows > 1 || resume)) {
+    LOG(ERROR) << "--bundle cannot be combined with --flows or --resume";
     exit(1);
   }
+  argv += optind - 1;
 
-  safe_udp::UdpClient *udp_client = new safe_udp::UdpClient();
   std::string server_ip(argv[1]);
   std::string port_num(argv[2]);
   std::string file_name(argv[3]);
@@ -39,17 +105,44 @@ int main(int argc, char *argv[]) {
   } else if (control_param == 3) {
     udp_client->isPacketDrop = true;
     udp_client->isDelay = true;
+  } else if (control_param == 4) {
+    udp_client->isPacketDrop = false;
+    udp_client->isDelay = false;
+    udp_client->isCorrupt = true;
   } else {
-    LOG(ERROR) << "Invalid argument, should be range in 0-3 !!!";
+    LOG(ERROR) << "Invalid argument, should be range in 0-4 !!!";
     return 0;
   }
 
   int drop_percentage = atoi(argv[6]);
   udp_client->probValue = drop_percentage;
 
+  /**
+   * 多个流或续传时由 MultiFlowClient 分配范围，
+   * 每个流使用与 udp_client 相同的选项
+   */
+  if (flows > 1 || resume) {
+    safe_udp::MultiFlowClient multi_flow_client(server_ip, port_num, flows);
+    auto configure = [udp_client](safe_udp::UdpClient *c) {
+      c->receiverWindow = udp_client->receiverWindow;
+      c->isPacketDrop = udp_client->isPacketDrop;
+      c->isDelay = udp_client->isDelay;
+      c->isCorrupt = udp_client->isCorrupt;
+      c->probValue = udp_client->probValue;
+      c->batchSize = udp_client->batchSize;
+      c->isGro = udp_client->isGro;
+      c->ackEvery = udp_client->ackEvery;
+      c->ackDelayUs = udp_client->ackDelayUs;
+      c->compression = udp_client->compression;
+    };
+    bool ok = multi_flow_client.Download(file_name, configure, resume);
+    delete udp_client;
+    return ok ? 0 : 1;
+  }
+
   udp_client->CreateSocketAndServerConnection(server_ip, port_num);
-  udp_client->SendFileRequest(file_name);
+  bool ok = udp_client->SendFileRequest(file_name);
 
-  free(udp_client);
-  return 0;
+  delete udp_client;
+  return ok ? 0 : 1;
 }
\ No newline at end of file
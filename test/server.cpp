@@ -1,53 +1,166 @@
+#include <getopt.h>
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include <glog/logging.h>
 
+#include "chunk_cache.h"
 #include "udp_server.h"
 
 constexpr char SERVER_FILE_PATH[] = "/work/files/server_files/";
+/** 文件块缓存的默认内存预算（MB） */
+constexpr int DEFAULT_CACHE_MB = 256;
+
+static void usage() {
+  LOG(ERROR) << "Please provide format: [--batch-size N] [--gso] "
+                "[--cc reno|cubic|bbr] [--pacing] [--fec K] [--workers N] [--pin] [--steer-cpu] "
+                "[--cache-mb N] "
+                "<server-port> <receiver-window>";
+}
 
 int main(int argc, char *argv[]) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_logtostderr = true;
   FLAGS_minloglevel = google::GLOG_INFO;
 
-  int sfd = 0;
+  safe_udp::UdpServer *udp_server = new safe_udp::UdpServer();
+
+  /** 可选参数 */
+  static struct option long_options[] = {
+      {"batch-size", required_argument, NULL, 'b'},
+      {"gso", no_argument, NULL, 'g'},
+      {"cc", required_argument, NULL, 'c'},
+      {"pacing", no_argument, NULL, 'p'},
+      {"fec", required_argument, NULL, 'f'},
+      {"workers", required_argument, NULL, 'w'},
+      {"pin", no_argument, NULL, 'P'},
+      {"steer-cpu", no_argument, NULL, 's'},
+      {"cache-mb", required_argument, NULL, 'm'},
+      {NULL, 0, NULL, 0}};
+  int opt;
+  int workers = 1;
+  bool pin = false;
+  bool steer_cpu = false;
+  int cache_mb = DEFAULT_CACHE_MB;
+  while ((opt = getopt_long(argc, argv, "b:gc:pf:w:Psm:", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+      case 'b':
+        udp_server->session_config_.batch_size = atoi(optarg);
+        break;
+      case 'g':
+        udp_server->session_config_.gso = true;
+        break;
+      case 'c':
+        if (!safe_udp::CongestionController::ParseAlgorithm(
+                optarg, &udp_server->session_config_.congestion_control)) {
+          LOG(ERROR) << "Unknown congestion control: " << optarg;
+          usage();
+          exit(1);
+        }
+        break;
+      case 'p':
+        udp_server->session_config_.pacing = true;
+        break;
+      case 'f':
+        udp_server->session_config_.fec_block = atoi(optarg);
+        if (udp_server->session_config_.fec_block < 0 ||
+            udp_server->session_config_.fec_block > safe_udp::MAX_FEC_BLOCK) {
+          LOG(ERROR) << "FEC block size should be in 0-"
+                     << safe_udp::MAX_FEC_BLOCK << " !!!";
+          usage();
+          exit(1);
+        }
+        break;
+      case 'w':
+        workers = atoi(optarg);
+        if (workers < 1) {
+          LOG(ERROR) << "Number of workers should be positive !!!";
+          usage();
+          exit(1);
+        }
+        break;
+      case 'P':
+        pin = true;
+        break;
+      case 's':
+        steer_cpu = true;
+        break;
+      case 'm':
+        cache_mb = atoi(optarg);
+        if (cache_mb < 0) {
+          LOG(ERROR) << "Cache size should not be negative !!!";
+          usage();
+          exit(1);
+        }
+        break;
+      default:
+        usage();
+        exit(1);
+    }
+  }
+
   int port_num = 8080;
   int recv_window = 0;
-  char *message_recv;
-  if (argc < 3) {
+  if (argc - optind < 2) {
     LOG(INFO) << "Please provide a port number and receive window";
-    LOG(ERROR) << "Please provide format: <server-port> <receiver-window>";
+    usage();
     exit(1);
   }
-  if (argv[1] != NULL) {
-    port_num = atoi(argv[1]);
+  port_num = atoi(argv[optind]);
+  recv_window = atoi(argv[optind + 1]);
+
+  udp_server->session_config_.rwnd = recv_window;
+
+  /** 所有工作线程共享一个文件块缓存，预算为 0 时各会话直接映射文件 */
+  std::unique_ptr<safe_udp::ChunkCache> chunk_cache;
+  if (cache_mb > 0) {
+    chunk_cache =
+        std::make_unique<safe_udp::ChunkCache>((int64_t)cache_mb << 20);
+    udp_server->session_config_.chunk_cache = chunk_cache.get();
   }
-  if (argv[2] != NULL) {
-    recv_window = atoi(argv[2]);
+
+  /**
+   * 多个工作线程各有一个绑定到同一端口的 socket（SO_REUSEPORT）和事件循环，
+   * 内核按客户端地址哈希分发，同一个流的请求和 ACK 总是到达同一个线程，
+   * 会话状态只属于一个线程，不需要加锁。
+   * 工作线程 i 的 socket 第 i 个绑定，按 CPU 分流时 CBPF 程序返回的下标即为 i
+   */
+  std::vector<std::unique_ptr<safe_udp::UdpServer>> worker_servers;
+  std::vector<std::thread> threads;
+  udp_server->StartServer(port_num, workers > 1);
+  for (int i = 1; i < workers; i++) {
+    worker_servers.push_back(std::make_unique<safe_udp::UdpServer>());
+    worker_servers.back()->session_config_ = udp_server->session_config_;
+    worker_servers.back()->StartServer(port_num, true);
+  }
+  if (steer_cpu && workers > 1 && !udp_server->AttachCpuSteering(workers)) {
+    LOG(WARNING) << "Falling back to the default reuseport hash";
   }
 
-  safe_udp::UdpServer *udp_server = new safe_udp::UdpServer();
-  udp_server->rwnd_ = recv_window;
-  sfd = udp_server->StartServer(port_num);
-  message_recv = udp_server->GetRequest(sfd);
-  // char cwd[1024];
-  // if (getcwd(cwd, sizeof(cwd)) != NULL) {
-  //   LOG(INFO) << "Current working directory: " << cwd;
-  // } else {
-  //   perror("getcwd() error");
-  //   return 1;
-  // }
-
-  std::string file_name =
-      std::string(SERVER_FILE_PATH) + std::string(message_recv);
-  if (udp_server->OpenFile(file_name)) {
-    udp_server->StartFileTransfer();
-  } else {
-    udp_server->SendError();
-  }
-
-  free(udp_server);
+  int cpus = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < workers; i++) {
+    safe_udp::UdpServer *server = worker_servers[i - 1].get();
+    int cpu = i % cpus;
+    threads.emplace_back([server, cpu, pin]() {
+      if (pin) {
+        server->PinToCpu(cpu);
+      }
+      server->Run(SERVER_FILE_PATH);
+    });
+  }
+  if (pin) {
+    udp_server->PinToCpu(0);
+  }
+  udp_server->Run(SERVER_FILE_PATH);
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  delete udp_server;
   return 0;
 }
@@ -0,0 +1,37 @@
+#include "ack_policy.h"
+
+#include <algorithm>
+
+namespace safe_udp {
+AckPolicy::AckPolicy(int ack_every, int64_t delay_us)
+    : ack_every_(std::max(1, ack_every)),
+      delay_us_(std::max<int64_t>(0, delay_us)),
+      pending_(0),
+      first_pending_(0),
+      echo_timestamp_(0) {}
+
+bool AckPolicy::OnSegment(int64_t timestamp, bool immediate, int64_t now_us) {
+  if (pending_ == 0) {
+    first_pending_ = now_us;
+    echo_timestamp_ = timestamp;
+  } else if (immediate) {
+    /**
+     * 乱序或重复的数据段触发的 ACK 回显它自己的时间戳：
+     * 发送方用这类 ACK 判断丢包，样本应反映这个数据段的往返时间
+     */
+    echo_timestamp_ = timestamp;
+  }
+  pending_++;
+  return immediate || pending_ >= ack_every_ || delay_us_ == 0;
+}
+
+void AckPolicy::OnAckSent() {
+  pending_ = 0;
+  first_pending_ = 0;
+  echo_timestamp_ = 0;
+}
+
+int64_t AckPolicy::deadline() const {
+  return pending_ > 0 ? first_pending_ + delay_us_ : -1;
+}
+}  // namespace safe_udp
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/** 默认每收到多少个按序数据段发送一个 ACK */
+constexpr int DEFAULT_ACK_EVERY = 2;
+/**
+ * 默认的 ACK 延迟上限（微秒），远小于服务器 2 毫秒的 RTO 下限，
+ * 不会因为延迟确认引发超时重传
+ */
+constexpr int64_t DEFAULT_ACK_DELAY_US = 500;
+
+/**
+ * AckPolicy 类决定接收方何时发送 ACK（参照 RFC 1122 / RFC 5681 的延迟确认）：
+ * 按序到达的数据段每累积 ack_every 个确认一次，不足时最多延迟 delay_us；
+ * 乱序、重复、填补空洞以及带 FIN 的数据段需要立即确认，
+ * 以便发送方及时进行快速重传和结束会话。
+ * ACK 回显的时间戳取待确认数据段中最早的一个（RFC 7323 4.3），
+ * 使发送方的 RTT 样本包含延迟确认的时间，RTO 不会偏小。
+ */
+class AckPolicy {
+ public:
+  /**
+   * 构造函数
+   * @param ack_every 每多少个按序数据段确认一次，1 表示逐个确认
+   * @param delay_us 最长延迟（微秒）
+   */
+  AckPolicy(int ack_every, int64_t delay_us);
+
+  /**
+   * 记录一个收到的数据段
+   * @param timestamp 数据段携带的发送时间戳
+   * @param immediate 该数据段是否必须立即确认
+   * @param now_us 当前时间（微秒）
+   * @return 需要立即发送 ACK 时返回 true
+   */
+  bool OnSegment(int64_t timestamp, bool immediate, int64_t now_us);
+
+  /** ACK 已经发出，清空待确认状态 */
+  void OnAckSent();
+
+  /** 是否有尚未确认的数据段 */
+  bool pending() const { return pending_ > 0; }
+
+  /** 延迟定时器的到期时间（微秒），没有待确认的数据段时返回 -1 */
+  int64_t deadline() const;
+
+  /** 待发送的 ACK 应回显的时间戳 */
+  int64_t echo_timestamp() const { return echo_timestamp_; }
+
+ private:
+  int ack_every_;           /* 每多少个按序数据段确认一次 */
+  int64_t delay_us_;        /* 最长延迟（微秒） */
+  int pending_;             /* 尚未确认的数据段数量 */
+  int64_t first_pending_;   /* 第一个待确认数据段的到达时间（微秒） */
+  int64_t echo_timestamp_;  /* 第一个待确认数据段的时间戳 */
+};
+}  // namespace safe_udp
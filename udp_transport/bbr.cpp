@@ -0,0 +1,189 @@
+#include "bbr.h"
+
+#include <algorithm>
+
+namespace safe_udp {
+/** STARTUP 增益 2/ln2，使发送速率每轮翻倍 */
+constexpr double HIGH_GAIN = 2.885;
+/** PROBE_BW 的 8 相位增益循环 */
+constexpr double PACING_GAIN_CYCLE[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+constexpr int CYCLE_LENGTH = 8;
+constexpr double PROBE_BW_CWND_GAIN = 2;
+/** 最小 RTT 的有效期以及 PROBE_RTT 持续时间 */
+constexpr int64_t MIN_RTT_WINDOW_US = 10 * 1000000;
+constexpr int64_t PROBE_RTT_DURATION_US = 200 * 1000;
+/** 窗口下限与初始窗口 */
+constexpr double MIN_PIPE_CWND = 4;
+constexpr double INITIAL_CWND = 4;
+/** 连续 3 轮带宽增长不足 25% 认为管道已满 */
+constexpr double FULL_BW_THRESH = 1.25;
+constexpr int FULL_BW_COUNT = 3;
+
+Bbr::Bbr(int mss)
+    : mss_(mss),
+      mode_(STARTUP),
+      pacing_gain_(HIGH_GAIN),
+      cwnd_gain_(HIGH_GAIN),
+      cwnd_(INITIAL_CWND),
+      prior_cwnd_(0),
+      restore_cwnd_(false),
+      delivered_(0),
+      round_start_delivered_(0),
+      next_round_delivered_(0),
+      round_start_us_(0),
+      round_count_(0),
+      btl_bw_(0),
+      full_bw_(0),
+      full_bw_count_(0),
+      filled_pipe_(false),
+      min_rtt_us_(0),
+      min_rtt_stamp_us_(0),
+      probe_rtt_done_us_(0),
+      cycle_index_(0),
+      cycle_stamp_us_(0) {
+  std::fill(bw_samples_, bw_samples_ + BW_FILTER_ROUNDS, 0);
+}
+
+double Bbr::bdp() const { return btl_bw_ * min_rtt_us_ / 1e6; }
+
+void Bbr::OnAck(const AckSample &ack) {
+  if (round_start_us_ == 0) {
+    round_start_us_ = ack.now_us;
+    next_round_delivered_ = ack.acked_segments + ack.inflight;
+  }
+  delivered_ += ack.acked_segments;
+  if (delivered_ >= next_round_delivered_) {
+    onRoundEnd(ack);
+  }
+
+  updateMode(ack);
+
+  if (restore_cwnd_) {
+    cwnd_ = std::max(cwnd_, prior_cwnd_);
+    restore_cwnd_ = false;
+  }
+
+  /**
+   * 带宽和 RTT 都有估计后窗口趋向 cwnd_gain * BDP；
+   * 管道未填满之前窗口随确认增长，不会因为估计偏小而收缩
+   */
+  double target = cwnd_gain_ * bdp();
+  if (btl_bw_ == 0 || min_rtt_us_ == 0) {
+    cwnd_ += ack.acked_segments;
+  } else if (filled_pipe_) {
+    cwnd_ = std::min(cwnd_ + ack.acked_segments, target);
+  } else if (cwnd_ < target) {
+    cwnd_ += ack.acked_segments;
+  }
+  cwnd_ = std::max(cwnd_, MIN_PIPE_CWND);
+  if (mode_ == PROBE_RTT) {
+    cwnd_ = std::min(cwnd_, MIN_PIPE_CWND);
+  }
+}
+
+void Bbr::onRoundEnd(const AckSample &ack) {
+  int64_t elapsed = ack.now_us - round_start_us_;
+  if (elapsed > 0) {
+    double sample = (delivered_ - round_start_delivered_) * 1e6 / elapsed;
+    bw_samples_[round_count_ % BW_FILTER_ROUNDS] = sample;
+    btl_bw_ = *std::max_element(bw_samples_, bw_samples_ + BW_FILTER_ROUNDS);
+  }
+  round_count_++;
+  round_start_us_ = ack.now_us;
+  round_start_delivered_ = delivered_;
+  next_round_delivered_ = delivered_ + std::max(1, ack.inflight);
+  bw_samples_[round_count_ % BW_FILTER_ROUNDS] = 0;
+
+  /** STARTUP：带宽连续几轮没有明显增长说明已经到达瓶颈 */
+  if (!filled_pipe_) {
+    if (btl_bw_ >= full_bw_ * FULL_BW_THRESH) {
+      full_bw_ = btl_bw_;
+      full_bw_count_ = 0;
+    } else if (++full_bw_count_ >= FULL_BW_COUNT) {
+      filled_pipe_ = true;
+    }
+  }
+}
+
+void Bbr::enterProbeBw(int64_t now_us, int cycle_index) {
+  mode_ = PROBE_BW;
+  cycle_index_ = cycle_index;
+  cycle_stamp_us_ = now_us;
+  pacing_gain_ = PACING_GAIN_CYCLE[cycle_index_];
+  cwnd_gain_ = PROBE_BW_CWND_GAIN;
+}
+
+void Bbr::updateMode(const AckSample &ack) {
+  switch (mode_) {
+    case STARTUP:
+      if (filled_pipe_) {
+        mode_ = DRAIN;
+        pacing_gain_ = 1 / HIGH_GAIN;
+        cwnd_gain_ = HIGH_GAIN;
+      }
+      break;
+    case DRAIN:
+      /** 排空 STARTUP 在瓶颈队列中留下的数据后开始稳态探测 */
+      if (ack.inflight <= bdp()) {
+        enterProbeBw(ack.now_us, 2);
+      }
+      break;
+    case PROBE_BW:
+      /** 每个最小 RTT 切换一次增益相位 */
+      if (ack.now_us - cycle_stamp_us_ > min_rtt_us_) {
+        enterProbeBw(ack.now_us, (cycle_index_ + 1) % CYCLE_LENGTH);
+      }
+      break;
+    case PROBE_RTT:
+      if (probe_rtt_done_us_ == 0 && ack.inflight <= MIN_PIPE_CWND) {
+        probe_rtt_done_us_ = ack.now_us + PROBE_RTT_DURATION_US;
+      } else if (probe_rtt_done_us_ != 0 && ack.now_us >= probe_rtt_done_us_) {
+        min_rtt_stamp_us_ = ack.now_us;
+        probe_rtt_done_us_ = 0;
+        if (filled_pipe_) {
+          enterProbeBw(ack.now_us, 2);
+        } else {
+          mode_ = STARTUP;
+          pacing_gain_ = HIGH_GAIN;
+          cwnd_gain_ = HIGH_GAIN;
+        }
+      }
+      return;
+  }
+
+  /** 最小 RTT 长时间没有更新，短暂缩小窗口重新测量 */
+  if (min_rtt_stamp_us_ != 0 &&
+      ack.now_us - min_rtt_stamp_us_ > MIN_RTT_WINDOW_US) {
+    mode_ = PROBE_RTT;
+    pacing_gain_ = 1;
+    cwnd_gain_ = 1;
+    probe_rtt_done_us_ = 0;
+  }
+}
+
+void Bbr::OnTimeout(int64_t /*now_us*/) {
+  if (!restore_cwnd_) {
+    prior_cwnd_ = cwnd_;
+  }
+  restore_cwnd_ = true;
+  cwnd_ = 1;
+}
+
+void Bbr::OnRttSample(int64_t rtt_us, int64_t now_us) {
+  if (rtt_us <= 0) {
+    return;
+  }
+  if (min_rtt_us_ == 0 || rtt_us <= min_rtt_us_ ||
+      now_us - min_rtt_stamp_us_ > MIN_RTT_WINDOW_US) {
+    min_rtt_us_ = rtt_us;
+    min_rtt_stamp_us_ = now_us;
+  }
+}
+
+int Bbr::cwnd() const { return std::max(1, (int)cwnd_); }
+
+/**
+ * 还没有带宽估计时不限速，由窗口控制发送量
+ */
+double Bbr::pacing_rate() const { return pacing_gain_ * btl_bw_ * mss_; }
+}  // namespace safe_udp
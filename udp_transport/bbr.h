@@ -0,0 +1,67 @@
+#pragma once
+#include "congestion_controller.h"
+
+namespace safe_udp {
+/**
+ * 基于模型的 BBR 风格拥塞控制（参照 BBRv1）。
+ * 持续估计瓶颈带宽（最近 10 轮投递速率的最大值）和最小 RTT（10 秒窗口），
+ * 窗口取 cwnd_gain * BDP，发送速率取 pacing_gain * 瓶颈带宽；
+ * 丢包本身不减窗，超时后只在下一次确认前把窗口压到 1。
+ * 投递速率按轮次（一轮约一个 RTT）统计，不做逐包的速率采样。
+ */
+class Bbr : public CongestionController {
+ public:
+  explicit Bbr(int mss);
+
+  void OnAck(const AckSample &ack) override;
+  void OnLoss(int64_t /*now_us*/) override {}
+  void OnTimeout(int64_t now_us) override;
+  void OnRttSample(int64_t rtt_us, int64_t now_us) override;
+
+  int cwnd() const override;
+  double pacing_rate() const override;
+  bool in_slow_start() const override { return mode_ == STARTUP; }
+  const char *name() const override { return "bbr"; }
+
+ private:
+  enum Mode { STARTUP, DRAIN, PROBE_BW, PROBE_RTT };
+
+  /** 轮次结束时更新带宽估计并判断管道是否已经填满 */
+  void onRoundEnd(const AckSample &ack);
+  /** 根据当前模式切换状态并设置增益 */
+  void updateMode(const AckSample &ack);
+  /** 以数据段为单位的带宽时延积 */
+  double bdp() const;
+  /** 进入 PROBE_BW，从指定相位开始循环 */
+  void enterProbeBw(int64_t now_us, int cycle_index);
+
+  static constexpr int BW_FILTER_ROUNDS = 10;
+
+  int mss_;                       /* 每个数据段的字节数 */
+  Mode mode_;                     /* 当前状态 */
+  double pacing_gain_;            /* 发送速率增益 */
+  double cwnd_gain_;              /* 窗口增益 */
+  double cwnd_;                   /* 拥塞窗口（数据段） */
+  double prior_cwnd_;             /* 超时前的窗口，下一次确认时恢复 */
+  bool restore_cwnd_;             /* 是否需要恢复 prior_cwnd_ */
+
+  long delivered_;                /* 累计投递的数据段 */
+  long round_start_delivered_;    /* 本轮开始时的 delivered_ */
+  long next_round_delivered_;     /* delivered_ 达到该值时本轮结束 */
+  int64_t round_start_us_;        /* 本轮开始时间 */
+  long round_count_;              /* 已完成的轮数 */
+  double bw_samples_[BW_FILTER_ROUNDS]; /* 最近各轮的投递速率（数据段/秒） */
+  double btl_bw_;                 /* 瓶颈带宽估计（数据段/秒） */
+
+  double full_bw_;                /* STARTUP 中记录的带宽平台 */
+  int full_bw_count_;             /* 带宽没有明显增长的轮数 */
+  bool filled_pipe_;              /* 管道是否已经填满 */
+
+  int64_t min_rtt_us_;            /* 最小 RTT 估计 */
+  int64_t min_rtt_stamp_us_;      /* 最小 RTT 的更新时间 */
+  int64_t probe_rtt_done_us_;     /* PROBE_RTT 结束时间，0 表示未开始计时 */
+
+  int cycle_index_;               /* PROBE_BW 增益循环的相位 */
+  int64_t cycle_stamp_us_;        /* 当前相位开始时间 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,137 @@
+#include "block_codec.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#ifdef SAFE_UDP_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef SAFE_UDP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace safe_udp {
+/** zlib 和 zstd 的压缩级别：都取最快的一级，压缩不能成为发送的瓶颈 */
+constexpr int ZLIB_LEVEL = 1;
+constexpr int ZSTD_LEVEL = 1;
+
+bool BlockCodec::Parse(const std::string &name, Compression *method) {
+  if (name == "none") {
+    *method = Compression::NONE;
+  } else if (name == "zlib") {
+    *method = Compression::ZLIB;
+  } else if (name == "lz4") {
+    *method = Compression::LZ4;
+  } else if (name == "zstd") {
+    *method = Compression::ZSTD;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *BlockCodec::Name(Compression method) {
+  switch (method) {
+    case Compression::NONE:
+      return "none";
+    case Compression::ZLIB:
+      return "zlib";
+    case Compression::LZ4:
+      return "lz4";
+    case Compression::ZSTD:
+      return "zstd";
+  }
+  return "unknown";
+}
+
+bool BlockCodec::IsAvailable(Compression method) {
+  switch (method) {
+    case Compression::NONE:
+    case Compression::ZLIB:
+      return true;
+    case Compression::LZ4:
+#ifdef SAFE_UDP_HAVE_LZ4
+      return true;
+#else
+      return false;
+#endif
+    case Compression::ZSTD:
+#ifdef SAFE_UDP_HAVE_ZSTD
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+Compression BlockCodec::Resolve(Compression requested) {
+  if (IsAvailable(requested)) {
+    return requested;
+  }
+  if (requested == Compression::LZ4 && IsAvailable(Compression::ZSTD)) {
+    return Compression::ZSTD;
+  }
+  return Compression::ZLIB;
+}
+
+int BlockCodec::Compress(Compression method, const char *src, int length,
+                         char *dst, int capacity) {
+  switch (method) {
+    case Compression::ZLIB: {
+      uLongf out_length = capacity;
+      if (compress2(reinterpret_cast<Bytef *>(dst), &out_length,
+                    reinterpret_cast<const Bytef *>(src), length,
+                    ZLIB_LEVEL) != Z_OK) {
+        return -1;
+      }
+      return out_length;
+    }
+#ifdef SAFE_UDP_HAVE_LZ4
+    case Compression::LZ4: {
+      int out_length = LZ4_compress_default(src, dst, length, capacity);
+      return out_length > 0 ? out_length : -1;
+    }
+#endif
+#ifdef SAFE_UDP_HAVE_ZSTD
+    case Compression::ZSTD: {
+      size_t out_length = ZSTD_compress(dst, capacity, src, length, ZSTD_LEVEL);
+      return ZSTD_isError(out_length) ? -1 : (int)out_length;
+    }
+#endif
+    default:
+      return -1;
+  }
+}
+
+bool BlockCodec::Decompress(Compression method, const char *src, int length,
+                            char *dst, int raw_length) {
+  switch (method) {
+    case Compression::NONE:
+      if (length != raw_length) {
+        return false;
+      }
+      memcpy(dst, src, length);
+      return true;
+    case Compression::ZLIB: {
+      uLongf out_length = raw_length;
+      return uncompress(reinterpret_cast<Bytef *>(dst), &out_length,
+                        reinterpret_cast<const Bytef *>(src),
+                        length) == Z_OK &&
+             (int)out_length == raw_length;
+    }
+#ifdef SAFE_UDP_HAVE_LZ4
+    case Compression::LZ4:
+      return LZ4_decompress_safe(src, dst, length, raw_length) == raw_length;
+#endif
+#ifdef SAFE_UDP_HAVE_ZSTD
+    case Compression::ZSTD: {
+      size_t out_length = ZSTD_decompress(dst, raw_length, src, length);
+      return !ZSTD_isError(out_length) && (int)out_length == raw_length;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+}  // namespace safe_udp
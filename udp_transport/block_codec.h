@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+
+namespace safe_udp {
+/** 压缩方法，数值写在文件请求和压缩分组的头部中 */
+enum class Compression : uint8_t {
+  NONE = 0, /* 不压缩（分组内原样存放） */
+  ZLIB = 1, /* zlib（deflate 级别 1），总是可用 */
+  LZ4 = 2,  /* LZ4，编译时找到 liblz4 才可用 */
+  ZSTD = 3, /* zstd（级别 1），编译时找到 libzstd 才可用 */
+};
+
+/**
+ * BlockCodec 类对独立的数据块做压缩和解压，每个块单独编码，
+ * 不依赖前后的块，丢失或乱序不会影响其他块的解压。
+ * LZ4、zstd 在编译时按是否找到对应的库启用，zlib 作为兜底。
+ */
+class BlockCodec {
+ public:
+  /**
+   * 解析压缩方法名称（none、zlib、lz4、zstd）
+   * @return 名称有效返回 true
+   */
+  static bool Parse(const std::string &name, Compression *method);
+
+  /** 压缩方法的名称 */
+  static const char *Name(Compression method);
+
+  /** 本进程是否支持该方法 */
+  static bool IsAvailable(Compression method);
+
+  /**
+   * 请求的方法不可用时退回到可用的方法：LZ4 退回 zstd，再退回 zlib
+   */
+  static Compression Resolve(Compression requested);
+
+  /**
+   * 压缩一个块
+   * @param dst 输出缓冲区
+   * @param capacity 输出缓冲区大小，通常取原长，压缩后不更短就没有意义
+   * @return 压缩后的长度，失败或放不下返回 -1（调用方改为原样存放）
+   */
+  static int Compress(Compression method, const char *src, int length,
+                      char *dst, int capacity);
+
+  /**
+   * 解压一个块
+   * @param raw_length 原始长度，解压结果必须恰好是这么长
+   * @return 成功返回 true
+   */
+  static bool Decompress(Compression method, const char *src, int length,
+                         char *dst, int raw_length);
+};
+}  // namespace safe_udp
@@ -1,22 +1,21 @@
 #pragma once
-#include <sys/time.h>
-#include <time.h>
+#include <stdint.h>
 
 namespace safe_udp {
-/*用于在 UDP 通信中管理滑动窗口缓冲区的类*/
+/*
+ * 滑动窗口中一个已发送数据段的记录（8 字节，8 个槽位占一条缓存行）。
+ * 数据段在文件中的位置由 (currSeqNum - 初始序列号) 推出，不再单独存储；
+ * 发送时间由数据段头部携带、ACK 回显，也不在这里保存。
+ */
 class SlidWinBuffer {
  public:
-  SlidWinBuffer() {}
-
-  ~SlidWinBuffer() {}
-
-  /*表示缓冲区中第一个字节的序列号*/
-  int firstByteSeq;
-  /*表示缓冲区中有效数据的长度*/
-  int dataLength;
   /*表示当前数据包的序列号*/
-  int currSeqNum;
-  /*表示数据发送的时间戳，用于跟踪传输时间*/
-  struct timeval timeSentStamp;
+  int currSeqNum = 0;
+  /*表示缓冲区中有效数据的长度*/
+  uint16_t dataLength = 0;
+  /*表示该数据段被重传的次数*/
+  uint8_t retransmitCount = 0;
+  /*表示接收方是否已经选择性确认（SACK）该数据段*/
+  bool sacked = false;
 };
 }  // namespace safe_udp
@@ -0,0 +1,92 @@
+#include "bundle_manifest.h"
+
+#include <string.h>
+
+#include <climits>
+
+#include "wire_format.h"
+
+namespace safe_udp {
+/** 每个文件的固定部分：起点、长度和名字长度 */
+constexpr int BUNDLE_ENTRY_HEADER_LENGTH = 10;
+
+int BundleManifest::Length(const char *header) {
+  uint32_t length = LoadBigEndian32(header + 4);
+  return length > INT_MAX ? -1 : (int)length;
+}
+
+bool BundleManifest::Parse(const char *data, int length,
+                           BundleManifest *manifest) {
+  manifest->entries.clear();
+  if (length < BUNDLE_MANIFEST_HEADER_LENGTH || Length(data) != length) {
+    return false;
+  }
+  uint32_t count = LoadBigEndian32(data);
+  int position = BUNDLE_MANIFEST_HEADER_LENGTH;
+  int64_t end = length;
+  for (uint32_t i = 0; i < count; i++) {
+    if (length - position < BUNDLE_ENTRY_HEADER_LENGTH) {
+      return false;
+    }
+    uint32_t offset = LoadBigEndian32(data + position);
+    uint32_t size = LoadBigEndian32(data + position + 4);
+    uint16_t name_length = LoadBigEndian16(data + position + 8);
+    position += BUNDLE_ENTRY_HEADER_LENGTH;
+    /** 文件必须按起点升序、互不重叠，并且不能覆盖清单本身 */
+    if (name_length == 0 || length - position < name_length ||
+        offset < end || (int64_t)offset + size > INT_MAX) {
+      return false;
+    }
+    BundleEntry entry;
+    entry.name.assign(data + position, name_length);
+    entry.offset = (int)offset;
+    entry.size = (int)size;
+    manifest->entries.push_back(entry);
+    position += name_length;
+    end = (int64_t)offset + size;
+  }
+  return position == length;
+}
+
+bool BundleManifest::IsSafeName(const std::string &name) {
+  if (name.empty() || name[0] == '/') {
+    return false;
+  }
+  size_t start = 0;
+  while (start <= name.size()) {
+    size_t end = name.find('/', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+    if (name.compare(start, end - start, "..") == 0) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return true;
+}
+
+std::string BundleManifest::Serialize() const {
+  std::string data(SerializedLength(), '\0');
+  StoreBigEndian32(&data[0], entries.size());
+  StoreBigEndian32(&data[4], data.size());
+  int position = BUNDLE_MANIFEST_HEADER_LENGTH;
+  for (const BundleEntry &entry : entries) {
+    StoreBigEndian32(&data[position], entry.offset);
+    StoreBigEndian32(&data[position + 4], entry.size);
+    StoreBigEndian16(&data[position + 8], entry.name.size());
+    memcpy(&data[position + BUNDLE_ENTRY_HEADER_LENGTH], entry.name.data(),
+           entry.name.size());
+    position += BUNDLE_ENTRY_HEADER_LENGTH + entry.name.size();
+  }
+  return data;
+}
+
+int BundleManifest::SerializedLength() const {
+  int length = BUNDLE_MANIFEST_HEADER_LENGTH;
+  for (const BundleEntry &entry : entries) {
+    length += BUNDLE_ENTRY_HEADER_LENGTH + entry.name.size();
+  }
+  return length;
+}
+}  // namespace safe_udp
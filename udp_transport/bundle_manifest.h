@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace safe_udp {
+/** 清单头部长度：文件数（4 字节）和整个清单的长度（4 字节） */
+constexpr int BUNDLE_MANIFEST_HEADER_LENGTH = 8;
+
+/**
+ * 清单中的一个文件：名字（相对于服务器文件目录）以及内容在字节流中的位置
+ */
+struct BundleEntry {
+  std::string name;
+  int offset = 0; /* 内容在字节流中的起点 */
+  int size = 0;   /* 文件长度 */
+};
+
+/**
+ * BundleManifest 描述一次多文件传输的字节流布局，位于字节流的开头
+ * （多字节字段为网络字节序）：
+ *   0  文件数（4 字节）    4  清单长度（4 字节，包含头部）
+ *   8  每个文件：起点（4 字节）、长度（4 字节）、名字长度（2 字节）、名字
+ * 文件按起点升序排列，互不重叠，都在清单之后。客户端收到清单长度的按序前缀后
+ * 解析清单，之后按序到达的字节按各文件的起点写入对应的文件。
+ */
+struct BundleManifest {
+  std::vector<BundleEntry> entries;
+
+  /**
+   * 从头部读出整个清单的长度
+   * @param header BUNDLE_MANIFEST_HEADER_LENGTH 字节
+   */
+  static int Length(const char *header);
+
+  /**
+   * 解析清单
+   * @param data 清单数据
+   * @param length 数据长度，必须等于 Length 给出的清单长度
+   * @return 格式正确返回 true
+   */
+  static bool Parse(const char *data, int length, BundleManifest *manifest);
+
+  /**
+   * 名字（或 glob 模式）是否是目录之内的相对路径：
+   * 非空，不以 '/' 开头，没有 ".." 路径分量
+   */
+  static bool IsSafeName(const std::string &name);
+
+  /** 序列化为字节流开头的清单 */
+  std::string Serialize() const;
+
+  /** 序列化后的长度 */
+  int SerializedLength() const;
+};
+}  // namespace safe_udp
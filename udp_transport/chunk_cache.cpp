@@ -0,0 +1,109 @@
+#include "chunk_cache.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace safe_udp {
+size_t ChunkCache::KeyHash::operator()(const Key &key) const {
+  uint64_t h = key.file.inode * 0x9E3779B97F4A7C15ull;
+  h ^= key.file.device + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+  h ^= (uint64_t)key.file.mtimeNs + (h << 6) + (h >> 2);
+  h ^= (uint64_t)key.index + (h << 6) + (h >> 2);
+  return h;
+}
+
+ChunkCache::ChunkCache(int64_t budget_bytes)
+    : budget_(std::max<int64_t>(budget_bytes, 0)), hand_(0) {}
+
+std::shared_ptr<const FileChunk> ChunkCache::Get(const FileIdentity &file,
+                                                 int fd, int64_t index) {
+  Key key{file, index};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      Entry &entry = entries_[it->second];
+      entry.referenced = true;
+      stats_.hits++;
+      return entry.chunk;
+    }
+    stats_.misses++;
+  }
+
+  std::shared_ptr<const FileChunk> chunk = load(file, fd, index);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.diskReads++;
+  stats_.diskBytes += chunk->length;
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    return entries_[it->second].chunk;
+  }
+  evictFor(chunk->length);
+  int slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    slot = entries_.size();
+    entries_.emplace_back();
+  }
+  entries_[slot].key = key;
+  entries_[slot].chunk = chunk;
+  entries_[slot].referenced = true;
+  index_.emplace(key, slot);
+  stats_.residentBytes += chunk->length;
+  return chunk;
+}
+
+ChunkCacheStats ChunkCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::shared_ptr<const FileChunk> ChunkCache::load(const FileIdentity &file,
+                                                  int fd, int64_t index) {
+  auto chunk = std::make_shared<FileChunk>();
+  int64_t start = index * CHUNK_SIZE;
+  chunk->length = (int)std::max<int64_t>(
+      0, std::min<int64_t>(CHUNK_SIZE + CHUNK_OVERLAP, file.size - start));
+  chunk->data.reset(new char[std::max(chunk->length, 1)]);
+  chunk->segmentCrcs.reset(new std::atomic<uint64_t>[CHUNK_SEGMENT_SLOTS]());
+
+  int done = 0;
+  while (done < chunk->length) {
+    ssize_t n = pread(fd, chunk->data.get() + done, chunk->length - done,
+                      start + done);
+    if (n <= 0) {
+      /** 文件在传输中被截断或读出错：后面的内容补零，与映射区被截断时不同，不会崩溃 */
+      LOG(ERROR) << "Failed to read chunk " << index << " at " << start + done;
+      memset(chunk->data.get() + done, 0, chunk->length - done);
+      break;
+    }
+    done += n;
+  }
+  return chunk;
+}
+
+void ChunkCache::evictFor(int64_t bytes) {
+  while (stats_.residentBytes > 0 && stats_.residentBytes + bytes > budget_) {
+    Entry &entry = entries_[hand_];
+    if (entry.chunk != nullptr) {
+      if (entry.referenced) {
+        entry.referenced = false;
+      } else {
+        index_.erase(entry.key);
+        stats_.residentBytes -= entry.chunk->length;
+        stats_.evictions++;
+        entry.chunk.reset();
+        free_slots_.push_back(hand_);
+      }
+    }
+    hand_ = (hand_ + 1) % entries_.size();
+  }
+}
+}  // namespace safe_udp
@@ -0,0 +1,126 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+/** 缓存块的大小 */
+constexpr int CHUNK_SIZE = 1 << 20;
+/**
+ * 每个块额外保存下一个块开头的这么多字节：从块内任意位置开始、
+ * 不超过该长度的数据（一个数据段或一个压缩分组）在同一个块中连续
+ */
+constexpr int CHUNK_OVERLAP = 64 * 1024;
+/** 起点在一个块内、文件偏移是 MAX_DATA_SIZE 整数倍的数据段最多有这么多个 */
+constexpr int CHUNK_SEGMENT_SLOTS = CHUNK_SIZE / MAX_DATA_SIZE + 1;
+
+/**
+ * 文件身份：设备号、inode、长度和修改时间。
+ * 文件被修改或替换后身份改变，不会命中旧内容的块
+ */
+struct FileIdentity {
+  uint64_t device = 0;
+  uint64_t inode = 0;
+  int64_t size = 0;
+  int64_t mtimeNs = 0;
+
+  bool operator==(const FileIdentity &other) const {
+    return device == other.device && inode == other.inode &&
+           size == other.size && mtimeNs == other.mtimeNs;
+  }
+};
+
+/**
+ * 缓存中的一个文件块，读入后不再修改，由缓存和正在使用它的会话共享。
+ * 块内对齐数据段的载荷 CRC32C 在第一次发送时填入，之后所有会话和每次重传
+ * 都直接使用，只需要在 28 字节的头部中修改会话相关的字段；
+ * 载荷本身以 iovec 从块中发送，不拷贝。
+ */
+struct FileChunk {
+  std::unique_ptr<char[]> data;
+  int length = 0; /* 有效长度，包括与下一个块重叠的部分 */
+  /** 对齐数据段的载荷 CRC32C，第 32 位为 1 表示已经填入 */
+  mutable std::unique_ptr<std::atomic<uint64_t>[]> segmentCrcs;
+};
+
+/** 缓存的累计统计 */
+struct ChunkCacheStats {
+  int64_t hits = 0;          /* 命中次数 */
+  int64_t misses = 0;        /* 未命中次数 */
+  int64_t evictions = 0;     /* 淘汰的块数 */
+  int64_t diskReads = 0;     /* 读盘（pread）次数 */
+  int64_t diskBytes = 0;     /* 读盘字节数 */
+  int64_t residentBytes = 0; /* 当前缓存占用的字节数 */
+};
+
+/**
+ * ChunkCache 类是服务器所有工作线程共享的文件块缓存，按（文件身份，块号）索引，
+ * 超出内存预算时按 CLOCK 算法淘汰。块以 shared_ptr 交给会话，
+ * 被淘汰的块在最后一个使用者释放后才真正回收。
+ * 查找在互斥锁内完成，读盘在锁外进行；两个会话同时读入同一个块时保留先插入的。
+ */
+class ChunkCache {
+ public:
+  /**
+   * 构造函数
+   * @param budget_bytes 内存预算（字节），至少保留一个块
+   */
+  explicit ChunkCache(int64_t budget_bytes);
+
+  ChunkCache(const ChunkCache &) = delete;
+  ChunkCache &operator=(const ChunkCache &) = delete;
+
+  /**
+   * 取出文件的第 index 个块，不在缓存中时从 fd 读入
+   * @param file 文件身份
+   * @param fd 文件描述符，用于未命中时读盘
+   * @param index 块号
+   */
+  std::shared_ptr<const FileChunk> Get(const FileIdentity &file, int fd,
+                                       int64_t index);
+
+  /** 当前的统计信息 */
+  ChunkCacheStats stats() const;
+
+  /** 内存预算（字节） */
+  int64_t budget() const { return budget_; }
+
+ private:
+  struct Key {
+    FileIdentity file;
+    int64_t index;
+    bool operator==(const Key &other) const {
+      return index == other.index && file == other.file;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+  struct Entry {
+    Key key;
+    std::shared_ptr<const FileChunk> chunk; /* 为空表示空闲槽位 */
+    bool referenced = false;                /* CLOCK 访问位 */
+  };
+
+  /** 从文件读入一个块，读失败时补零并记录错误 */
+  std::shared_ptr<const FileChunk> load(const FileIdentity &file, int fd,
+                                        int64_t index);
+  /** 按 CLOCK 淘汰，直到能再放下 bytes 字节，调用时持有锁 */
+  void evictFor(int64_t bytes);
+
+  int64_t budget_;                            /* 内存预算 */
+  mutable std::mutex mutex_;                  /* 保护以下成员 */
+  std::unordered_map<Key, int, KeyHash> index_; /* 块 -> 槽位 */
+  std::vector<Entry> entries_;                /* CLOCK 环 */
+  std::vector<int> free_slots_;               /* 空闲槽位 */
+  size_t hand_;                               /* CLOCK 指针 */
+  ChunkCacheStats stats_;                     /* 统计信息 */
+};
+}  // namespace safe_udp
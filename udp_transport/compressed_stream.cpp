@@ -0,0 +1,121 @@
+#include "compressed_stream.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+static_assert(COMPRESSION_BLOCK_SIZE <= CHUNK_OVERLAP,
+              "a compression block must be contiguous in a cached chunk");
+
+constexpr int COMPRESSED_MARKER = 1 << 30;
+constexpr int POSITION_SHIFT = 15;
+constexpr int FIELD_MASK = (1 << 15) - 1;
+
+int CompressedSegmentInfo::Pack() const {
+  return COMPRESSED_MARKER | (position << POSITION_SHIFT) | count;
+}
+
+CompressedSegmentInfo CompressedSegmentInfo::Unpack(int ack_num) {
+  CompressedSegmentInfo info;
+  info.position = (ack_num >> POSITION_SHIFT) & FIELD_MASK;
+  info.count = ack_num & FIELD_MASK;
+  return info;
+}
+
+void CompressedBlockHeader::SerializeTo(char *buffer) const {
+  StoreBigEndian64(buffer, rawOffset);
+  StoreBigEndian32(buffer + 8, rawLength);
+  StoreBigEndian32(buffer + 12, compressedLength);
+  buffer[16] = static_cast<char>(method);
+  memset(buffer + 17, 0, 3);
+}
+
+bool CompressedBlockHeader::Parse(const char *buffer, int length,
+                                  CompressedBlockHeader *header) {
+  if (length < COMPRESSED_BLOCK_HEADER_LENGTH) {
+    return false;
+  }
+  header->rawOffset = (int64_t)LoadBigEndian64(buffer);
+  header->rawLength = (int)LoadBigEndian32(buffer + 8);
+  header->compressedLength = (int)LoadBigEndian32(buffer + 12);
+  header->method = static_cast<Compression>(buffer[16]);
+  return header->rawOffset >= 0 && header->rawLength >= 0 &&
+         header->rawLength <= COMPRESSION_BLOCK_SIZE &&
+         header->compressedLength >= 0 &&
+         header->compressedLength <= COMPRESSION_BLOCK_SIZE &&
+         header->compressedLength <= length - COMPRESSED_BLOCK_HEADER_LENGTH;
+}
+
+CompressedStream::CompressedStream(FileSource *source, int offset, int length,
+                                   Compression method)
+    : source_(source),
+      offset_(offset),
+      raw_length_(length),
+      raw_position_(0),
+      method_(method),
+      size_(0) {
+  /** 最坏情况：每个分组都原样存放并补齐到数据段边界 */
+  int64_t blocks =
+      ((int64_t)length + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+  int64_t block_bytes =
+      (COMPRESSED_BLOCK_HEADER_LENGTH + COMPRESSION_BLOCK_SIZE +
+       MAX_DATA_SIZE - 1) / MAX_DATA_SIZE * MAX_DATA_SIZE;
+  image_.reset(new char[std::max<int64_t>(1, blocks * block_bytes)]);
+}
+
+void CompressedStream::EnsureAvailable(int bytes) {
+  while (size_ < bytes && !complete()) {
+    compressNextBlock();
+  }
+}
+
+int CompressedStream::SegmentInfo(int index) const {
+  CompressedSegmentInfo info;
+  auto it = std::upper_bound(block_first_.begin(), block_first_.end(), index);
+  if (it == block_first_.begin()) {
+    return info.Pack();
+  }
+  int first = *(it - 1);
+  int next = it != block_first_.end()
+                 ? *it
+                 : (size_ + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE;
+  info.position = index - first;
+  info.count = next - first;
+  return info.Pack();
+}
+
+void CompressedStream::compressNextBlock() {
+  int raw = std::min(COMPRESSION_BLOCK_SIZE, raw_length_ - raw_position_);
+  char *block = image_.get() + size_;
+  /** 一个分组不超过 CHUNK_OVERLAP，从文件取出的数据是连续的 */
+  const char *data = source_->Data(offset_ + raw_position_);
+  CompressedBlockHeader header;
+  header.rawOffset = raw_position_;
+  header.rawLength = raw;
+  header.method = method_;
+  /** 输出空间比原长少一个字节，压缩后不更短时失败，改为原样存放 */
+  header.compressedLength =
+      BlockCodec::Compress(method_, data, raw,
+                           block + COMPRESSED_BLOCK_HEADER_LENGTH, raw - 1);
+  if (header.compressedLength < 0) {
+    memcpy(block + COMPRESSED_BLOCK_HEADER_LENGTH, data, raw);
+    header.compressedLength = raw;
+    header.method = Compression::NONE;
+  }
+  header.SerializeTo(block);
+
+  block_first_.push_back(size_ / MAX_DATA_SIZE);
+  raw_position_ += raw;
+  int bytes = COMPRESSED_BLOCK_HEADER_LENGTH + header.compressedLength;
+  /** 下一个分组从新的数据段开始；最后一个分组不补零，流在它的末尾结束 */
+  if (!complete()) {
+    int padded = (bytes + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE * MAX_DATA_SIZE;
+    memset(block + bytes, 0, padded - bytes);
+    bytes = padded;
+  }
+  size_ += bytes;
+}
+}  // namespace safe_udp
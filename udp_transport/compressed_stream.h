@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "block_codec.h"
+#include "file_source.h"
+
+namespace safe_udp {
+/** 每个压缩分组的原始数据长度 */
+constexpr int COMPRESSION_BLOCK_SIZE = 64 * 1024;
+/** 压缩分组头部长度 */
+constexpr int COMPRESSED_BLOCK_HEADER_LENGTH = 20;
+
+/**
+ * 压缩流中数据段所属分组的信息，放在数据段头部的 ackNum 中（数据段不使用该字段）：
+ * 第 31 位为 0（与 FEC 校验段区分），第 30 位为 1 表示压缩流，
+ * 第 15-29 位为数据段在分组中的位置，第 0-14 位为分组的数据段数。
+ * 客户端由任意一个数据段就能知道它所在分组的范围，无需等待分组的第一个数据段。
+ */
+struct CompressedSegmentInfo {
+  int position = 0; /* 数据段在分组中的位置 */
+  int count = 0;    /* 分组占用的数据段数，0 表示空流 */
+
+  /** ackNum 是否标记了压缩流 */
+  static bool IsCompressed(int ack_num) {
+    return ((uint32_t)ack_num >> 30) == 1;
+  }
+  int Pack() const;
+  static CompressedSegmentInfo Unpack(int ack_num);
+};
+
+/**
+ * 压缩分组头部，位于分组第一个数据段的开头，多字节字段为网络字节序：
+ *   0 原始数据偏移（8 字节，相对于请求范围的起点）  8 原始长度（4 字节）
+ *   12 压缩后长度（4 字节）  16 压缩方法（1 字节）  17 保留（3 字节）
+ */
+struct CompressedBlockHeader {
+  int64_t rawOffset = 0;
+  int rawLength = 0;
+  int compressedLength = 0;
+  Compression method = Compression::NONE;
+
+  void SerializeTo(char *buffer) const;
+  /** 从 length 字节的缓冲区解析，长度不足或字段无效返回 false */
+  static bool Parse(const char *buffer, int length,
+                    CompressedBlockHeader *header);
+};
+
+/**
+ * CompressedStream 类把一段原始数据按 COMPRESSION_BLOCK_SIZE 切成独立压缩的分组，
+ * 组成会话实际发送的字节流。每个分组以数据段边界开始（前一个分组末尾补零），
+ * 压缩后不更短的分组原样存放。分组在发送推进到时才压缩，首字节不必等待整个文件；
+ * 输出缓冲区按最坏情况一次分配（只在写入时才实际占用内存），
+ * 已经交给发送队列的载荷指针不会因为扩容而失效。
+ */
+class CompressedStream {
+ public:
+  /**
+   * 构造函数
+   * @param source 原始数据所在的文件，在本对象的生命周期内有效
+   * @param offset 原始数据在文件中的起点
+   * @param length 原始数据长度
+   * @param method 压缩方法，必须可用
+   */
+  CompressedStream(FileSource *source, int offset, int length,
+                   Compression method);
+
+  /** 继续压缩，直到流中至少有 bytes 字节或者全部压缩完 */
+  void EnsureAvailable(int bytes);
+
+  /** 是否已经全部压缩完，此时 size() 是流的最终长度 */
+  bool complete() const { return raw_position_ == raw_length_; }
+
+  /** 目前已经生成的流长度 */
+  int size() const { return size_; }
+
+  /** 流中指定偏移处的数据指针，偏移必须小于 size() */
+  const char *Data(int offset) const { return image_.get() + offset; }
+
+  /** 第 index 个数据段的分组信息（打包后的 ackNum），数据段必须已经生成 */
+  int SegmentInfo(int index) const;
+
+  /** 压缩方法 */
+  Compression method() const { return method_; }
+
+  /** 原始数据长度 */
+  int raw_length() const { return raw_length_; }
+
+ private:
+  /** 压缩下一个分组并追加到流中 */
+  void compressNextBlock();
+
+  FileSource *source_;               /* 原始数据所在的文件 */
+  int offset_;                       /* 原始数据在文件中的起点 */
+  int raw_length_;                   /* 原始数据长度 */
+  int raw_position_;                 /* 已经压缩到的原始数据位置 */
+  Compression method_;               /* 压缩方法 */
+  std::unique_ptr<char[]> image_;    /* 压缩流 */
+  int size_;                         /* 已生成的流长度 */
+  std::vector<int> block_first_;     /* 每个分组第一个数据段的下标 */
+};
+}  // namespace safe_udp
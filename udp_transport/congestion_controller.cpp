@@ -0,0 +1,34 @@
+#include "congestion_controller.h"
+
+#include "bbr.h"
+#include "cubic.h"
+#include "new_reno.h"
+
+namespace safe_udp {
+std::unique_ptr<CongestionController> CongestionController::Create(
+    CongestionAlgorithm algorithm, int mss) {
+  switch (algorithm) {
+    case CongestionAlgorithm::CUBIC:
+      return std::make_unique<Cubic>();
+    case CongestionAlgorithm::BBR:
+      return std::make_unique<Bbr>(mss);
+    case CongestionAlgorithm::NEW_RENO:
+    default:
+      return std::make_unique<NewReno>();
+  }
+}
+
+bool CongestionController::ParseAlgorithm(const std::string &name,
+                                          CongestionAlgorithm *algorithm) {
+  if (name == "reno" || name == "newreno") {
+    *algorithm = CongestionAlgorithm::NEW_RENO;
+  } else if (name == "cubic") {
+    *algorithm = CongestionAlgorithm::CUBIC;
+  } else if (name == "bbr") {
+    *algorithm = CongestionAlgorithm::BBR;
+  } else {
+    return false;
+  }
+  return true;
+}
+}  // namespace safe_udp
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+namespace safe_udp {
+/** 可选的拥塞控制算法 */
+enum class CongestionAlgorithm {
+  NEW_RENO,
+  CUBIC,
+  BBR,
+};
+
+/**
+ * 一次累计确认推进时交给拥塞控制器的信息
+ */
+struct AckSample {
+  int acked_segments = 0;    /* 本次新确认的数据段数量 */
+  int inflight = 0;          /* 确认之后仍在途的数据段数量 */
+  bool in_recovery = false;  /* 会话是否处于丢包恢复中 */
+  int64_t now_us = 0;        /* 当前时间（微秒） */
+};
+
+/**
+ * CongestionController 是拥塞控制算法的接口。
+ * UdpSession 只负责检测事件（确认推进、丢包、超时、RTT 样本）并调用对应的钩子，
+ * 窗口大小和发送速率完全由具体算法决定。窗口单位为数据段。
+ */
+class CongestionController {
+ public:
+  virtual ~CongestionController() {}
+
+  /**
+   * 按算法创建控制器
+   * @param algorithm 算法
+   * @param mss 每个数据段的字节数，用于换算发送速率
+   */
+  static std::unique_ptr<CongestionController> Create(
+      CongestionAlgorithm algorithm, int mss);
+
+  /**
+   * 解析算法名称（reno / newreno / cubic / bbr）
+   * @return 名称合法返回 true
+   */
+  static bool ParseAlgorithm(const std::string &name,
+                             CongestionAlgorithm *algorithm);
+
+  /** 累计确认推进 */
+  virtual void OnAck(const AckSample &ack) = 0;
+
+  /** 进入一次新的丢包恢复（每个窗口最多调用一次） */
+  virtual void OnLoss(int64_t now_us) = 0;
+
+  /** 重传定时器超时 */
+  virtual void OnTimeout(int64_t now_us) = 0;
+
+  /** 得到一个有效的 RTT 样本（微秒） */
+  virtual void OnRttSample(int64_t rtt_us, int64_t now_us) = 0;
+
+  /** 当前拥塞窗口（数据段），至少为 1 */
+  virtual int cwnd() const = 0;
+
+  /** 建议的发送速率（字节/秒），0 表示算法不要求限速 */
+  virtual double pacing_rate() const { return 0; }
+
+  /** 是否处于慢启动（或 BBR 的 STARTUP）阶段，用于统计 */
+  virtual bool in_slow_start() const = 0;
+
+  /** 算法名称 */
+  virtual const char *name() const = 0;
+};
+}  // namespace safe_udp
@@ -0,0 +1,160 @@
+#include "crc32c.h"
+
+#include <string.h>
+
+#include <nmmintrin.h>
+
+namespace safe_udp {
+namespace {
+constexpr uint32_t REFLECTED_POLY = 0x82F63B78;
+
+/** slicing-by-8 的查表：table[k][b] 是字节 b 之后再跟 k 个 0 字节的 CRC */
+struct Tables {
+  uint32_t table[8][256];
+
+  Tables() {
+    for (uint32_t b = 0; b < 256; b++) {
+      uint32_t crc = b;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? REFLECTED_POLY : 0);
+      }
+      table[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+      for (int b = 0; b < 256; b++) {
+        uint32_t prev = table[k - 1][b];
+        table[k][b] = (prev >> 8) ^ table[0][prev & 0xFF];
+      }
+    }
+  }
+};
+
+const Tables &tables() {
+  static const Tables t;
+  return t;
+}
+
+uint32_t extendTable(uint32_t crc, const uint8_t *p, size_t length) {
+  const Tables &t = tables();
+  while (length >= 8) {
+    uint32_t low, high;
+    memcpy(&low, p, 4);
+    memcpy(&high, p + 4, 4);
+    low ^= crc;
+    crc = t.table[7][low & 0xFF] ^ t.table[6][(low >> 8) & 0xFF] ^
+          t.table[5][(low >> 16) & 0xFF] ^ t.table[4][low >> 24] ^
+          t.table[3][high & 0xFF] ^ t.table[2][(high >> 8) & 0xFF] ^
+          t.table[1][(high >> 16) & 0xFF] ^ t.table[0][high >> 24];
+    p += 8;
+    length -= 8;
+  }
+  while (length-- > 0) {
+    crc = (crc >> 8) ^ t.table[0][(crc ^ *p++) & 0xFF];
+  }
+  return crc;
+}
+
+__attribute__((target("sse4.2"))) uint32_t extendSse42(uint32_t crc,
+                                                       const uint8_t *p,
+                                                       size_t length) {
+  uint64_t crc64 = crc;
+  while (length >= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+    p += 8;
+    length -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (length-- > 0) {
+    crc = _mm_crc32_u8(crc, *p++);
+  }
+  return crc;
+}
+
+/** 反射表示下 a * b mod P，最高位是 x^0 */
+uint32_t multiplyModP(uint32_t a, uint32_t b) {
+  uint32_t m = 1u << 31;
+  uint32_t p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) {
+        break;
+      }
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ REFLECTED_POLY : b >> 1;
+  }
+  return p;
+}
+
+/** powers[k] = x^(2^k) mod P，用平方得到，按长度的二进制位相乘 */
+struct Powers {
+  uint32_t powers[64];
+
+  Powers() {
+    uint32_t p = 1u << 30; /* x^1 */
+    for (int k = 0; k < 64; k++) {
+      powers[k] = p;
+      p = multiplyModP(p, p);
+    }
+  }
+};
+
+const Powers &powers() {
+  static const Powers p;
+  return p;
+}
+
+typedef uint32_t (*ExtendFn)(uint32_t, const uint8_t *, size_t);
+
+struct Kernel {
+  ExtendFn fn;
+  const char *name;
+
+  Kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+      fn = extendSse42;
+      name = "sse4.2";
+    } else {
+      fn = extendTable;
+      name = "table";
+    }
+  }
+};
+
+const Kernel &kernel() {
+  static const Kernel k;
+  return k;
+}
+}  // namespace
+
+uint32_t Crc32c::Extend(uint32_t crc, const void *data, size_t length) {
+  /** 内部状态是取反后的 CRC，初值 0xFFFFFFFF 对应 Value 的初始 crc = 0 */
+  return ~kernel().fn(~crc, static_cast<const uint8_t *>(data), length);
+}
+
+uint32_t Crc32c::ShiftOperator(size_t length) {
+  const Powers &table = powers();
+  uint32_t op = 1u << 31; /* x^0 */
+  /** 以比特计：8 * length = length * 2^3 */
+  for (int k = 3; length > 0 && k < 64; k++, length >>= 1) {
+    if (length & 1) {
+      op = multiplyModP(table.powers[k], op);
+    }
+  }
+  return op;
+}
+
+uint32_t Crc32c::Combine(uint32_t crc_a, uint32_t crc_b, uint32_t shift) {
+  /**
+   * 取反的初值和结果对 a 后面补零的影响与 b 的长度无关，
+   * 在线性组合中正好抵消（与 zlib 的 crc32_combine 相同）
+   */
+  return multiplyModP(shift, crc_a) ^ crc_b;
+}
+
+const char *Crc32c::KernelName() { return kernel().name; }
+}  // namespace safe_udp
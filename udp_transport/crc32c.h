@@ -0,0 +1,41 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace safe_udp {
+/**
+ * Crc32c 类计算 CRC32C（Castagnoli 多项式 0x1EDC6F41，反射形式 0x82F63B78），
+ * 用于数据段的完整性校验。SSE4.2 的 crc32 指令直接实现该多项式，
+ * 每条指令处理 8 字节；CPU 不支持时使用 slicing-by-8 查表（8 张 256 项的表），
+ * 运行时选择。
+ */
+class Crc32c {
+ public:
+  /** data[0, length) 的 CRC32C */
+  static uint32_t Value(const void *data, size_t length) {
+    return Extend(0, data, length);
+  }
+
+  /**
+   * 在已有的 CRC 之后继续计算，Extend(Value(a), b) == Value(a + b)
+   * @param crc 前面数据的 CRC32C
+   */
+  static uint32_t Extend(uint32_t crc, const void *data, size_t length);
+
+  /**
+   * 把 CRC 后移 length 个字节的算子 x^(8 * length) mod P，
+   * 长度固定时算一次，供 Combine 重复使用
+   */
+  static uint32_t ShiftOperator(size_t length);
+
+  /**
+   * 由两段数据各自的 CRC 得到拼接后的 CRC：
+   * Combine(Value(a), Value(b), ShiftOperator(|b|)) == Value(a + b)。
+   * 只需要一次 GF(2) 多项式乘法，与 b 的长度无关
+   */
+  static uint32_t Combine(uint32_t crc_a, uint32_t crc_b, uint32_t shift);
+
+  /** 当前使用的实现："sse4.2" 或 "table" */
+  static const char *KernelName();
+};
+}  // namespace safe_udp
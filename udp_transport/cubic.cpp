@@ -0,0 +1,105 @@
+#include "cubic.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace safe_udp {
+/** RFC 8312 推荐参数 */
+constexpr double CUBIC_C = 0.4;
+constexpr double CUBIC_BETA = 0.7;
+constexpr double INITIAL_SSTHRESH = 128;
+constexpr double MIN_CWND = 2;
+/** 每个 RTT 的目标窗口不超过当前窗口的倍数（RFC 9438 第 4.2 节） */
+constexpr double MAX_TARGET_GROWTH = 1.5;
+
+Cubic::Cubic()
+    : cwnd_(1),
+      ssthresh_(INITIAL_SSTHRESH),
+      w_max_(0),
+      w_last_max_(0),
+      w_est_(0),
+      k_(0),
+      origin_(0),
+      epoch_start_(0),
+      min_rtt_(0) {}
+
+void Cubic::OnAck(const AckSample &ack) {
+  if (ack.in_recovery) {
+    return;
+  }
+  if (cwnd_ < ssthresh_) {
+    cwnd_ += ack.acked_segments;
+    return;
+  }
+
+  /** 新周期开始：计算三次函数回到 W_max 所需的时间 K */
+  if (epoch_start_ == 0) {
+    epoch_start_ = ack.now_us;
+    w_est_ = cwnd_;
+    if (cwnd_ < w_max_) {
+      k_ = std::cbrt((w_max_ - cwnd_) / CUBIC_C);
+      origin_ = w_max_;
+    } else {
+      k_ = 0;
+      origin_ = cwnd_;
+    }
+  }
+
+  /**
+   * 目标窗口取一个 RTT 之后的三次函数值，但不超过当前窗口的 1.5 倍：
+   * 长时间没有丢包后三次函数增长很快，不加限制时窗口一轮就可能翻倍以上
+   */
+  double t = (ack.now_us - epoch_start_ + min_rtt_) / 1e6;
+  double target = std::min(origin_ + CUBIC_C * std::pow(t - k_, 3),
+                           MAX_TARGET_GROWTH * cwnd_);
+
+  double increment;
+  if (target > cwnd_) {
+    increment = (target - cwnd_) / cwnd_;
+  } else {
+    increment = 0.01 / cwnd_;
+  }
+  cwnd_ += increment * ack.acked_segments;
+
+  /** TCP 友好区域：不低于同等条件下 Reno 的窗口 */
+  w_est_ += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) * ack.acked_segments /
+            cwnd_;
+  if (w_est_ > cwnd_) {
+    cwnd_ = w_est_;
+  }
+}
+
+/**
+ * 快速收敛：如果这次丢包时的窗口比上次还小，说明有新流加入，
+ * 主动让出一部分带宽
+ */
+void Cubic::reduce() {
+  epoch_start_ = 0;
+  if (cwnd_ < w_last_max_) {
+    w_last_max_ = cwnd_;
+    w_max_ = cwnd_ * (1 + CUBIC_BETA) / 2;
+  } else {
+    w_last_max_ = cwnd_;
+    w_max_ = cwnd_;
+  }
+  ssthresh_ = std::max(cwnd_ * CUBIC_BETA, MIN_CWND);
+}
+
+void Cubic::OnLoss(int64_t /*now_us*/) {
+  reduce();
+  cwnd_ = ssthresh_;
+}
+
+void Cubic::OnTimeout(int64_t /*now_us*/) {
+  reduce();
+  cwnd_ = 1;
+}
+
+void Cubic::OnRttSample(int64_t rtt_us, int64_t /*now_us*/) {
+  if (rtt_us > 0 && (min_rtt_ == 0 || rtt_us < min_rtt_)) {
+    min_rtt_ = rtt_us;
+  }
+}
+
+int Cubic::cwnd() const { return std::max(1, (int)cwnd_); }
+}  // namespace safe_udp
@@ -0,0 +1,37 @@
+#pragma once
+#include "congestion_controller.h"
+
+namespace safe_udp {
+/**
+ * CUBIC（RFC 8312）：拥塞避免阶段窗口按距上次丢包时间的三次函数增长，
+ * 在上次丢包时的窗口 W_max 附近放缓，越过后加速探测；
+ * 同时维护一个与 Reno 等价的估计窗口，保证在小 BDP 链路上不比 Reno 慢。
+ */
+class Cubic : public CongestionController {
+ public:
+  Cubic();
+
+  void OnAck(const AckSample &ack) override;
+  void OnLoss(int64_t now_us) override;
+  void OnTimeout(int64_t now_us) override;
+  void OnRttSample(int64_t rtt_us, int64_t now_us) override;
+
+  int cwnd() const override;
+  bool in_slow_start() const override { return cwnd_ < ssthresh_; }
+  const char *name() const override { return "cubic"; }
+
+ private:
+  /** 记录丢包时的窗口并开始新的增长周期 */
+  void reduce();
+
+  double cwnd_;           /* 拥塞窗口 */
+  double ssthresh_;       /* 慢启动阈值 */
+  double w_max_;          /* 上次丢包时的窗口 */
+  double w_last_max_;     /* 再上一次丢包时的窗口，用于快速收敛 */
+  double w_est_;          /* Reno 等价窗口估计 */
+  double k_;              /* 三次函数回到 W_max 所需的时间（秒） */
+  double origin_;         /* 三次函数的平台点 */
+  int64_t epoch_start_;   /* 本增长周期开始时间（微秒），0 表示尚未开始 */
+  int64_t min_rtt_;       /* 观察到的最小 RTT（微秒） */
+};
+}  // namespace safe_udp
@@ -6,6 +6,10 @@
 #include <iostream>
 #include <string>
 
+#include "crc32c.h"
+#include "packet_buffer_pool.h"
+#include "segment_view.h"
+
 namespace safe_udp {
 /**
  * 构造函数，初始化数据段的基本字段
@@ -17,119 +21,163 @@ DataSegment::DataSegment() {
 }
 
 /**
- * 将数据段序列化为字符数组，用于网络传输
- * @return 返回序列化后的字节流指针
+ * 拷贝构造函数，序列化缓冲区不随对象拷贝
  */
-char* DataSegment::SerializeToCharArray() {
+DataSegment::DataSegment(const DataSegment& other)
+    : seqNumber(other.seqNumber),
+      ackNum(other.ackNum),
+      ackFlag(other.ackFlag),
+      finflag(other.finflag),
+      synFlag(other.synFlag),
+      connectionId(other.connectionId),
+      dataLength(other.dataLength),
+      timestamp(other.timestamp),
+      data_(other.data_) {}
+
+DataSegment& DataSegment::operator=(const DataSegment& other) {
+  seqNumber = other.seqNumber;
+  ackNum = other.ackNum;
+  ackFlag = other.ackFlag;
+  finflag = other.finflag;
+  synFlag = other.synFlag;
+  connectionId = other.connectionId;
+  dataLength = other.dataLength;
+  timestamp = other.timestamp;
+  data_ = other.data_;
+  return *this;
+}
+
+/**
+ * 析构函数，归还序列化缓冲区
+ */
+DataSegment::~DataSegment() {
   if (finalDataPacket != nullptr) {
-    memset(finalDataPacket, 0, MAX_PACKET_SIZE); /**< 如果缓冲区已存在，清空 */
-  } else {
-    /**
-     * 分配新的缓冲区内存
-     */
-    finalDataPacket =
-        reinterpret_cast<char*>(calloc(MAX_PACKET_SIZE, sizeof(char)));
-    if (finalDataPacket == nullptr) {
-      return nullptr; /**< 内存分配失败 */
-    }
+    PacketBufferPool::Local().Release(finalDataPacket);
   }
+}
 
-  /**
-   * 将序列号写入数据包头部（4字节）
-   */
-  memcpy(finalDataPacket, &seqNumber, sizeof(seqNumber));
-
-  /**
-   * 将确认号写入数据包头部（4字节）
-   */
-  memcpy(finalDataPacket + 4, &ackNum, sizeof(ackNum));
+/**
+ * 将数据段序列化为字符数组，用于网络传输
+ * @return 返回序列化后的字节流指针，生命周期与本对象相同
+ */
+char* DataSegment::SerializeToCharArray() {
+  if (finalDataPacket == nullptr) {
+    finalDataPacket = PacketBufferPool::Local().Acquire();
+  }
+  memset(finalDataPacket, 0, MAX_PACKET_SIZE);
+  SerializeTo(finalDataPacket);
+  return finalDataPacket;
+}
 
-  /**
-   * 写入 ACK 标志（1字节）
-   */
-  memcpy((finalDataPacket + 8), &ackFlag, 1);
+/**
+ * 将头部和载荷序列化到调用方提供的缓冲区
+ * @param buffer 至少 MAX_PACKET_SIZE 字节的缓冲区
+ * @return 数据报长度（头部加载荷）
+ */
+int DataSegment::SerializeTo(char* buffer) const {
+  SerializeHeader(buffer);
+  if (data_ != nullptr && dataLength > 0) {
+    memcpy(buffer + HEADER_LENGTH, data_, dataLength);
+    return HEADER_LENGTH + dataLength;
+  }
+  return HEADER_LENGTH;
+}
 
-  /**
-   * 写入 FIN 标志（1字节）
-   */
-  memcpy((finalDataPacket + 9), &finflag, 1);
+/**
+ * 将头部序列化到调用方提供的缓冲区
+ * @param buffer 至少 HEADER_LENGTH 字节的缓冲区
+ */
+void DataSegment::SerializeHeader(char* buffer) const {
+  serializeFields(buffer);
 
   /**
-   * 写入数据长度（2字节）
+   * 写入 CRC32C 校验和（4字节），覆盖前面的头部字段和载荷
    */
-  memcpy((finalDataPacket + 10), &dataLength, sizeof(dataLength));
+  uint32_t checksum = Crc32c::Value(buffer, CHECKSUM_OFFSET);
+  if (data_ != nullptr && dataLength > 0) {
+    checksum = Crc32c::Extend(checksum, data_, dataLength);
+  }
+  StoreBigEndian32(buffer + CHECKSUM_OFFSET, checksum);
+}
 
-  /**
-   * 写入实际数据
-   */
-  memcpy((finalDataPacket + 12), data_, dataLength);
+/**
+ * 用已知的载荷 CRC 序列化头部：头部的 CRC 后移载荷长度后与载荷 CRC 异或。
+ * 满长度数据段的后移算子只算一次
+ * @param buffer 至少 HEADER_LENGTH 字节的缓冲区
+ * @param payload_crc data_ 指向的 dataLength 字节载荷的 CRC32C
+ */
+void DataSegment::SerializeHeader(char* buffer, uint32_t payload_crc) const {
+  static const uint32_t full_shift = Crc32c::ShiftOperator(MAX_DATA_SIZE);
+  serializeFields(buffer);
+  uint32_t shift = dataLength == MAX_DATA_SIZE
+                       ? full_shift
+                       : Crc32c::ShiftOperator(dataLength);
+  uint32_t checksum = Crc32c::Combine(Crc32c::Value(buffer, CHECKSUM_OFFSET),
+                                      payload_crc, shift);
+  StoreBigEndian32(buffer + CHECKSUM_OFFSET, checksum);
+}
 
-  return finalDataPacket;
+/**
+ * 写入校验和之前的头部字段，偏移和字节序由 wire_format.h 定义
+ * @param buffer 至少 CHECKSUM_OFFSET 字节的缓冲区
+ */
+void DataSegment::serializeFields(char* buffer) const {
+  buffer[VERSION_OFFSET] = WIRE_VERSION;
+  buffer[FLAGS_OFFSET] = (ackFlag ? WIRE_FLAG_ACK : 0) |
+                         (finflag ? WIRE_FLAG_FIN : 0) |
+                         (synFlag ? WIRE_FLAG_SYN : 0);
+  StoreBigEndian16(buffer + LENGTH_OFFSET, dataLength);
+  StoreBigEndian32(buffer + CONNECTION_ID_OFFSET, connectionId);
+  StoreBigEndian32(buffer + SEQ_OFFSET, (uint32_t)seqNumber);
+  StoreBigEndian32(buffer + ACK_OFFSET, (uint32_t)ackNum);
+  StoreBigEndian64(buffer + TIMESTAMP_OFFSET, (uint64_t)timestamp);
 }
 
 /**
  * 从字节流反序列化为 DataSegment 对象
  * @param data_segment 数据包字节流
  * @param length 数据长度
+ * @return 数据报完整且校验和正确返回 true
  */
-void DataSegment::DeserializeToDataSegment(unsigned char* data_segment,
+bool DataSegment::DeserializeToDataSegment(unsigned char* data_segment,
                                            int length) {
-  seqNumber = convert_to_uint32(data_segment, 0);   /**< 提取序列号 */
-  ackNum = convert_to_uint32(data_segment, 4);      /**< 提取确认号 */
-  ackFlag = convert_to_bool(data_segment, 8);       /**< 提取 ACK 标志 */
-  finflag = convert_to_bool(data_segment, 9);       /**< 提取 FIN 标志 */
-  dataLength = convert_to_uint16(data_segment, 10); /**< 提取数据长度 */
-
   /**
-   * 分配内存存储数据部分
+   * 先校验：头部不完整、长度不符或校验和不符时整个数据报都不可信
    */
-  data_ = reinterpret_cast<char*>(calloc(length + 1, sizeof(char)));
-  if (data_ == nullptr) {
-    return;
+  SegmentView view;
+  if (!view.Parse(data_segment, length)) {
+    return false;
   }
 
+  seqNumber = (int)view.seq_number();
+  ackNum = (int)view.ack_number();
+  ackFlag = view.ack();
+  finflag = view.fin();
+  synFlag = view.syn();
+  connectionId = view.connection_id();
+  dataLength = view.payload_length();
+  timestamp = view.timestamp();
+
   /**
-   * 拷贝数据部分到 data_ 成员变量
+   * 数据部分直接引用接收缓冲区，不做拷贝
    */
-  memcpy(data_, data_segment + HEADER_LENGTH, length);
-  *(data_ + length) = '\0'; /**< 添加字符串结束符 */
-}
-
-/**
- * 将字节流中的4字节转换为 uint32_t 类型
- * @param buffer 字节流
- * @param start_index 起始索引
- * @return 转换后的 uint32_t 值
- */
-uint32_t DataSegment::convert_to_uint32(unsigned char* buffer,
-                                        int start_index) {
-  uint32_t uint32_value =
-      (buffer[start_index + 3] << 24) | (buffer[start_index + 2] << 16) |
-      (buffer[start_index + 1] << 8) | (buffer[start_index]);
-  return uint32_value;
-}
-
-/**
- * 将字节流中的2字节转换为 uint16_t 类型
- * @param buffer 字节流
- * @param start_index 起始索引
- * @return 转换后的 uint16_t 值
- */
-uint16_t DataSegment::convert_to_uint16(unsigned char* buffer,
-                                        int start_index) {
-  uint16_t uint16_value =
-      (buffer[start_index + 1] << 8) | (buffer[start_index]);
-  return uint16_value;
+  data_ = dataLength > 0 ? view.payload() : nullptr;
+  return true;
 }
 
 /**
- * 将字节流中的1字节转换为 bool 类型
- * @param buffer 字节流
- * @param index 索引位置
- * @return 转换后的 bool 值
+ * 读出数据报头部的连接 ID，只检查长度和版本，校验和由会话在 Parse 时检查。
+ * 文件请求以魔数 "SURQ" 开头，第一个字节不是版本号
+ * @param buffer 数据报内容
+ * @param length 数据报长度
+ * @param connection_id 输出连接 ID
  */
-bool DataSegment::convert_to_bool(unsigned char* buffer, int index) {
-  bool bool_value = buffer[index];
-  return bool_value;
+bool DataSegment::PeekConnectionId(const unsigned char* buffer, int length,
+                                   uint32_t* connection_id) {
+  if (length < HEADER_LENGTH || buffer[VERSION_OFFSET] != WIRE_VERSION) {
+    return false;
+  }
+  *connection_id = LoadBigEndian32(buffer + CONNECTION_ID_OFFSET);
+  return true;
 }
 }  // namespace safe_udp
\ No newline at end of file
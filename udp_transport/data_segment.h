@@ -2,32 +2,82 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "wire_format.h"
+
 namespace safe_udp {
 /* 定义最大数据包大小为1472字节 */
 constexpr int MAX_PACKET_SIZE = 1472;
-/* 定义最大数据载荷大小为1460字节 */
-constexpr int MAX_DATA_SIZE = 1460;
-/* 定义协议头部长度为12字节 */
-constexpr int HEADER_LENGTH = 12;
+/* 定义最大数据载荷大小为1444字节，头部加载荷不超过 MAX_PACKET_SIZE */
+constexpr int MAX_DATA_SIZE = MAX_PACKET_SIZE - HEADER_LENGTH;
+/* 一个 ACK 最多携带的 SACK 块数量 */
+constexpr int MAX_SACK_BLOCKS = 8;
+
+/*
+ * SACK 块：接收方已收到的一段连续序列号区间 [start, end)。
+ * ACK 数据段的载荷由 dataLength / SACK_BLOCK_LENGTH 个 SACK 块组成，
+ * 每个块是两个网络字节序的 32 位序列号。
+ */
+struct SackBlock {
+  int32_t start;
+  int32_t end;
 
-/* DataSegment 类用于处理UDP传输中的数据分段，包括序列化与反序列化操作 */
+  /* 写入 SACK_BLOCK_LENGTH 字节 */
+  void SerializeTo(char* buffer) const {
+    StoreBigEndian32(buffer, start);
+    StoreBigEndian32(buffer + 4, end);
+  }
+  /* 从 SACK_BLOCK_LENGTH 字节解析 */
+  static SackBlock Parse(const char* buffer) {
+    return SackBlock{(int32_t)LoadBigEndian32(buffer),
+                     (int32_t)LoadBigEndian32(buffer + 4)};
+  }
+};
+/* 一个 SACK 块在 ACK 载荷中的长度 */
+constexpr int SACK_BLOCK_LENGTH = 8;
+
+/*
+ * DataSegment 类用于处理UDP传输中的数据分段，包括序列化与反序列化操作。
+ * data_ 是不拥有内存的视图：发送时指向文件映射区，接收时指向接收缓冲区，
+ * 载荷需要保留更久时由调用方拷贝到 PacketBufferPool 的缓冲区中。
+ */
 class DataSegment {
  public:
   /* 构造函数，初始化资源 */
   DataSegment();
-  /* 析构函数，释放分配的内存 */
-  ~DataSegment() {
-    if (!finalDataPacket) {
-      free(finalDataPacket);
-    }
-  }
+  /* 拷贝时只复制字段和载荷指针，不共享序列化缓冲区 */
+  DataSegment(const DataSegment& other);
+  DataSegment& operator=(const DataSegment& other);
+  /* 析构函数，把序列化缓冲区归还给缓冲池 */
+  ~DataSegment();
 
-  /* 将数据段序列化为字符数组，供网络传输使用 */
+  /* 将数据段序列化为字符数组，供网络传输使用；缓冲区归本对象所有 */
   char* SerializeToCharArray();
-  /* 从接收到的数据反序列化填充当前数据段对象 */
-  void DeserializeToDataSegment(unsigned char* data_segment, int length);
+  /* 将头部和载荷序列化到 buffer（至少 MAX_PACKET_SIZE 字节），返回数据报长度 */
+  int SerializeTo(char* buffer) const;
+  /*
+   * 只序列化 HEADER_LENGTH 字节的头部到 buffer，载荷由调用方另行发送；
+   * 校验和按 data_ 指向的 dataLength 字节载荷计算
+   */
+  void SerializeHeader(char* buffer) const;
+  /*
+   * 同上，但载荷的 CRC32C 已经算好（来自包缓存）：只计算 24 字节的头部，
+   * 再与载荷的 CRC 合并，不再读取载荷
+   */
+  void SerializeHeader(char* buffer, uint32_t payload_crc) const;
+  /*
+   * 从接收到的数据反序列化填充当前数据段对象，data_ 直接指向 data_segment 内部。
+   * 由 SegmentView 检查：数据报短于头部、版本不符、载荷长度不符
+   * 或 CRC32C 校验失败时返回 false，调用方应当把它当作丢失
+   */
+  bool DeserializeToDataSegment(unsigned char* data_segment, int length);
+  /*
+   * 不做完整解析，只取出数据报头部的连接 ID，供服务器按连接 ID 分发；
+   * 数据报短于头部或版本不符时返回 false
+   */
+  static bool PeekConnectionId(const unsigned char* buffer, int length,
+                               uint32_t* connection_id);
 
-  /* 数据段的序列号 */
+  /* 数据段的序列号（线上为无符号 32 位，文件长度不超过 INT_MAX，在内存中用 int 表示） */
   int seqNumber;
   /* 确认号，用于确认收到的数据段 */
   int ackNum;
@@ -35,19 +85,24 @@ class DataSegment {
   bool ackFlag;
   /* 标志位，表示是否为结束数据段 */
   bool finflag;
+  /* 标志位，表示是否为握手数据段 */
+  bool synFlag = false;
+  /* 连接 ID，由服务器在握手时分配 */
+  uint32_t connectionId = 0;
   /* 数据段总长度 */
   uint16_t dataLength;
-  /* 指向实际数据的指针，默认初始化为空 */
-  char* data_ = nullptr;
+  /*
+   * 时间戳（CLOCK_MONOTONIC 纳秒）：数据段中是发送方的发送时间，
+   * ACK 中是接收方回显的、触发该 ACK 的数据段的时间戳，0 表示没有
+   */
+  int64_t timestamp = 0;
+  /* 指向实际数据的指针（不拥有内存），默认初始化为空 */
+  const char* data_ = nullptr;
 
  private:
-  /* 从缓冲区指定位置提取32位无符号整数 */
-  uint32_t convert_to_uint32(unsigned char* buffer, int start_index);
-  /* 从缓冲区指定位置提取布尔值 */
-  bool convert_to_bool(unsigned char* buffer, int index);
-  /* 从缓冲区指定位置提取16位无符号整数 */
-  uint16_t convert_to_uint16(unsigned char* buffer, int start_index);
-  /* 存储序列化后的最终数据包 */
+  /* 写入校验和之前的头部字段 */
+  void serializeFields(char* buffer) const;
+  /* 存储序列化后的最终数据包，来自 PacketBufferPool */
   char* finalDataPacket = nullptr;
 };
 }  // namespace safe_udp
\ No newline at end of file
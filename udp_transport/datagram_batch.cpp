@@ -0,0 +1,284 @@
+#include "datagram_batch.h"
+
+#include <errno.h>
+#include <netinet/udp.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "data_segment.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace safe_udp {
+/* 一个 GSO 消息最多包含的数据报数量（内核 UDP_MAX_SEGMENTS） */
+constexpr int MAX_GSO_SEGMENTS = 64;
+
+/**
+ * 构造函数，预先分配全部槽位，发送路径上不再分配内存
+ */
+SendBatch::SendBatch(int sockfd, const struct sockaddr_in &dest, int capacity)
+    : sockfd_(sockfd),
+      dest_(dest),
+      capacity_(std::max(1, std::min(capacity, MAX_BATCH_SIZE))),
+      count_(0),
+      gso_enabled_(false),
+      syscall_count_(0),
+      datagram_count_(0),
+      buffers_(capacity_ * MAX_PACKET_SIZE),
+      iovecs_(capacity_ * 2),
+      lengths_(capacity_),
+      msgs_(capacity_),
+      gso_msgs_(capacity_),
+      gso_counts_(capacity_),
+      gso_control_(capacity_ * CMSG_SPACE(sizeof(uint16_t))) {
+  memset(msgs_.data(), 0, sizeof(struct mmsghdr) * capacity_);
+  for (int i = 0; i < capacity_; i++) {
+    iovecs_[i * 2].iov_base = &buffers_[i * MAX_PACKET_SIZE];
+    msgs_[i].msg_hdr.msg_iov = &iovecs_[i * 2];
+    msgs_[i].msg_hdr.msg_iovlen = 2;
+    msgs_[i].msg_hdr.msg_name = &dest_;
+    msgs_[i].msg_hdr.msg_namelen = sizeof(dest_);
+  }
+}
+
+/**
+ * 通过设置 UDP_SEGMENT 为 0（即不分段）检测内核是否支持 GSO
+ */
+bool SendBatch::ProbeGso(int sockfd) {
+  int gso_size = 0;
+  return setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &gso_size,
+                    sizeof(gso_size)) == 0;
+}
+
+/**
+ * 将头部拷贝到下一个空闲槽位，载荷只挂接指针；队列满时先发送已有数据
+ */
+void SendBatch::Append(const char *header, int header_length,
+                       const char *payload, int payload_length) {
+  if (count_ == capacity_) {
+    Flush();
+  }
+  struct iovec *iov = &iovecs_[count_ * 2];
+  memcpy(iov[0].iov_base, header, header_length);
+  iov[0].iov_len = header_length;
+  iov[1].iov_base = const_cast<char *>(payload);
+  iov[1].iov_len = payload != nullptr ? payload_length : 0;
+  lengths_[count_] = iov[0].iov_len + iov[1].iov_len;
+  count_++;
+}
+
+/**
+ * 发送队列中的全部数据报。
+ * socket 为非阻塞模式，发送缓冲区满时剩余数据报按丢包处理，由重传恢复。
+ */
+int SendBatch::Flush() {
+  int sent = 0;
+  if (gso_enabled_) {
+    sent = flushGso();
+  }
+  if (!gso_enabled_ && sent < count_) {
+    sent += flushPlain(sent);
+  }
+  datagram_count_ += sent;
+  count_ = 0;
+  return sent;
+}
+
+/**
+ * 使用 sendmmsg 逐个数据报发送
+ */
+int SendBatch::flushPlain(int start) {
+  int sent = start;
+  while (sent < count_) {
+    int n = sendmmsg(sockfd_, &msgs_[sent], count_ - sent, 0);
+    syscall_count_++;
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(INFO) << "sendmmsg failed, " << count_ - sent
+                << " segments will be retransmitted";
+      break;
+    }
+    sent += n;
+  }
+  return sent - start;
+}
+
+/**
+ * 把连续的数据报分组：组内除最后一个外长度都等于第一个数据报的长度，
+ * 且总长度不超过 MAX_GSO_BYTES。每组构造一个 UDP_SEGMENT 消息，
+ * 所有分组再通过一次 sendmmsg 发出。
+ */
+int SendBatch::flushGso() {
+  int groups = 0;
+  int i = 0;
+  while (i < count_) {
+    int segment_size = lengths_[i];
+    int bytes = segment_size;
+    int j = i + 1;
+    while (j < count_ && j - i < MAX_GSO_SEGMENTS &&
+           lengths_[j - 1] == segment_size && lengths_[j] <= segment_size &&
+           bytes + lengths_[j] <= MAX_GSO_BYTES) {
+      bytes += lengths_[j];
+      j++;
+    }
+
+    struct msghdr &hdr = gso_msgs_[groups].msg_hdr;
+    memset(&gso_msgs_[groups], 0, sizeof(struct mmsghdr));
+    hdr.msg_name = &dest_;
+    hdr.msg_namelen = sizeof(dest_);
+    hdr.msg_iov = &iovecs_[i * 2];
+    hdr.msg_iovlen = (j - i) * 2;
+    if (j - i > 1) {
+      char *control = &gso_control_[groups * CMSG_SPACE(sizeof(uint16_t))];
+      memset(control, 0, CMSG_SPACE(sizeof(uint16_t)));
+      hdr.msg_control = control;
+      hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t gso_size = segment_size;
+      memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+    }
+    gso_counts_[groups] = j - i;
+    groups++;
+    i = j;
+  }
+
+  int sent_groups = 0;
+  int sent = 0;
+  while (sent_groups < groups) {
+    int n = sendmmsg(sockfd_, &gso_msgs_[sent_groups], groups - sent_groups, 0);
+    syscall_count_++;
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ||
+          errno == EOPNOTSUPP) {
+        /** 设备或内核拒绝 GSO，退回普通批量发送 */
+        LOG(WARNING) << "UDP GSO rejected (errno " << errno
+                     << "), falling back to sendmmsg";
+        gso_enabled_ = false;
+      } else {
+        LOG(INFO) << "sendmmsg failed, " << count_ - sent
+                  << " segments will be retransmitted";
+      }
+      break;
+    }
+    for (int k = sent_groups; k < sent_groups + n; k++) {
+      sent += gso_counts_[k];
+    }
+    sent_groups += n;
+  }
+  return sent;
+}
+
+/**
+ * 构造函数，预先分配接收缓冲区
+ */
+RecvBatch::RecvBatch(int capacity)
+    : capacity_(std::max(1, std::min(capacity, MAX_BATCH_SIZE))),
+      slot_size_(MAX_PACKET_SIZE + 1),
+      gro_enabled_(false),
+      syscall_count_(0),
+      datagram_count_(0) {
+  allocate();
+}
+
+/**
+ * 开启 UDP_GRO。内核合并的数据报最长为 MAX_GSO_BYTES，因此同时扩大接收槽位。
+ */
+bool RecvBatch::EnableGro(int sockfd) {
+  int enable = 1;
+  if (setsockopt(sockfd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) < 0) {
+    LOG(WARNING) << "UDP GRO not supported, using plain recvmmsg";
+    return false;
+  }
+  gro_enabled_ = true;
+  slot_size_ = MAX_GSO_BYTES + 1;
+  allocate();
+  return true;
+}
+
+void RecvBatch::allocate() {
+  buffers_.assign(capacity_ * slot_size_, 0);
+  addresses_.resize(capacity_);
+  iovecs_.resize(capacity_);
+  msgs_.resize(capacity_);
+  control_.assign(capacity_ * CMSG_SPACE(sizeof(int)), 0);
+  /** GRO 模式下一个槽位可能拆出多个数据报 */
+  segments_.reserve(gro_enabled_ ? capacity_ * MAX_GSO_SEGMENTS : capacity_);
+}
+
+/**
+ * 调用一次 recvmmsg 读取尽可能多的数据报，GRO 合并的数据报按 gso_size 拆分
+ */
+int RecvBatch::Receive(int sockfd, int flags) {
+  memset(msgs_.data(), 0, sizeof(struct mmsghdr) * capacity_);
+  for (int i = 0; i < capacity_; i++) {
+    iovecs_[i].iov_base = &buffers_[i * slot_size_];
+    iovecs_[i].iov_len = slot_size_ - 1;
+    msgs_[i].msg_hdr.msg_iov = &iovecs_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+    msgs_[i].msg_hdr.msg_name = &addresses_[i];
+    msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    if (gro_enabled_) {
+      msgs_[i].msg_hdr.msg_control = &control_[i * CMSG_SPACE(sizeof(int))];
+      msgs_[i].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(int));
+    }
+  }
+
+  int n = recvmmsg(sockfd, msgs_.data(), capacity_, flags, NULL);
+  syscall_count_++;
+  if (n <= 0) {
+    return n;
+  }
+
+  segments_.clear();
+  for (int i = 0; i < n; i++) {
+    unsigned char *data =
+        reinterpret_cast<unsigned char *>(&buffers_[i * slot_size_]);
+    int length = msgs_[i].msg_len;
+    int segment_size = length;
+
+    if (gro_enabled_) {
+      for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs_[i].msg_hdr);
+           cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs_[i].msg_hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+          int gso_size = 0;
+          memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+          if (gso_size > 0) {
+            segment_size = gso_size;
+          }
+        }
+      }
+    }
+
+    for (int offset = 0; offset < length; offset += segment_size) {
+      segments_.push_back(
+          {data + offset, std::min(segment_size, length - offset), i});
+    }
+    if (length == 0) {
+      segments_.push_back({data, 0, i});
+    }
+  }
+
+  datagram_count_ += segments_.size();
+  return segments_.size();
+}
+}  // namespace safe_udp
@@ -0,0 +1,171 @@
+#pragma once
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <vector>
+
+namespace safe_udp {
+/* 单次 sendmmsg/recvmmsg 最多处理的数据报数量 */
+constexpr int MAX_BATCH_SIZE = 64;
+/* 一个 GSO/GRO 超级数据报的最大长度（UDP 载荷上限） */
+constexpr int MAX_GSO_BYTES = 65507;
+
+/**
+ * SendBatch 类把发往同一个目的地址的多个数据报排队，
+ * 然后通过一次 sendmmsg 系统调用批量发出。
+ * 每个数据报由头部和载荷两个 iovec 组成，载荷可以直接指向文件映射区。
+ * 开启 GSO 后，连续的等长数据报被合并成一个带 UDP_SEGMENT 的超级数据报，
+ * 由内核（或网卡）负责切分。
+ */
+class SendBatch {
+ public:
+  /**
+   * 构造函数
+   * @param sockfd 发送使用的 socket 描述符
+   * @param dest 目的地址
+   * @param capacity 队列容量，队列满时自动 Flush
+   */
+  SendBatch(int sockfd, const struct sockaddr_in &dest,
+            int capacity = MAX_BATCH_SIZE);
+
+  /**
+   * 检测 socket 是否支持 UDP_SEGMENT
+   * @param sockfd socket 描述符
+   * @return 内核接受该选项返回 true
+   */
+  static bool ProbeGso(int sockfd);
+
+  /**
+   * 开启或关闭 GSO 发送
+   */
+  void SetGso(bool enable) { gso_enabled_ = enable; }
+
+  /** 当前是否使用 GSO 发送 */
+  bool gso_enabled() const { return gso_enabled_; }
+
+  /**
+   * 将一个数据报加入队列。头部被拷贝进槽位，载荷只记录指针，
+   * 载荷内存必须在下一次 Flush 之前保持有效。
+   * @param header 头部（也可以是完整的数据报）
+   * @param header_length 头部长度，不超过 MAX_PACKET_SIZE
+   * @param payload 载荷指针，可以为 nullptr
+   * @param payload_length 载荷长度
+   */
+  void Append(const char *header, int header_length,
+              const char *payload = nullptr, int payload_length = 0);
+
+  /**
+   * 发送队列中的全部数据报
+   * @return 成功交给内核的数据报数量
+   */
+  int Flush();
+
+  /** 队列中尚未发送的数据报数量 */
+  int Size() const { return count_; }
+
+  /** 累计发起的发送系统调用次数 */
+  long syscall_count() const { return syscall_count_; }
+
+  /** 累计发送的数据报数量 */
+  long datagram_count() const { return datagram_count_; }
+
+ private:
+  /**
+   * 逐个数据报通过 sendmmsg 发送 [start, count_) 范围内的数据报
+   * @return 成功发送的数据报数量
+   */
+  int flushPlain(int start);
+
+  /**
+   * 把队列按等长数据报分组，每组一个带 UDP_SEGMENT 的消息，通过 sendmmsg 发送
+   * @return 成功发送的数据报数量；GSO 被拒绝时关闭 gso_enabled_，
+   *         剩余数据报由 flushPlain 发送
+   */
+  int flushGso();
+
+  int sockfd_;                          /* socket 描述符 */
+  struct sockaddr_in dest_;             /* 目的地址 */
+  int capacity_;                        /* 队列容量 */
+  int count_;                           /* 当前排队的数据报数量 */
+  bool gso_enabled_;                    /* 是否使用 GSO */
+  long syscall_count_;                  /* 发送系统调用计数 */
+  long datagram_count_;                 /* 已发送数据报计数 */
+  std::vector<char> buffers_;           /* capacity_ 个 MAX_PACKET_SIZE 头部槽位 */
+  std::vector<struct iovec> iovecs_;    /* 每个槽位两个 iovec：头部 + 载荷 */
+  std::vector<int> lengths_;            /* 每个槽位的数据报总长度 */
+  std::vector<struct mmsghdr> msgs_;    /* sendmmsg 参数 */
+  std::vector<struct mmsghdr> gso_msgs_;  /* GSO 分组后的 sendmmsg 参数 */
+  std::vector<int> gso_counts_;           /* 每个 GSO 分组包含的数据报数量 */
+  std::vector<char> gso_control_;         /* 每个分组的 UDP_SEGMENT 控制消息 */
+};
+
+/**
+ * RecvBatch 类通过一次 recvmmsg 系统调用读取多个数据报，
+ * 并保存每个数据报的内容、长度和来源地址。
+ * 开启 GRO 后，内核合并的超级数据报会按 gso_size 拆回原始数据报。
+ */
+class RecvBatch {
+ public:
+  /**
+   * 构造函数
+   * @param capacity 单次最多接收的数据报数量
+   */
+  explicit RecvBatch(int capacity = MAX_BATCH_SIZE);
+
+  /**
+   * 在 socket 上开启 UDP_GRO，并把接收槽位扩大到 MAX_GSO_BYTES
+   * @param sockfd socket 描述符
+   * @return 内核接受该选项返回 true，否则保持普通接收模式
+   */
+  bool EnableGro(int sockfd);
+
+  /**
+   * 从 socket 读取一批数据报
+   * @param sockfd socket 描述符
+   * @param flags recvmmsg 标志，例如 MSG_DONTWAIT 或 MSG_WAITFORONE
+   * @return 读取到的数据报数量（GRO 合并的数据报按拆分后计数），
+   *         出错时返回 -1（errno 保留）
+   */
+  int Receive(int sockfd, int flags);
+
+  /** 第 index 个数据报的内容 */
+  unsigned char *data(int index) { return segments_[index].data; }
+
+  /** 第 index 个数据报的长度 */
+  int length(int index) const { return segments_[index].length; }
+
+  /** 第 index 个数据报的来源地址 */
+  const struct sockaddr_in &address(int index) const {
+    return addresses_[segments_[index].slot];
+  }
+
+  /** 累计发起的接收系统调用次数 */
+  long syscall_count() const { return syscall_count_; }
+
+  /** 累计接收的数据报数量 */
+  long datagram_count() const { return datagram_count_; }
+
+ private:
+  /** 拆分后的单个数据报 */
+  struct Segment {
+    unsigned char *data; /* 数据报起始位置 */
+    int length;          /* 数据报长度 */
+    int slot;            /* 所在的接收槽位 */
+  };
+
+  /** 按当前槽位大小重新分配接收缓冲区 */
+  void allocate();
+
+  int capacity_;                               /* 批量容量 */
+  int slot_size_;                              /* 每个槽位大小 */
+  bool gro_enabled_;                           /* 是否开启 GRO */
+  long syscall_count_;                         /* 接收系统调用计数 */
+  long datagram_count_;                        /* 已接收数据报计数 */
+  std::vector<char> buffers_;                  /* 接收缓冲区 */
+  std::vector<struct sockaddr_in> addresses_;  /* 来源地址 */
+  std::vector<struct iovec> iovecs_;           /* 每个槽位对应的 iovec */
+  std::vector<struct mmsghdr> msgs_;           /* recvmmsg 参数 */
+  std::vector<char> control_;                  /* 每个槽位的控制消息缓冲区 */
+  std::vector<Segment> segments_;              /* 拆分后的数据报 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,163 @@
+#include "fec_codec.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "gf256.h"
+
+namespace safe_udp {
+namespace {
+/**
+ * Cauchy 矩阵 C[j][i] = 1 / (x_j + y_i)，x_j = MAX_FEC_BLOCK + j，y_i = i，
+ * 各 x、y 互不相同；再令 A[j][i] = C[j][i] / C[0][i]，第 0 行全为 1。
+ * 列缩放不改变子阵是否可逆。
+ */
+struct Matrix {
+  uint8_t coef[MAX_FEC_PARITY][MAX_FEC_BLOCK];
+
+  Matrix() {
+    for (int i = 0; i < MAX_FEC_BLOCK; i++) {
+      uint8_t c0 = Gf256::Inv((MAX_FEC_BLOCK + 0) ^ i);
+      for (int j = 0; j < MAX_FEC_PARITY; j++) {
+        uint8_t c = Gf256::Inv((MAX_FEC_BLOCK + j) ^ i);
+        coef[j][i] = Gf256::Mul(c, Gf256::Inv(c0));
+      }
+    }
+  }
+};
+
+const Matrix &matrix() {
+  static const Matrix m;
+  return m;
+}
+
+/** GF(2^8) 上 n x n 矩阵求逆（Gauss-Jordan），不可逆时返回 false */
+bool invert(std::vector<uint8_t> *a, int n, std::vector<uint8_t> *inv) {
+  inv->assign(n * n, 0);
+  for (int i = 0; i < n; i++) {
+    (*inv)[i * n + i] = 1;
+  }
+  for (int col = 0; col < n; col++) {
+    int pivot = col;
+    while (pivot < n && (*a)[pivot * n + col] == 0) {
+      pivot++;
+    }
+    if (pivot == n) {
+      return false;
+    }
+    if (pivot != col) {
+      for (int k = 0; k < n; k++) {
+        std::swap((*a)[pivot * n + k], (*a)[col * n + k]);
+        std::swap((*inv)[pivot * n + k], (*inv)[col * n + k]);
+      }
+    }
+    uint8_t scale = Gf256::Inv((*a)[col * n + col]);
+    for (int k = 0; k < n; k++) {
+      (*a)[col * n + k] = Gf256::Mul((*a)[col * n + k], scale);
+      (*inv)[col * n + k] = Gf256::Mul((*inv)[col * n + k], scale);
+    }
+    for (int row = 0; row < n; row++) {
+      uint8_t factor = (*a)[row * n + col];
+      if (row == col || factor == 0) {
+        continue;
+      }
+      for (int k = 0; k < n; k++) {
+        (*a)[row * n + k] ^= Gf256::Mul(factor, (*a)[col * n + k]);
+        (*inv)[row * n + k] ^= Gf256::Mul(factor, (*inv)[col * n + k]);
+      }
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int FecInfo::Pack() const {
+  uint32_t value = 1u << 31;
+  value |= (uint32_t)(fin ? 1 : 0) << 30;
+  value |= (uint32_t)((count - 1) & 0x3F) << 24;
+  value |= (uint32_t)(index & 0x7) << 21;
+  value |= (uint32_t)((parity - 1) & 0x7) << 18;
+  value |= (uint32_t)(last_length & 0x7FF);
+  return (int)value;
+}
+
+FecInfo FecInfo::Unpack(int ack_num) {
+  uint32_t value = (uint32_t)ack_num;
+  FecInfo info;
+  info.fin = (value >> 30) & 1;
+  info.count = ((value >> 24) & 0x3F) + 1;
+  info.index = (value >> 21) & 0x7;
+  info.parity = ((value >> 18) & 0x7) + 1;
+  info.last_length = value & 0x7FF;
+  return info;
+}
+
+uint8_t FecCodec::Coefficient(int parity_index, int data_index) {
+  return matrix().coef[parity_index][data_index];
+}
+
+void FecCodec::Encode(int parity_index, const char *const *data,
+                      const int *lengths, int count, char *parity,
+                      int length) {
+  memset(parity, 0, length);
+  for (int i = 0; i < count; i++) {
+    Gf256::MulAddRegion(Coefficient(parity_index, i),
+                        reinterpret_cast<const uint8_t *>(data[i]),
+                        reinterpret_cast<uint8_t *>(parity),
+                        lengths[i] < length ? lengths[i] : length);
+  }
+}
+
+bool FecCodec::Decode(char *const *data, const bool *present, int count,
+                      const char *const *parity, const int *parity_indexes,
+                      int parity_count, int length) {
+  std::vector<int> missing;
+  for (int i = 0; i < count; i++) {
+    if (!present[i]) {
+      missing.push_back(i);
+    }
+  }
+  int n = missing.size();
+  if (n == 0) {
+    return true;
+  }
+  if (n > parity_count) {
+    return false;
+  }
+
+  /**
+   * 用前 n 个校验段：先消去已收到的数据段，得到 S_r = sum(A[r][e] * D_e)，
+   * 再用 A[R][E] 的逆矩阵解出缺失的数据段
+   */
+  std::vector<uint8_t> syndrome(n * length);
+  std::vector<uint8_t> sub(n * n);
+  for (int r = 0; r < n; r++) {
+    uint8_t *s = &syndrome[r * length];
+    memcpy(s, parity[r], length);
+    for (int i = 0; i < count; i++) {
+      if (present[i]) {
+        Gf256::MulAddRegion(Coefficient(parity_indexes[r], i),
+                            reinterpret_cast<const uint8_t *>(data[i]), s,
+                            length);
+      }
+    }
+    for (int e = 0; e < n; e++) {
+      sub[r * n + e] = Coefficient(parity_indexes[r], missing[e]);
+    }
+  }
+
+  std::vector<uint8_t> inv;
+  if (!invert(&sub, n, &inv)) {
+    return false;
+  }
+  for (int e = 0; e < n; e++) {
+    uint8_t *out = reinterpret_cast<uint8_t *>(data[missing[e]]);
+    memset(out, 0, length);
+    for (int r = 0; r < n; r++) {
+      Gf256::MulAddRegion(inv[e * n + r], &syndrome[r * length], out, length);
+    }
+  }
+  return true;
+}
+}  // namespace safe_udp
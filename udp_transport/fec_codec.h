@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/** 一个 FEC 分组最多包含的数据段数量 */
+constexpr int MAX_FEC_BLOCK = 64;
+/** 一个 FEC 分组最多的校验段数量 */
+constexpr int MAX_FEC_PARITY = 8;
+
+/**
+ * FecInfo 描述一个校验段所属的分组，序列化后放在校验段头部的 ackNum 字段
+ * （数据段不使用 ackNum，恒为 0）：
+ *   bit 31     校验段标记
+ *   bit 30     分组最后一个数据段带 FIN
+ *   bit 24-29  分组中的数据段数量 - 1
+ *   bit 21-23  本校验段的序号
+ *   bit 18-20  分组的校验段数量 - 1
+ *   bit 0-10   分组最后一个数据段的长度（其余数据段都是 MAX_DATA_SIZE）
+ * 校验段的 seqNumber 是分组第一个数据段的序列号。
+ */
+struct FecInfo {
+  int count = 0;        /* 分组中的数据段数量 */
+  int index = 0;        /* 本校验段的序号 */
+  int parity = 0;       /* 分组的校验段数量 */
+  bool fin = false;     /* 分组最后一个数据段是否带 FIN */
+  int last_length = 0;  /* 分组最后一个数据段的长度 */
+
+  /** ackNum 字段是否表示一个校验段 */
+  static bool IsParity(int ack_num) { return (uint32_t)ack_num >> 31; }
+  /** 打包成 ackNum 字段 */
+  int Pack() const;
+  /** 从 ackNum 字段解析 */
+  static FecInfo Unpack(int ack_num);
+};
+
+/**
+ * FecCodec 类实现分组的 Reed-Solomon 纠删码（GF(2^8) 上的系统码）。
+ * 编码矩阵取 Cauchy 矩阵，任意方阵子阵都可逆，因此 m 个校验段
+ * 可以恢复分组内任意 m 个丢失的数据段；再把每一列按第 0 行归一化，
+ * 第 0 个校验段就是全部数据段的异或，只有一个校验段时不需要乘法。
+ * 数据段按 MAX_DATA_SIZE 补零参与运算。
+ */
+class FecCodec {
+ public:
+  /** 第 parity_index 个校验段中第 data_index 个数据段的系数 */
+  static uint8_t Coefficient(int parity_index, int data_index);
+
+  /**
+   * 计算一个校验段：parity = sum(coef(i) * data[i])
+   * @param parity_index 校验段序号
+   * @param data 分组内各数据段
+   * @param lengths 各数据段长度，不足 length 的部分按 0 处理
+   * @param count 数据段数量
+   * @param parity 输出，length 字节
+   * @param length 校验段长度（分组内最长数据段的长度）
+   */
+  static void Encode(int parity_index, const char *const *data,
+                     const int *lengths, int count, char *parity, int length);
+
+  /**
+   * 恢复分组内缺失的数据段
+   * @param data 各数据段，长度均为 length；缺失的位置作为输出
+   * @param present 各数据段是否已经收到
+   * @param count 数据段数量
+   * @param parity 收到的校验段
+   * @param parity_indexes 收到的校验段序号
+   * @param parity_count 收到的校验段数量，不少于缺失的数据段数量
+   * @param length 校验段长度
+   * @return 恢复成功返回 true
+   */
+  static bool Decode(char *const *data, const bool *present, int count,
+                     const char *const *parity, const int *parity_indexes,
+                     int parity_count, int length);
+};
+}  // namespace safe_udp
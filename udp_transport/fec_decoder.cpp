@@ -0,0 +1,84 @@
+#include "fec_decoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+FecDecoder::FecDecoder()
+    : scratch_(MAX_FEC_BLOCK * MAX_DATA_SIZE), recovered_count_(0) {}
+
+void FecDecoder::AddParity(int first_index, const FecInfo &info,
+                           const char *payload, int length) {
+  Block &block = blocks_[first_index];
+  if (block.indexes.empty()) {
+    block.info = info;
+    block.length = std::min(length, MAX_DATA_SIZE);
+  }
+  if (length != block.length || info.count != block.info.count ||
+      std::find(block.indexes.begin(), block.indexes.end(), info.index) !=
+          block.indexes.end()) {
+    return;
+  }
+  block.indexes.push_back(info.index);
+  block.parity.emplace_back(payload, payload + length);
+}
+
+int FecDecoder::FindBlock(int index) const {
+  auto it = blocks_.upper_bound(index);
+  if (it == blocks_.begin()) {
+    return -1;
+  }
+  --it;
+  return index < it->first + it->second.info.count ? it->first : -1;
+}
+
+bool FecDecoder::Recover(int first_index, const std::vector<bool> &present,
+                         const ReadFn &read,
+                         std::vector<const char *> *recovered) {
+  Block &block = blocks_.at(first_index);
+  int count = block.info.count;
+  int length = block.length;
+
+  std::vector<char *> data(count);
+  std::vector<const char *> parity(block.parity.size());
+  bool present_flags[MAX_FEC_BLOCK];
+  for (int i = 0; i < count; i++) {
+    data[i] = &scratch_[i * MAX_DATA_SIZE];
+    present_flags[i] = present[i];
+    if (present[i]) {
+      /** 最后一个数据段可能较短，其余部分补零 */
+      int segment_length = i == count - 1 ? block.info.last_length : length;
+      memset(data[i] + segment_length, 0, length - segment_length);
+      if (!read(i, data[i], segment_length)) {
+        return false;
+      }
+    }
+  }
+  for (size_t j = 0; j < block.parity.size(); j++) {
+    parity[j] = block.parity[j].data();
+  }
+  if (!FecCodec::Decode(data.data(), present_flags, count, parity.data(),
+                        block.indexes.data(), block.indexes.size(), length)) {
+    return false;
+  }
+
+  recovered->assign(count, nullptr);
+  for (int i = 0; i < count; i++) {
+    if (!present[i]) {
+      (*recovered)[i] = data[i];
+      recovered_count_++;
+    }
+  }
+  return true;
+}
+
+void FecDecoder::Release(int index) {
+  auto it = blocks_.begin();
+  while (it != blocks_.end() && it->first + it->second.info.count <= index) {
+    it = blocks_.erase(it);
+  }
+}
+}  // namespace safe_udp
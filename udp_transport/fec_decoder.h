@@ -0,0 +1,78 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "fec_codec.h"
+
+namespace safe_udp {
+/**
+ * FecDecoder 类在接收方保存尚未用完的校验段，并在分组内收到的数据段
+ * 与校验段合计达到分组大小时恢复缺失的数据段，不必等待重传。
+ * 分组以第一个数据段的下标为键；分组内的数据段全部按序到达后调用 Release 丢弃，
+ * 因此保存的校验段不超过接收窗口覆盖的分组。
+ */
+class FecDecoder {
+ public:
+  /** 读取分组内一个已经收到的数据段（分组内位置、缓冲区、长度） */
+  typedef std::function<bool(int, char *, int)> ReadFn;
+
+  FecDecoder();
+
+  /**
+   * 保存一个校验段，同一个校验段重复到达时忽略
+   * @param first_index 分组第一个数据段的下标
+   * @param info 校验段描述
+   * @param payload 校验段载荷
+   * @param length 载荷长度
+   */
+  void AddParity(int first_index, const FecInfo &info, const char *payload,
+                 int length);
+
+  /**
+   * 查找包含第 index 个数据段、并且已经收到过校验段的分组
+   * @return 分组第一个数据段的下标，没有时返回 -1
+   */
+  int FindBlock(int index) const;
+
+  /** 分组的描述，first_index 必须是 FindBlock 返回的分组 */
+  const FecInfo &info(int first_index) const {
+    return blocks_.at(first_index).info;
+  }
+
+  /** 分组已经收到的校验段数量 */
+  int parity_count(int first_index) const {
+    return blocks_.at(first_index).indexes.size();
+  }
+
+  /**
+   * 恢复分组内缺失的数据段，缺失的数量不能超过收到的校验段数量
+   * @param first_index 分组第一个数据段的下标
+   * @param present 分组内各位置的数据段是否已经收到
+   * @param read 读取已经收到的数据段
+   * @param recovered 输出恢复出的数据段，按分组内位置索引，
+   *        指向内部缓冲区，在下一次调用前有效
+   * @return 恢复成功返回 true
+   */
+  bool Recover(int first_index, const std::vector<bool> &present,
+               const ReadFn &read, std::vector<const char *> *recovered);
+
+  /** 丢弃数据段全部在 index 之前的分组 */
+  void Release(int index);
+
+  /** 累计恢复出的数据段数量 */
+  long recovered_count() const { return recovered_count_; }
+
+ private:
+  struct Block {
+    FecInfo info;
+    int length = 0;                        /* 校验段长度 */
+    std::vector<int> indexes;              /* 收到的校验段序号 */
+    std::vector<std::vector<char>> parity; /* 收到的校验段载荷 */
+  };
+
+  std::map<int, Block> blocks_;   /* 按分组第一个数据段下标排序 */
+  std::vector<char> scratch_;     /* 分组内全部数据段的解码缓冲区 */
+  long recovered_count_;          /* 累计恢复出的数据段数量 */
+};
+}  // namespace safe_udp
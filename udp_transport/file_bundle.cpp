@@ -0,0 +1,244 @@
+#include "file_bundle.h"
+
+#include <fcntl.h>
+#include <glob.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+#include <glog/logging.h>
+
+#include "crc32c.h"
+#include "data_segment.h"
+
+namespace safe_udp {
+/** 向上对齐到数据段边界 */
+static int64_t alignToSegment(int64_t offset) {
+  return (offset + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE * MAX_DATA_SIZE;
+}
+
+/** 把整个小文件读入 buffer，文件在打开后变短时返回 false */
+static bool readWholeFile(const std::string &path, char *buffer, int size) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  int done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, buffer + done, size - done, done);
+    if (n <= 0) {
+      break;
+    }
+    done += n;
+  }
+  close(fd);
+  return done == size;
+}
+
+FileBundle::FileBundle()
+    : size_(0), raw_length_(0), crc_hits_(0), crc_misses_(0) {}
+
+/**
+ * 按请求中的顺序展开每个模式（glob 的结果按名字排序），只保留普通文件。
+ * 模式必须是目录之内的相对路径；匹配到的文件解析符号链接后仍须在目录之内，
+ * 否则跳过，glob 不会把目录之外的文件列出来发送。
+ * 任何一个模式不合法或没有匹配、文件读取失败或总长度超过 INT_MAX 时整个请求失败。
+ */
+bool FileBundle::Open(const std::string &directory,
+                      const std::vector<std::string> &patterns,
+                      ChunkCache *cache) {
+  char resolved[PATH_MAX];
+  if (realpath(directory.c_str(), resolved) == nullptr) {
+    LOG(ERROR) << "Failed to resolve " << directory;
+    return false;
+  }
+  std::string root = std::string(resolved) + "/";
+
+  std::vector<BundleEntry> small_files;
+  std::vector<BundleEntry> large_files;
+  for (const std::string &pattern : patterns) {
+    if (!BundleManifest::IsSafeName(pattern)) {
+      LOG(ERROR) << "Bundle pattern " << pattern << " is outside the directory";
+      return false;
+    }
+    glob_t matches;
+    if (pattern.empty() ||
+        glob((directory + pattern).c_str(), 0, NULL, &matches) != 0) {
+      LOG(INFO) << "No file matches " << pattern;
+      if (!pattern.empty()) {
+        globfree(&matches);
+      }
+      return false;
+    }
+    for (size_t i = 0; i < matches.gl_pathc; i++) {
+      if (realpath(matches.gl_pathv[i], resolved) == nullptr ||
+          strncmp(resolved, root.c_str(), root.size()) != 0) {
+        LOG(ERROR) << "Skipping " << matches.gl_pathv[i]
+                   << ", it resolves outside the directory";
+        continue;
+      }
+      struct stat st;
+      if (stat(matches.gl_pathv[i], &st) < 0 || !S_ISREG(st.st_mode) ||
+          st.st_size > INT_MAX) {
+        continue;
+      }
+      BundleEntry entry;
+      entry.name = matches.gl_pathv[i] + directory.size();
+      entry.size = (int)st.st_size;
+      if (entry.size < BUNDLE_INLINE_LIMIT) {
+        small_files.push_back(entry);
+      } else {
+        large_files.push_back(entry);
+      }
+    }
+    globfree(&matches);
+  }
+
+  size_t count = small_files.size() + large_files.size();
+  if (count == 0 || count > MAX_BUNDLE_FILES ||
+      large_files.size() > MAX_BUNDLE_LARGE_FILES) {
+    LOG(ERROR) << "Bundle of " << count << " files (" << large_files.size()
+               << " large) is not supported";
+    return false;
+  }
+
+  /** 清单的长度只取决于文件名，先放入全部文件，再依次分配起点 */
+  manifest_.entries = small_files;
+  manifest_.entries.insert(manifest_.entries.end(), large_files.begin(),
+                           large_files.end());
+  int64_t position = manifest_.SerializedLength();
+  for (size_t i = 0; i < manifest_.entries.size(); i++) {
+    BundleEntry &entry = manifest_.entries[i];
+    if (i >= small_files.size()) {
+      position = alignToSegment(position);
+    }
+    entry.offset = (int)std::min<int64_t>(position, INT_MAX);
+    position += entry.size;
+    raw_length_ += entry.size;
+  }
+  if (position > INT_MAX) {
+    LOG(ERROR) << "Bundle of " << position << " bytes is too large";
+    return false;
+  }
+  size_ = (int)position;
+
+  /** 清单和小文件读入内存，有大文件时补齐到第一个大文件的起点 */
+  int head_length =
+      large_files.empty() ? size_ : manifest_.entries[small_files.size()].offset;
+  head_.assign(head_length, 0);
+  std::string manifest = manifest_.Serialize();
+  memcpy(head_.data(), manifest.data(), manifest.size());
+  for (size_t i = 0; i < small_files.size(); i++) {
+    const BundleEntry &entry = manifest_.entries[i];
+    if (!readWholeFile(directory + entry.name, &head_[entry.offset],
+                       entry.size)) {
+      LOG(ERROR) << "Failed to read " << entry.name;
+      return false;
+    }
+  }
+  for (int offset = 0; offset < head_length; offset += MAX_DATA_SIZE) {
+    head_crcs_.push_back(Crc32c::Value(
+        &head_[offset], std::min(MAX_DATA_SIZE, head_length - offset)));
+    crc_misses_++;
+  }
+
+  for (size_t i = small_files.size(); i < manifest_.entries.size(); i++) {
+    const BundleEntry &entry = manifest_.entries[i];
+    LargeFile file;
+    file.offset = entry.offset;
+    file.size = entry.size;
+    file.source = std::make_unique<FileSource>();
+    if (!file.source->Open(directory + entry.name, cache) ||
+        (int64_t)file.source->size() != entry.size) {
+      LOG(ERROR) << "Failed to open " << entry.name;
+      return false;
+    }
+    large_.push_back(std::move(file));
+  }
+  LOG(INFO) << "Bundle: " << count << " files (" << large_.size()
+            << " large), " << raw_length_ << " bytes, stream " << size_
+            << " bytes";
+  return true;
+}
+
+const char *FileBundle::Data(int offset) {
+  LargeFile *file = findLarge(offset);
+  if (file == nullptr) {
+    return head_.data() + offset;
+  }
+  int length = std::min(MAX_DATA_SIZE, size_ - offset);
+  if (offset + length > file->offset + file->size) {
+    return tailSegment(file, offset);
+  }
+  return file->source->Data(offset - file->offset);
+}
+
+uint32_t FileBundle::PayloadCrc(int offset, int length) {
+  LargeFile *file = findLarge(offset);
+  if (file == nullptr) {
+    size_t index = offset / MAX_DATA_SIZE;
+    if (index < head_crcs_.size() &&
+        length == std::min<int>(MAX_DATA_SIZE, head_.size() - offset)) {
+      crc_hits_++;
+      return head_crcs_[index];
+    }
+    crc_misses_++;
+    return Crc32c::Value(head_.data() + offset, length);
+  }
+  if (offset + length > file->offset + file->size) {
+    tailSegment(file, offset);
+    crc_hits_++;
+    return file->tail_crc;
+  }
+  return file->source->PayloadCrc(offset - file->offset, length);
+}
+
+void FileBundle::Unpin() {
+  for (LargeFile &file : large_) {
+    file.source->Unpin();
+  }
+}
+
+int64_t FileBundle::crc_hits() const {
+  int64_t hits = crc_hits_;
+  for (const LargeFile &file : large_) {
+    hits += file.source->crc_hits();
+  }
+  return hits;
+}
+
+int64_t FileBundle::crc_misses() const {
+  int64_t misses = crc_misses_;
+  for (const LargeFile &file : large_) {
+    misses += file.source->crc_misses();
+  }
+  return misses;
+}
+
+FileBundle::LargeFile *FileBundle::findLarge(int offset) {
+  auto it = std::upper_bound(
+      large_.begin(), large_.end(), offset,
+      [](int value, const LargeFile &file) { return value < file.offset; });
+  return it == large_.begin() ? nullptr : &*(it - 1);
+}
+
+/**
+ * 大文件的最后一个数据段后面是下一个大文件之前的填充，
+ * 拼出后保存下来，重传和校验段编码时直接使用
+ */
+const char *FileBundle::tailSegment(LargeFile *file, int offset) {
+  if (file->tail.empty()) {
+    int length = file->offset + file->size - offset;
+    file->tail.assign(MAX_DATA_SIZE, 0);
+    memcpy(file->tail.data(), file->source->Data(offset - file->offset),
+           length);
+    file->tail_crc = Crc32c::Value(file->tail.data(), MAX_DATA_SIZE);
+    crc_misses_++;
+  }
+  return file->tail.data();
+}
+}  // namespace safe_udp
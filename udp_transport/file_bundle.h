@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bundle_manifest.h"
+#include "file_source.h"
+
+namespace safe_udp {
+/** 小于该长度的文件在打开时读入内存，紧挨着打包在清单之后 */
+constexpr int BUNDLE_INLINE_LIMIT = 64 * 1024;
+/** 一次多文件传输最多包含的文件数，以及其中保持打开的大文件数 */
+constexpr int MAX_BUNDLE_FILES = 1024;
+constexpr int MAX_BUNDLE_LARGE_FILES = 256;
+
+/**
+ * FileBundle 类把一组文件排成一个字节流，由一个会话连续发送，
+ * 拥塞窗口和 RTT 估计在文件之间保留。字节流的布局：
+ *   清单（BundleManifest），紧接着所有小文件，首尾相接，
+ *   多个小文件共用数据段，不会每个文件单独占一个几乎为空的数据报；
+ *   之后每个大文件从数据段边界开始，中间用 0 填充。
+ * 清单和小文件在打开时读入内存；大文件由各自的 FileSource 提供，
+ * 数据段与文件内偏移对齐，载荷不拷贝，校验和同样使用块缓存。
+ * 只有大文件的最后一个数据段（文件末尾加填充）需要另外拼出。
+ */
+class FileBundle {
+ public:
+  FileBundle();
+
+  FileBundle(const FileBundle &) = delete;
+  FileBundle &operator=(const FileBundle &) = delete;
+
+  /**
+   * 展开文件名（可以是 glob 模式），读入小文件并打开大文件，生成布局
+   * @param directory 服务器文件目录，文件名相对于该目录
+   * @param patterns 文件名或 glob 模式
+   * @param cache 服务器共享的块缓存，nullptr 表示直接映射文件
+   * @return 至少有一个文件且全部成功打开返回 true
+   */
+  bool Open(const std::string &directory,
+            const std::vector<std::string> &patterns, ChunkCache *cache);
+
+  /** 字节流长度（包含清单和填充） */
+  int size() const { return size_; }
+
+  /** 文件数 */
+  int file_count() const { return (int)manifest_.entries.size(); }
+
+  /** 所有文件的总长度 */
+  int64_t raw_length() const { return raw_length_; }
+
+  /**
+   * 字节流中一个数据段的数据，offset 是 MAX_DATA_SIZE 的整数倍，
+   * 之后 min(MAX_DATA_SIZE, size() - offset) 字节连续有效，直到下一次 Unpin
+   */
+  const char *Data(int offset);
+
+  /** 字节流中一个数据段 [offset, offset + length) 的 CRC32C */
+  uint32_t PayloadCrc(int offset, int length);
+
+  /** 释放大文件中之前用到的缓存块 */
+  void Unpin();
+
+  /** 载荷校验和命中缓存的次数 */
+  int64_t crc_hits() const;
+
+  /** 载荷校验和计算的次数 */
+  int64_t crc_misses() const;
+
+ private:
+  /** 从数据段边界开始的大文件 */
+  struct LargeFile {
+    int offset = 0;                       /* 在字节流中的起点 */
+    int size = 0;                         /* 文件长度 */
+    std::unique_ptr<FileSource> source;   /* 文件数据 */
+    std::vector<char> tail;               /* 最后一个数据段（末尾加填充），用到时拼出 */
+    uint32_t tail_crc = 0;                /* tail 的校验和 */
+  };
+
+  /** 包含 offset 的大文件，offset 在内存中的部分时返回 nullptr */
+  LargeFile *findLarge(int offset);
+
+  /** 数据段跨过大文件末尾（后面是填充）时拼出该数据段 */
+  const char *tailSegment(LargeFile *file, int offset);
+
+  BundleManifest manifest_;        /* 清单 */
+  std::vector<char> head_;         /* 清单和小文件，有大文件时补齐到数据段边界 */
+  std::vector<uint32_t> head_crcs_; /* head_ 中每个数据段的校验和 */
+  std::vector<LargeFile> large_;   /* 大文件，按起点升序 */
+  int size_;                       /* 字节流长度 */
+  int64_t raw_length_;             /* 文件总长度 */
+  int64_t crc_hits_;               /* 内存部分校验和的命中次数 */
+  int64_t crc_misses_;             /* 内存部分校验和的计算次数 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,71 @@
+#include "file_request.h"
+
+#include <string.h>
+
+#include <climits>
+
+namespace safe_udp {
+/** 请求类型 */
+constexpr uint8_t REQUEST_TRANSFER = 0;
+constexpr uint8_t REQUEST_SIZE_QUERY = 1;
+constexpr uint8_t REQUEST_BUNDLE = 2;
+
+bool FileRequest::IsRequest(const char *data, int length) {
+  return length >= FILE_REQUEST_HEADER_LENGTH &&
+         LoadBigEndian32(data) == FILE_REQUEST_MAGIC;
+}
+
+bool FileRequest::Parse(const char *data, int length, FileRequest *request) {
+  *request = FileRequest();
+  if (!IsRequest(data, length)) {
+    return false;
+  }
+
+  uint8_t version = data[4];
+  uint8_t kind = data[5];
+  uint8_t compression = data[10];
+  uint16_t name_length = LoadBigEndian16(data + 6);
+  request->offset = (int64_t)LoadBigEndian64(data + 12);
+  request->length = (int64_t)LoadBigEndian64(data + 20);
+  uint32_t window = LoadBigEndian32(data + 32);
+  if (version != FILE_REQUEST_VERSION || kind > REQUEST_BUNDLE ||
+      compression > static_cast<uint8_t>(Compression::ZSTD) ||
+      name_length == 0 ||
+      FILE_REQUEST_HEADER_LENGTH + name_length != length) {
+    return false;
+  }
+  /** 文件长度和窗口在会话中用 int 表示，同样不能超过 INT_MAX */
+  if (request->offset < 0 || request->offset > INT_MAX ||
+      request->length < -1 || request->length > INT_MAX || window > INT_MAX) {
+    return false;
+  }
+  request->features = LoadBigEndian16(data + 8);
+  request->clientToken = LoadBigEndian32(data + 28);
+  request->window = (int)window;
+  request->maxSegmentSize = LoadBigEndian16(data + 36);
+  request->sizeQuery = kind == REQUEST_SIZE_QUERY;
+  request->bundle = kind == REQUEST_BUNDLE;
+  request->compression = static_cast<Compression>(compression);
+  request->fileName.assign(data + FILE_REQUEST_HEADER_LENGTH, name_length);
+  return true;
+}
+
+std::string FileRequest::Serialize() const {
+  std::string data(FILE_REQUEST_HEADER_LENGTH + fileName.size(), '\0');
+  uint16_t name_length = fileName.size();
+  StoreBigEndian32(&data[0], FILE_REQUEST_MAGIC);
+  data[4] = FILE_REQUEST_VERSION;
+  data[5] = sizeQuery ? REQUEST_SIZE_QUERY
+                      : bundle ? REQUEST_BUNDLE : REQUEST_TRANSFER;
+  StoreBigEndian16(&data[6], name_length);
+  StoreBigEndian16(&data[8], features);
+  data[10] = static_cast<char>(compression);
+  StoreBigEndian64(&data[12], offset);
+  StoreBigEndian64(&data[20], length);
+  StoreBigEndian32(&data[28], clientToken);
+  StoreBigEndian32(&data[32], window);
+  StoreBigEndian16(&data[36], maxSegmentSize);
+  memcpy(&data[FILE_REQUEST_HEADER_LENGTH], fileName.data(), fileName.size());
+  return data;
+}
+}  // namespace safe_udp
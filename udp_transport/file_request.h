@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+
+#include <string>
+
+#include "block_codec.h"
+#include "wire_format.h"
+
+namespace safe_udp {
+/** 请求数据报的魔数 "SURQ"（网络字节序），用于和数据段区分 */
+constexpr uint32_t FILE_REQUEST_MAGIC = 0x53555251;
+/** 版本 2 起多字节字段为网络字节序，版本 3 起请求同时是握手的第一步 */
+constexpr uint8_t FILE_REQUEST_VERSION = 3;
+/** 请求头部长度，文件名紧跟在头部之后 */
+constexpr int FILE_REQUEST_HEADER_LENGTH = 40;
+
+/** 握手中协商的功能标志 */
+constexpr uint16_t FEATURE_FEC = 0x0001;  // 能用 FEC 校验段恢复丢失的数据段
+
+/**
+ * FileRequest 描述客户端的一次请求，序列化为一个数据报（多字节字段为网络字节序）：
+ *   0  魔数（4 字节）      4  版本（1 字节）     5  类型（1 字节）
+ *   6  文件名长度（2 字节） 8  功能标志（2 字节）
+ *   10 压缩方法（1 字节）   11 保留，为 0（1 字节）
+ *   12 范围起点（8 字节）   20 范围长度（8 字节，-1 表示到文件末尾）
+ *   28 客户端令牌（4 字节） 32 接收窗口（4 字节，数据段个数）
+ *   36 最大载荷长度（2 字节） 38 保留，为 0（2 字节）
+ *   40 文件名
+ * 请求的第一个字节是 'S'，而数据段头部的第一个字节是版本号 WIRE_VERSION。
+ * 传输请求是握手的第一步：服务器回复 SessionAccept，客户端用一个 ACK 确认后
+ * 服务器才开始发送。客户端令牌用来把回复和请求对应起来，
+ * 重发的请求由服务器按令牌识别，不会建立第二个会话。
+ * 大小查询的回复是文本 "SIZE <n>"，文件不存在时回复 "FILE NOT FOUND"。
+ * 多文件请求的文件名是以换行分隔的文件名或 glob 模式，所有文件在同一个会话中
+ * 连续发送，字节流的布局见 FileBundle；范围和压缩不用于多文件请求。
+ */
+struct FileRequest {
+  std::string fileName;     /* 相对于服务器文件目录的文件名 */
+  int64_t offset = 0;       /* 字节范围的起点 */
+  int64_t length = -1;      /* 字节范围的长度，-1 表示到文件末尾 */
+  bool sizeQuery = false;   /* 是否只查询文件大小 */
+  bool bundle = false;      /* 是否是多文件请求 */
+  Compression compression = Compression::NONE; /* 希望服务器使用的压缩方法 */
+  uint32_t clientToken = 0; /* 客户端选择的随机数，服务器在 SessionAccept 中回显 */
+  int window = 0;           /* 客户端的接收窗口（数据段个数），0 表示不限制 */
+  int maxSegmentSize = 0;   /* 客户端能接收的最大载荷长度 */
+  uint16_t features = 0;    /* 客户端支持的功能（FEATURE_*） */
+
+  /**
+   * 数据报是否以请求的魔数开头（不检查其余字段）
+   */
+  static bool IsRequest(const char *data, int length);
+
+  /**
+   * 从数据报解析请求
+   * @return 格式正确返回 true
+   */
+  static bool Parse(const char *data, int length, FileRequest *request);
+
+  /** 序列化为数据报内容 */
+  std::string Serialize() const;
+};
+}  // namespace safe_udp
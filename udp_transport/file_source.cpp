@@ -0,0 +1,117 @@
+#include "file_source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "crc32c.h"
+
+namespace safe_udp {
+FileSource::FileSource()
+    : fd_(-1),
+      size_(0),
+      data_(nullptr),
+      cache_(nullptr),
+      chunk_index_(-1),
+      crc_hits_(0),
+      crc_misses_(0) {}
+
+FileSource::~FileSource() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+/**
+ * 打开文件并建立只读映射。
+ * MADV_SEQUENTIAL 让内核加大预读并尽早回收已读页，
+ * MADV_HUGEPAGE 在文件系统支持时允许使用透明大页减少 TLB 缺失，两者都只是提示。
+ */
+bool FileSource::Open(const std::string &file_name, ChunkCache *cache) {
+  fd_ = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) < 0 || !S_ISREG(st.st_mode)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  size_ = st.st_size;
+  if (size_ == 0) {
+    return true; /** 空文件无需映射 */
+  }
+  if (cache != nullptr) {
+    cache_ = cache;
+    identity_.device = st.st_dev;
+    identity_.inode = st.st_ino;
+    identity_.size = st.st_size;
+    identity_.mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 +
+                        st.st_mtim.tv_nsec;
+    return true;
+  }
+
+  void *addr = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "mmap failed for " << file_name;
+    close(fd_);
+    fd_ = -1;
+    size_ = 0;
+    return false;
+  }
+  data_ = static_cast<char *>(addr);
+
+  if (madvise(data_, size_, MADV_SEQUENTIAL) < 0) {
+    LOG(INFO) << "madvise(MADV_SEQUENTIAL) ignored";
+  }
+#ifdef MADV_HUGEPAGE
+  if (madvise(data_, size_, MADV_HUGEPAGE) < 0) {
+    LOG(INFO) << "madvise(MADV_HUGEPAGE) ignored";
+  }
+#endif
+  return true;
+}
+
+uint32_t FileSource::PayloadCrc(size_t offset, int length) {
+  const char *data = Data(offset);
+  if (cache_ == nullptr || size_ == 0 || offset % MAX_DATA_SIZE != 0 ||
+      length != (int)std::min<size_t>(MAX_DATA_SIZE, size_ - offset)) {
+    crc_misses_++;
+    return Crc32c::Value(data, length);
+  }
+
+  /** Data 已经切换到 offset 所在的块，槽位按块内第一个对齐数据段编号 */
+  int64_t first = (chunk_index_ * CHUNK_SIZE + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE;
+  std::atomic<uint64_t> &slot =
+      chunk_->segmentCrcs[offset / MAX_DATA_SIZE - first];
+  uint64_t value = slot.load(std::memory_order_relaxed);
+  if (value >> 32) {
+    crc_hits_++;
+    return static_cast<uint32_t>(value);
+  }
+  crc_misses_++;
+  uint32_t crc = Crc32c::Value(data, length);
+  /** 多个线程同时填入时写入的值相同，不需要更强的内存序 */
+  slot.store((1ull << 32) | crc, std::memory_order_relaxed);
+  return crc;
+}
+
+void FileSource::switchChunk(int64_t index) {
+  if (chunk_ != nullptr) {
+    pinned_.push_back(std::move(chunk_));
+  }
+  chunk_ = cache_->Get(identity_, fd_, index);
+  chunk_index_ = index;
+}
+}  // namespace safe_udp
@@ -0,0 +1,93 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunk_cache.h"
+
+namespace safe_udp {
+/**
+ * FileSource 类提供待发送文件的数据。
+ * 默认把文件一次性以只读方式映射到内存，发送和重传时直接返回映射区中的指针，
+ * 数据段载荷无需再拷贝。给出 ChunkCache 时改为从服务器共享的块缓存取数据，
+ * 同一个热门文件只读盘一次；用到的块在 Unpin 之前一直保持有效。
+ */
+class FileSource {
+ public:
+  FileSource();
+
+  /**
+   * 析构函数，解除映射并关闭文件
+   */
+  ~FileSource();
+
+  FileSource(const FileSource &) = delete;
+  FileSource &operator=(const FileSource &) = delete;
+
+  /**
+   * 打开文件。不使用缓存时映射文件，同时给出顺序读取和大页的提示
+   * @param file_name 文件路径
+   * @param cache 服务器共享的块缓存，nullptr 表示直接映射文件
+   * @return 成功返回 true，否则 false
+   */
+  bool Open(const std::string &file_name, ChunkCache *cache = nullptr);
+
+  /** 文件是否已经打开 */
+  bool is_open() const { return fd_ >= 0; }
+
+  /** 文件长度（字节） */
+  size_t size() const { return size_; }
+
+  /**
+   * 返回文件中指定偏移处的数据指针，之后至少 CHUNK_OVERLAP 字节
+   * （或到文件末尾）连续有效，直到下一次 Unpin
+   * @param offset 字节偏移，不超过 size()
+   */
+  const char *Data(size_t offset) {
+    if (cache_ == nullptr || size_ == 0) {
+      return data_ + offset;
+    }
+    int64_t index = offset / CHUNK_SIZE;
+    if (chunk_ == nullptr || index != chunk_index_) {
+      switchChunk(index);
+    }
+    return chunk_->data.get() + (offset - index * CHUNK_SIZE);
+  }
+
+  /**
+   * 文件中 [offset, offset + length) 的 CRC32C。使用缓存时，
+   * 偏移是 MAX_DATA_SIZE 整数倍的满长度数据段的结果保存在块中，供所有会话复用
+   */
+  uint32_t PayloadCrc(size_t offset, int length);
+
+  /** PayloadCrc 命中块内缓存的次数 */
+  int64_t crc_hits() const { return crc_hits_; }
+
+  /** PayloadCrc 计算校验和的次数 */
+  int64_t crc_misses() const { return crc_misses_; }
+
+  /**
+   * 释放之前 Data 返回的指针所在的块（当前块除外），
+   * 在引用这些数据的数据报发出之后调用
+   */
+  void Unpin() { pinned_.clear(); }
+
+ private:
+  /** 切换到第 index 个块，原来的块保留到下一次 Unpin */
+  void switchChunk(int64_t index);
+
+  int fd_;       /* 文件描述符 */
+  size_t size_;  /* 文件长度 */
+  char *data_;   /* 映射区起始地址，空文件或使用缓存时为 nullptr */
+  ChunkCache *cache_;                       /* 块缓存，nullptr 表示使用映射 */
+  FileIdentity identity_;                   /* 缓存中的文件身份 */
+  std::shared_ptr<const FileChunk> chunk_;  /* 当前块 */
+  int64_t chunk_index_;                     /* 当前块号 */
+  std::vector<std::shared_ptr<const FileChunk>> pinned_; /* 待 Unpin 的块 */
+  int64_t crc_hits_;                        /* 载荷校验和命中次数 */
+  int64_t crc_misses_;                      /* 载荷校验和计算次数 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,149 @@
+#include "gf256.h"
+
+#include <immintrin.h>
+
+namespace safe_udp {
+namespace {
+constexpr int PRIMITIVE_POLY = 0x11D;
+
+/** 对数表、指数表和完整的 256x256 乘法表（64KB），进程内只初始化一次 */
+struct Tables {
+  uint8_t exp[512];
+  uint8_t log[256];
+  uint8_t mul[256][256];
+
+  Tables() {
+    int x = 1;
+    for (int i = 0; i < 255; i++) {
+      exp[i] = x;
+      exp[i + 255] = x;
+      log[x] = i;
+      x <<= 1;
+      if (x & 0x100) {
+        x ^= PRIMITIVE_POLY;
+      }
+    }
+    exp[510] = exp[0];
+    exp[511] = exp[1];
+    log[0] = 0;
+    for (int a = 0; a < 256; a++) {
+      for (int b = 0; b < 256; b++) {
+        mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+      }
+    }
+  }
+};
+
+const Tables &tables() {
+  static const Tables t;
+  return t;
+}
+
+void mulAddScalar(uint8_t c, const uint8_t *src, uint8_t *dst, int length) {
+  const uint8_t *row = tables().mul[c];
+  for (int i = 0; i < length; i++) {
+    dst[i] ^= row[src[i]];
+  }
+}
+
+/**
+ * c * x = c * (x & 0x0F) ^ c * (x & 0xF0)，两个 16 项的表分别查低、高半字节，
+ * 一条 PSHUFB 完成 16 个字节的查表
+ */
+__attribute__((target("ssse3"))) void mulAddSsse3(uint8_t c,
+                                                   const uint8_t *src,
+                                                   uint8_t *dst, int length) {
+  const uint8_t *row = tables().mul[c];
+  uint8_t lo[16], hi[16];
+  for (int i = 0; i < 16; i++) {
+    lo[i] = row[i];
+    hi[i] = row[i << 4];
+  }
+  __m128i table_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lo));
+  __m128i table_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hi));
+  __m128i mask = _mm_set1_epi8(0x0F);
+  int i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+    __m128i l = _mm_shuffle_epi8(table_lo, _mm_and_si128(s, mask));
+    __m128i h = _mm_shuffle_epi8(table_hi,
+                                 _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+    d = _mm_xor_si128(d, _mm_xor_si128(l, h));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), d);
+  }
+  mulAddScalar(c, src + i, dst + i, length - i);
+}
+
+__attribute__((target("avx2"))) void mulAddAvx2(uint8_t c, const uint8_t *src,
+                                                 uint8_t *dst, int length) {
+  const uint8_t *row = tables().mul[c];
+  uint8_t lo[16], hi[16];
+  for (int i = 0; i < 16; i++) {
+    lo[i] = row[i];
+    hi[i] = row[i << 4];
+  }
+  /** VPSHUFB 在每个 128 位通道内查表，两个通道放同一张表 */
+  __m256i table_lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(lo)));
+  __m256i table_hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(hi)));
+  __m256i mask = _mm256_set1_epi8(0x0F);
+  int i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+    __m256i l = _mm256_shuffle_epi8(table_lo, _mm256_and_si256(s, mask));
+    __m256i h = _mm256_shuffle_epi8(
+        table_hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+    d = _mm256_xor_si256(d, _mm256_xor_si256(l, h));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), d);
+  }
+  mulAddScalar(c, src + i, dst + i, length - i);
+}
+
+typedef void (*MulAddFn)(uint8_t, const uint8_t *, uint8_t *, int);
+
+struct Kernel {
+  MulAddFn fn;
+  const char *name;
+
+  Kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      fn = mulAddAvx2;
+      name = "avx2";
+    } else if (__builtin_cpu_supports("ssse3")) {
+      fn = mulAddSsse3;
+      name = "ssse3";
+    } else {
+      fn = mulAddScalar;
+      name = "scalar";
+    }
+  }
+};
+
+const Kernel &kernel() {
+  static const Kernel k;
+  return k;
+}
+}  // namespace
+
+uint8_t Gf256::Mul(uint8_t a, uint8_t b) { return tables().mul[a][b]; }
+
+uint8_t Gf256::Inv(uint8_t a) {
+  const Tables &t = tables();
+  return t.exp[255 - t.log[a]];
+}
+
+void Gf256::MulAddRegion(uint8_t c, const uint8_t *src, uint8_t *dst,
+                         int length) {
+  if (c == 0 || length <= 0) {
+    return;
+  }
+  /** c 为 1 时查表结果就是 src 本身，向量化的查表与单纯异或一样快 */
+  kernel().fn(c, src, dst, length);
+}
+
+const char *Gf256::KernelName() { return kernel().name; }
+}  // namespace safe_udp
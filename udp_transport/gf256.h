@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/**
+ * Gf256 类实现 GF(2^8) 上的运算（本原多项式 x^8 + x^4 + x^3 + x^2 + 1，
+ * 即 0x11D），供 Reed-Solomon 纠删码使用。加法就是异或；
+ * 区域乘加 dst ^= c * src 是编解码的热点，按 CPU 支持在运行时选择
+ * AVX2 / SSSE3 的 PSHUFB 查表实现（每次处理 32/16 字节），否则逐字节查表。
+ */
+class Gf256 {
+ public:
+  /** a * b */
+  static uint8_t Mul(uint8_t a, uint8_t b);
+
+  /** a 的乘法逆元，a 不能为 0 */
+  static uint8_t Inv(uint8_t a);
+
+  /**
+   * dst[i] ^= c * src[i]，0 <= i < length
+   * @param c 系数，为 0 时什么也不做
+   */
+  static void MulAddRegion(uint8_t c, const uint8_t *src, uint8_t *dst,
+                           int length);
+
+  /** 当前使用的区域乘加实现："avx2"、"ssse3" 或 "scalar" */
+  static const char *KernelName();
+};
+}  // namespace safe_udp
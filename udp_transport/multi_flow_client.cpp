@@ -0,0 +1,149 @@
+#include "multi_flow_client.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+namespace safe_udp {
+MultiFlowClient::MultiFlowClient(const std::string &server_address,
+                                 const std::string &port, int flows)
+    : server_address_(server_address), port_(port), flows_(std::max(1, flows)) {}
+
+bool MultiFlowClient::Download(const std::string &file_name,
+                               const ConfigureFn &configure, bool resume) {
+  int file_size;
+  {
+    UdpClient query_client;
+    configure(&query_client);
+    query_client.CreateSocketAndServerConnection(server_address_, port_);
+    file_size = query_client.QueryFileSize(file_name);
+  }
+  if (file_size < 0) {
+    return false;
+  }
+
+  /**
+   * 续传时检查点和本地文件都必须与服务器上的文件大小一致，
+   * 否则先创建并设定文件长度；各流只做定位写，互不截断
+   */
+  std::string file_path = std::string(CLIENT_FILE_PATH) + file_name;
+  TransferCheckpoint checkpoint(file_path);
+  struct stat file_stat;
+  bool resumed = resume && checkpoint.Load(file_size) &&
+                 stat(file_path.c_str(), &file_stat) == 0 &&
+                 file_stat.st_size == file_size;
+  std::vector<std::pair<int64_t, int64_t>> missing;
+  if (resumed) {
+    missing = checkpoint.MissingRanges();
+  } else {
+    int fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      LOG(ERROR) << "Failed to open " << file_path << " !!!";
+      return false;
+    }
+    if (ftruncate(fd, file_size) < 0) {
+      LOG(ERROR) << "Failed to resize " << file_path << " !!!";
+    }
+    close(fd);
+    if (resume) {
+      checkpoint.Reset(file_size);
+    }
+    missing.emplace_back(0, file_size);
+  }
+
+  /**
+   * 缺失的字节按数据段数平均分给各流，每个区间切成不超过一个流份额的块，
+   * 块的边界相对区间起点对齐到 MAX_DATA_SIZE
+   */
+  int64_t missing_bytes = 0;
+  for (const auto &range : missing) {
+    missing_bytes += range.second - range.first;
+  }
+  int64_t segments = (missing_bytes + MAX_DATA_SIZE - 1) / MAX_DATA_SIZE;
+  int64_t chunk_size =
+      std::max<int64_t>(1, (segments + flows_ - 1) / flows_) * MAX_DATA_SIZE;
+  std::vector<std::pair<int64_t, int64_t>> chunks;
+  for (const auto &range : missing) {
+    for (int64_t offset = range.first; offset < range.second;
+         offset += chunk_size) {
+      chunks.emplace_back(offset, std::min(range.second - offset, chunk_size));
+    }
+  }
+  int flows = std::max<int>(1, std::min<size_t>(flows_, chunks.size()));
+  LOG(INFO) << "Downloading " << file_name << " (" << file_size << " bytes, "
+            << missing_bytes << " missing) with " << flows << " flows";
+
+  /** 各流依次领取下一块，每块用新的 UdpClient（新的源端口和会话） */
+  struct timeval start_time, end_time;
+  gettimeofday(&start_time, NULL);
+  std::atomic<size_t> next_chunk(0);
+  /** 每块的结果只由领取它的流写入 */
+  std::vector<char> chunk_done(chunks.size(), 0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < flows; i++) {
+    threads.emplace_back([&]() {
+      size_t chunk;
+      while ((chunk = next_chunk++) < chunks.size()) {
+        UdpClient client;
+        configure(&client);
+        client.rangeOffset = chunks[chunk].first;
+        client.rangeLength = chunks[chunk].second;
+        client.checkpoint = resume ? &checkpoint : nullptr;
+        client.CreateSocketAndServerConnection(server_address_, port_);
+        chunk_done[chunk] = client.SendFileRequest(file_name);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  gettimeofday(&end_time, NULL);
+
+  double elapsed = std::max<double>(
+      1e-6, (end_time.tv_sec - start_time.tv_sec) +
+                (end_time.tv_usec - start_time.tv_usec) / 1e6);
+  LOG(INFO) << "Total flows: " << flows << " time: " << elapsed
+            << " s Throughput: " << missing_bytes / elapsed / (1024.0 * 1024.0)
+            << " MB/s";
+
+  /**
+   * 文件已经预先扩展到完整大小，失败的块会留下全 0 的空洞。
+   * 服务器丢弃会话时该流在空闲期限后返回失败，不会让 join 永远等待
+   */
+  int failed = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (!chunk_done[i]) {
+      LOG(ERROR) << "Chunk " << chunks[i].first << " + " << chunks[i].second
+                 << " failed";
+      failed++;
+    }
+  }
+  if (failed > 0) {
+    LOG(ERROR) << "Transfer incomplete, " << failed << " of " << chunks.size()
+               << " chunks failed"
+               << (resume ? ", run again with --resume" : "");
+    return false;
+  }
+
+  if (resume) {
+    std::vector<std::pair<int64_t, int64_t>> remaining =
+        checkpoint.MissingRanges();
+    if (!remaining.empty()) {
+      LOG(ERROR) << "Transfer incomplete, " << remaining.size()
+                 << " ranges missing, run again with --resume";
+      return false;
+    }
+    checkpoint.Remove();
+  }
+  return true;
+}
+}  // namespace safe_udp
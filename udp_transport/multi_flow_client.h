@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <string>
+
+#include "udp_client.h"
+
+namespace safe_udp {
+/**
+ * MultiFlowClient 类把一个大文件分成若干个连续的字节范围，每个范围由独立的
+ * UdpClient（独立的 socket 和端口，因而在服务器端是独立的会话，
+ * 有自己的滑动窗口和拥塞控制状态）在各自的线程中接收，
+ * 各流按字节偏移直接写入同一个本地文件，不需要再合并。
+ * 范围按 MAX_DATA_SIZE 对齐，除最后一个流外每个流都发送满载的数据段。
+ * 续传模式下用检查点（TransferCheckpoint）记录已经写入的区间，
+ * 再次运行时只把缺失的区间分给各个流。
+ */
+class MultiFlowClient {
+ public:
+  /** 对每个流的 UdpClient 应用相同的选项（窗口、丢包模拟、批量等） */
+  using ConfigureFn = std::function<void(UdpClient *)>;
+
+  /**
+   * 构造函数
+   * @param server_address 服务器 IP 地址
+   * @param port 服务器端口号
+   * @param flows 并行流的数量
+   */
+  MultiFlowClient(const std::string &server_address, const std::string &port,
+                  int flows);
+
+  /**
+   * 查询文件大小，创建本地文件并用多个流并行下载
+   * @param file_name 请求的文件名
+   * @param configure 配置每个流的 UdpClient
+   * @param resume 是否续传：已有检查点且本地文件大小一致时只请求缺失的区间，
+   *               否则从头开始；传输过程中都记录检查点，完成后删除
+   * @return 文件存在并且所有块都已完整接收返回 true；
+   *         服务器丢弃某个流的会话时，该流在空闲期限后失败，返回 false
+   */
+  bool Download(const std::string &file_name, const ConfigureFn &configure,
+                bool resume = false);
+
+ private:
+  std::string server_address_;  /* 服务器 IP 地址 */
+  std::string port_;            /* 服务器端口号 */
+  int flows_;                   /* 并行流的数量 */
+};
+}  // namespace safe_udp
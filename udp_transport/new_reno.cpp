@@ -0,0 +1,38 @@
+#include "new_reno.h"
+
+#include <algorithm>
+
+namespace safe_udp {
+/** 初始慢启动阈值，与原先的固定值保持一致 */
+constexpr double INITIAL_SSTHRESH = 128;
+/** 丢包后窗口的下限 */
+constexpr double MIN_CWND = 2;
+
+NewReno::NewReno() : cwnd_(1), ssthresh_(INITIAL_SSTHRESH) {}
+
+/**
+ * 恢复期间窗口保持不变，恢复结束后再继续增长
+ */
+void NewReno::OnAck(const AckSample &ack) {
+  if (ack.in_recovery) {
+    return;
+  }
+  if (cwnd_ < ssthresh_) {
+    cwnd_ += ack.acked_segments;
+  } else {
+    cwnd_ += (double)ack.acked_segments / cwnd_;
+  }
+}
+
+void NewReno::OnLoss(int64_t /*now_us*/) {
+  ssthresh_ = std::max(cwnd_ / 2, MIN_CWND);
+  cwnd_ = ssthresh_;
+}
+
+void NewReno::OnTimeout(int64_t /*now_us*/) {
+  ssthresh_ = std::max(cwnd_ / 2, MIN_CWND);
+  cwnd_ = 1;
+}
+
+int NewReno::cwnd() const { return std::max(1, (int)cwnd_); }
+}  // namespace safe_udp
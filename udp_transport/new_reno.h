@@ -0,0 +1,26 @@
+#pragma once
+#include "congestion_controller.h"
+
+namespace safe_udp {
+/**
+ * NewReno（RFC 6582 / RFC 5681）：慢启动每确认一个数据段窗口加一，
+ * 拥塞避免阶段每个 RTT 加一；丢包时窗口减半，超时后回到 1。
+ */
+class NewReno : public CongestionController {
+ public:
+  NewReno();
+
+  void OnAck(const AckSample &ack) override;
+  void OnLoss(int64_t now_us) override;
+  void OnTimeout(int64_t now_us) override;
+  void OnRttSample(int64_t /*rtt_us*/, int64_t /*now_us*/) override {}
+
+  int cwnd() const override;
+  bool in_slow_start() const override { return cwnd_ < ssthresh_; }
+  const char *name() const override { return "newreno"; }
+
+ private:
+  double cwnd_;     /* 拥塞窗口，保留小数以便拥塞避免阶段逐步增长 */
+  double ssthresh_; /* 慢启动阈值 */
+};
+}  // namespace safe_udp
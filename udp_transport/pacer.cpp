@@ -0,0 +1,56 @@
+#include "pacer.h"
+
+#include <algorithm>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+/**
+ * 一个量子约为 250 微秒的发送量：足够小以平滑突发，
+ * 又足够大使得每次定时器唤醒的系统调用开销可以分摊到多个数据报上
+ */
+constexpr double QUANTUM_US = 250;
+constexpr double MIN_QUANTUM_BYTES = 2 * MAX_PACKET_SIZE;
+constexpr double MAX_QUANTUM_BYTES = 64 * MAX_PACKET_SIZE;
+
+Pacer::Pacer()
+    : rate_(0), quantum_(MIN_QUANTUM_BYTES), tokens_(MIN_QUANTUM_BYTES),
+      last_refill_(0) {}
+
+void Pacer::SetRate(double bytes_per_sec, int64_t now_us) {
+  refill(now_us);
+  rate_ = std::max(0.0, bytes_per_sec);
+  quantum_ = std::min(std::max(rate_ * QUANTUM_US / 1e6, MIN_QUANTUM_BYTES),
+                      MAX_QUANTUM_BYTES);
+  tokens_ = std::min(tokens_, quantum_);
+}
+
+bool Pacer::CanSend(int64_t now_us) {
+  if (rate_ <= 0) {
+    return true;
+  }
+  refill(now_us);
+  return tokens_ > 0;
+}
+
+void Pacer::OnSent(int bytes) {
+  if (rate_ > 0) {
+    tokens_ -= bytes;
+  }
+}
+
+int64_t Pacer::DelayUntilNextSend() const {
+  if (rate_ <= 0 || tokens_ >= quantum_) {
+    return 0;
+  }
+  return (int64_t)((quantum_ - tokens_) * 1e6 / rate_) + 1;
+}
+
+void Pacer::refill(int64_t now_us) {
+  if (last_refill_ != 0 && now_us > last_refill_) {
+    tokens_ = std::min(quantum_,
+                       tokens_ + rate_ * (now_us - last_refill_) / 1e6);
+  }
+  last_refill_ = now_us;
+}
+}  // namespace safe_udp
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/**
+ * Pacer 类以令牌桶的方式把发送分散到整个 RTT 上。
+ * 令牌（字节）按发送速率持续累积，上限为一个发送量子，
+ * 每发出一个数据报扣除相应字节；令牌耗尽后等到再攒够一个量子才继续发送，
+ * 这样每次唤醒发出一小批数据报，既不会整窗突发，也不需要逐包设置定时器。
+ * 速率为 0 表示不限速。
+ */
+class Pacer {
+ public:
+  Pacer();
+
+  /**
+   * 设置发送速率，之前累积的令牌按旧速率结算
+   * @param bytes_per_sec 发送速率（字节/秒），0 表示不限速
+   * @param now_us 当前时间（微秒）
+   */
+  void SetRate(double bytes_per_sec, int64_t now_us);
+
+  /**
+   * 当前是否还有令牌可以发送一个数据报
+   * @param now_us 当前时间（微秒）
+   */
+  bool CanSend(int64_t now_us);
+
+  /**
+   * 记录一个已经发出的数据报，扣除相应令牌
+   * @param bytes 数据报字节数
+   */
+  void OnSent(int bytes);
+
+  /**
+   * 令牌重新攒够一个量子还需要等待的时间（微秒）
+   */
+  int64_t DelayUntilNextSend() const;
+
+  /** 当前发送速率（字节/秒） */
+  double rate() const { return rate_; }
+
+ private:
+  /** 按经过的时间补充令牌 */
+  void refill(int64_t now_us);
+
+  double rate_;          /* 发送速率（字节/秒），0 表示不限速 */
+  double quantum_;       /* 单次唤醒最多发送的字节数，也是令牌上限 */
+  double tokens_;        /* 当前令牌（字节），发送后可能为负 */
+  int64_t last_refill_;  /* 上一次补充令牌的时间（微秒） */
+};
+}  // namespace safe_udp
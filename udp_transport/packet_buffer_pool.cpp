@@ -0,0 +1,55 @@
+#include "packet_buffer_pool.h"
+
+#include <stdlib.h>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+PacketBufferPool::PacketBufferPool() {}
+
+/**
+ * 析构函数，释放全部 slab
+ */
+PacketBufferPool::~PacketBufferPool() {
+  for (char *slab : slabs_) {
+    free(slab);
+  }
+}
+
+PacketBufferPool &PacketBufferPool::Local() {
+  static thread_local PacketBufferPool pool;
+  return pool;
+}
+
+char *PacketBufferPool::Acquire() {
+  if (free_list_.empty()) {
+    grow();
+  }
+  char *buffer = free_list_.back();
+  free_list_.pop_back();
+  return buffer;
+}
+
+void PacketBufferPool::Release(char *buffer) {
+  if (buffer != nullptr) {
+    free_list_.push_back(buffer);
+  }
+}
+
+/**
+ * 一次申请 BUFFERS_PER_SLAB 个缓冲区。空闲链表预留出全部缓冲区的位置，
+ * 之后的 Release 不会再引起 vector 扩容。
+ */
+void PacketBufferPool::grow() {
+  char *slab = reinterpret_cast<char *>(
+      malloc(static_cast<size_t>(MAX_PACKET_SIZE) * BUFFERS_PER_SLAB));
+  if (slab == nullptr) {
+    abort();
+  }
+  slabs_.push_back(slab);
+  free_list_.reserve(capacity());
+  for (int i = BUFFERS_PER_SLAB - 1; i >= 0; i--) {
+    free_list_.push_back(slab + static_cast<size_t>(i) * MAX_PACKET_SIZE);
+  }
+}
+}  // namespace safe_udp
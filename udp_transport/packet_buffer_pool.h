@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+
+#include <vector>
+
+namespace safe_udp {
+/**
+ * PacketBufferPool 类管理固定大小（MAX_PACKET_SIZE）的数据包缓冲区。
+ * 每个线程拥有独立的空闲链表，缓冲区按块（slab）批量申请，
+ * 释放时只回到空闲链表而不归还给系统，稳定运行后申请与释放都不再触发堆分配。
+ * 缓冲区必须在申请它的线程上释放。
+ */
+class PacketBufferPool {
+ public:
+  /** 每次向系统申请的缓冲区数量 */
+  static constexpr int BUFFERS_PER_SLAB = 64;
+
+  PacketBufferPool();
+  ~PacketBufferPool();
+
+  PacketBufferPool(const PacketBufferPool &) = delete;
+  PacketBufferPool &operator=(const PacketBufferPool &) = delete;
+
+  /** 返回当前线程的缓冲池 */
+  static PacketBufferPool &Local();
+
+  /**
+   * 取出一个 MAX_PACKET_SIZE 字节的缓冲区，空闲链表为空时申请一个新的 slab
+   */
+  char *Acquire();
+
+  /**
+   * 归还缓冲区，nullptr 会被忽略
+   */
+  void Release(char *buffer);
+
+  /** 已向系统申请的缓冲区总数 */
+  size_t capacity() const { return slabs_.size() * BUFFERS_PER_SLAB; }
+
+  /** 当前空闲的缓冲区数量 */
+  size_t free_count() const { return free_list_.size(); }
+
+ private:
+  /** 申请一个新的 slab 并把其中的缓冲区放入空闲链表 */
+  void grow();
+
+  std::vector<char *> slabs_;      /* 已申请的 slab */
+  std::vector<char *> free_list_;  /* 空闲缓冲区 */
+};
+}  // namespace safe_udp
@@ -10,6 +10,10 @@ PacketStatistics::PacketStatistics() {
   slowStartPacketRxStatistics = 0; /**< 慢启动阶段接收到的数据包计数初始化 */
   congAvdPacketRxStatistics = 0;   /**< 拥塞避免阶段接收到的数据包计数初始化 */
   retransStatistics = 0;           /**< 重传数据包计数初始化 */
+  retransBytesStatistics = 0;      /**< 重传字节计数初始化 */
+  timeoutStatistics = 0;           /**< 重传超时计数初始化 */
+  fecParityStatistics = 0;         /**< FEC 校验段计数初始化 */
+  corruptAckStatistics = 0;        /**< 校验和错误的 ACK 计数初始化 */
 }
 
 /**
@@ -21,5 +21,9 @@ class PacketStatistics {
   int slowStartPacketRxStatistics; /**< 慢启动阶段接收到的数据包数量 */
   int congAvdPacketRxStatistics;   /**< 拥塞避免阶段接收到的数据包数量 */
   int retransStatistics;           /**< 数据包重传总次数 */
+  long retransBytesStatistics;     /**< 重传的载荷字节总数 */
+  int timeoutStatistics;           /**< 重传超时次数 */
+  int fecParityStatistics;         /**< 发送的 FEC 校验段数量 */
+  int corruptAckStatistics;        /**< 校验和错误而丢弃的 ACK 数量 */
 };
 }  // namespace safe_udp
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "reorder_buffer.h"
+
+namespace safe_udp {
+ReorderBuffer::ReorderBuffer(int window) : window_(window), base_(0) {
+  if (window_ < 1) {
+    window_ = 1;
+  }
+  int capacity = 64;
+  while (capacity < window_) {
+    capacity <<= 1;
+  }
+  mask_ = capacity - 1;
+  present_.assign(capacity / 64, 0);
+  lengths_.assign(capacity, 0);
+}
+
+bool ReorderBuffer::Insert(int index, int length) {
+  int slot = index & mask_;
+  if (present(slot)) {
+    return false;
+  }
+  present_[slot >> 6] |= uint64_t(1) << (slot & 63);
+  lengths_[slot] = length;
+  return true;
+}
+
+bool ReorderBuffer::PopInOrder(int *length) {
+  int slot = base_ & mask_;
+  if (!present(slot)) {
+    return false;
+  }
+  present_[slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+  *length = lengths_[slot];
+  base_++;
+  return true;
+}
+
+int ReorderBuffer::ReceivedRanges(int last_index, SegmentRange *ranges,
+                                  int max_ranges) const {
+  if (last_index - base_ >= window_) {
+    last_index = base_ + window_ - 1;
+  }
+  int count = 0;
+  int index = base_ + 1;
+  while (index <= last_index && count < max_ranges) {
+    if (!present(index & mask_)) {
+      index++;
+      continue;
+    }
+    ranges[count].first = index;
+    while (index <= last_index && present(index & mask_)) {
+      index++;
+    }
+    ranges[count].last = index - 1;
+    count++;
+  }
+  return count;
+}
+}  // namespace safe_udp
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+
+#include <vector>
+
+namespace safe_udp {
+/** 一段连续到达的数据段，first 与 last 均为下标且包含在内 */
+struct SegmentRange {
+  int first;
+  int last;
+};
+
+/**
+ * ReorderBuffer 类记录接收窗口内哪些数据段已经到达。
+ * 数据段按下标放入容量为 2 的幂的环形缓冲区，用位图标记是否存在，
+ * 只保存长度而不保存载荷（载荷到达时已经按偏移写入文件），
+ * 因此内存只与接收窗口有关，与文件大小无关。
+ */
+class ReorderBuffer {
+ public:
+  /**
+   * 构造函数
+   * @param window 接收窗口大小（数据段个数）
+   */
+  explicit ReorderBuffer(int window);
+
+  /**
+   * 数据段下标是否落在 [base, base + window) 之内
+   */
+  bool InWindow(int index) const {
+    return index >= base_ && index - base_ < window_;
+  }
+
+  /**
+   * 第 index 个数据段是否已经到达：窗口之前的都已按序移出，窗口内查位图
+   */
+  bool Contains(int index) const {
+    return index < base_ || (InWindow(index) && present(index & mask_));
+  }
+
+  /**
+   * 标记第 index 个数据段已经到达，index 必须在窗口内
+   * @param length 数据段载荷长度
+   * @return 首次到达返回 true，重复到达返回 false
+   */
+  bool Insert(int index, int length);
+
+  /**
+   * 如果下一个按序数据段（base）已经到达，则将其移出窗口
+   * @param length 输出该数据段的长度
+   * @return 成功移出返回 true
+   */
+  bool PopInOrder(int *length);
+
+  /**
+   * 收集 (base, last_index] 内已经到达的连续区间，用于生成 SACK 块
+   * @param last_index 扫描的最大下标（通常是收到的最大下标）
+   * @param ranges 输出区间，按下标递增
+   * @param max_ranges 最多输出的区间数量
+   * @return 实际输出的区间数量
+   */
+  int ReceivedRanges(int last_index, SegmentRange *ranges,
+                     int max_ranges) const;
+
+  /** 窗口内第 index 个数据段的长度，index 必须已经到达 */
+  int length(int index) const { return lengths_[index & mask_]; }
+
+  /** 下一个期望按序到达的数据段下标 */
+  int base() const { return base_; }
+
+ private:
+  /** 数据段下标对应的位图位是否置位 */
+  bool present(int slot) const {
+    return (present_[slot >> 6] >> (slot & 63)) & 1;
+  }
+
+  int window_;                      /* 接收窗口大小 */
+  int mask_;                        /* 环形缓冲区下标掩码 */
+  int base_;                        /* 下一个按序数据段的下标 */
+  std::vector<uint64_t> present_;   /* 到达位图 */
+  std::vector<uint16_t> lengths_;   /* 每个槽位的数据段长度 */
+};
+}  // namespace safe_udp
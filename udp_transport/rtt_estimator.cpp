@@ -0,0 +1,50 @@
+#include "rtt_estimator.h"
+
+#include <algorithm>
+
+namespace safe_udp {
+/**
+ * RFC 6298 建议 RTO 下限为 1 秒、初始值为 1 秒；本协议面向局域网和本机传输，
+ * 下限取 2 毫秒（定时器轮刻度的两倍），初始值取 200 毫秒
+ */
+constexpr int64_t INITIAL_RTO_US = 200 * 1000;
+constexpr int64_t MIN_RTO_US = 2 * 1000;
+/** 时钟粒度 G，与重传定时器轮的刻度一致 */
+constexpr int64_t CLOCK_GRANULARITY_US = 1000;
+/** 退避次数上限，2^MAX_BACKOFF 倍已经远超 MAX_RTO_US */
+constexpr int MAX_BACKOFF = 16;
+
+RttEstimator::RttEstimator()
+    : srtt_(0), rttvar_(0), rto_(INITIAL_RTO_US), backoff_(0) {}
+
+void RttEstimator::OnSample(int64_t rtt_ns, int expected_samples) {
+  rtt_ns = std::max<int64_t>(1, rtt_ns);
+  int64_t samples = std::max(1, expected_samples);
+  if (srtt_ == 0) {
+    srtt_ = rtt_ns;
+    rttvar_ = rtt_ns / 2;
+  } else {
+    /**
+     * RTTVAR 使用更新前的 SRTT：
+     * RTTVAR += (|SRTT - R| - RTTVAR) * beta / samples，
+     * SRTT += (R - SRTT) * alpha / samples
+     */
+    int64_t delta = srtt_ > rtt_ns ? srtt_ - rtt_ns : rtt_ns - srtt_;
+    rttvar_ += (delta - rttvar_) / (4 * samples);
+    srtt_ = std::max<int64_t>(1, srtt_ + (rtt_ns - srtt_) / (8 * samples));
+  }
+  rto_ = (srtt_ + std::max(CLOCK_GRANULARITY_US * 1000, 4 * rttvar_)) / 1000;
+  rto_ = std::min(std::max(rto_, MIN_RTO_US), MAX_RTO_US);
+  backoff_ = 0;
+}
+
+void RttEstimator::Backoff() {
+  if (backoff_ < MAX_BACKOFF) {
+    backoff_++;
+  }
+}
+
+int64_t RttEstimator::rto() const {
+  return std::min(rto_ << backoff_, MAX_RTO_US);
+}
+}  // namespace safe_udp
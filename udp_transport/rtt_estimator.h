@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/** RTO 上限（微秒），也是存活的会话两次发送之间的最长间隔 */
+constexpr int64_t MAX_RTO_US = 60 * 1000 * 1000;
+
+/**
+ * RttEstimator 类按 RFC 6298 估计 RTT 并计算重传超时（RTO）。
+ * 第一个样本直接初始化 SRTT 和 RTTVAR，之后按 alpha = 1/8、beta = 1/4 平滑；
+ * 超时后 RTO 指数退避，直到得到新的有效样本。
+ * 样本来自 ACK 回显的发送时间戳，每个 ACK 都有一个样本，
+ * 按 RFC 7323 附录 G 把 alpha、beta 除以每个 RTT 预期的样本数，
+ * 使平滑的时间跨度仍然约为 8 个 RTT。内部以纳秒保存，避免缩小后的增量被截断。
+ */
+class RttEstimator {
+ public:
+  RttEstimator();
+
+  /**
+   * 加入一个 RTT 样本并重新计算 RTO，同时清除退避
+   * @param rtt_ns RTT 样本（纳秒）
+   * @param expected_samples 每个 RTT 预期的样本数，即 ceil(在途数据段数 / 2)
+   */
+  void OnSample(int64_t rtt_ns, int expected_samples);
+
+  /**
+   * 超时后 RTO 加倍（RFC 6298 5.5），不超过上限
+   */
+  void Backoff();
+
+  /** 当前的重传超时（微秒），包含退避 */
+  int64_t rto() const;
+
+  /** 平滑 RTT（微秒），没有样本时为 0 */
+  int64_t srtt() const { return srtt_ / 1000; }
+
+  /** RTT 偏差（微秒） */
+  int64_t rttvar() const { return rttvar_ / 1000; }
+
+  /** 是否已经得到过样本 */
+  bool has_sample() const { return srtt_ != 0; }
+
+  /** 当前的退避次数 */
+  int backoff() const { return backoff_; }
+
+ private:
+  int64_t srtt_;    /* 平滑 RTT（纳秒） */
+  int64_t rttvar_;  /* RTT 偏差（纳秒） */
+  int64_t rto_;     /* 未退避的 RTO（微秒） */
+  int backoff_;     /* 连续退避次数 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,25 @@
+#include "segment_view.h"
+
+#include "crc32c.h"
+
+namespace safe_udp {
+bool SegmentView::Parse(const unsigned char *buffer, int length) {
+  buffer_ = nullptr;
+  length_ = 0;
+  if (length < HEADER_LENGTH || buffer[VERSION_OFFSET] != WIRE_VERSION ||
+      (buffer[FLAGS_OFFSET] &
+       ~(WIRE_FLAG_ACK | WIRE_FLAG_FIN | WIRE_FLAG_SYN)) != 0 ||
+      LoadBigEndian16(buffer + LENGTH_OFFSET) != length - HEADER_LENGTH) {
+    return false;
+  }
+  uint32_t checksum =
+      Crc32c::Extend(Crc32c::Value(buffer, CHECKSUM_OFFSET),
+                     buffer + HEADER_LENGTH, length - HEADER_LENGTH);
+  if (checksum != LoadBigEndian32(buffer + CHECKSUM_OFFSET)) {
+    return false;
+  }
+  buffer_ = buffer;
+  length_ = length;
+  return true;
+}
+}  // namespace safe_udp
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+
+#include "wire_format.h"
+
+namespace safe_udp {
+/**
+ * SegmentView 类在接收缓冲区上直接解析一个数据报，不拷贝也不申请内存。
+ * Parse 做完全部边界检查（长度、版本、载荷长度与数据报长度相符、校验和）后，
+ * 各字段按需从缓冲区读出；缓冲区必须在视图使用期间保持有效。
+ */
+class SegmentView {
+ public:
+  /**
+   * 解析 buffer[0, length)
+   * @return 数据报完整且校验和正确返回 true，否则视图无效
+   */
+  bool Parse(const unsigned char *buffer, int length);
+
+  /** 是否是 ACK */
+  bool ack() const { return flags() & WIRE_FLAG_ACK; }
+
+  /** 是否是最后一个数据段 */
+  bool fin() const { return flags() & WIRE_FLAG_FIN; }
+
+  /** 是否是握手数据段 */
+  bool syn() const { return flags() & WIRE_FLAG_SYN; }
+
+  /** 连接 ID */
+  uint32_t connection_id() const {
+    return LoadBigEndian32(buffer_ + CONNECTION_ID_OFFSET);
+  }
+
+  /** 序列号 */
+  uint32_t seq_number() const { return LoadBigEndian32(buffer_ + SEQ_OFFSET); }
+
+  /** 确认号（数据段中用于携带 FEC、压缩分组信息） */
+  uint32_t ack_number() const { return LoadBigEndian32(buffer_ + ACK_OFFSET); }
+
+  /** 时间戳（纳秒） */
+  int64_t timestamp() const {
+    return (int64_t)LoadBigEndian64(buffer_ + TIMESTAMP_OFFSET);
+  }
+
+  /** 载荷长度 */
+  int payload_length() const { return length_ - HEADER_LENGTH; }
+
+  /** 载荷，指向接收缓冲区内部 */
+  const char *payload() const {
+    return reinterpret_cast<const char *>(buffer_ + HEADER_LENGTH);
+  }
+
+ private:
+  uint8_t flags() const { return buffer_[FLAGS_OFFSET]; }
+
+  const unsigned char *buffer_ = nullptr; /* 数据报，不拥有内存 */
+  int length_ = 0;                        /* 数据报长度 */
+};
+}  // namespace safe_udp
@@ -0,0 +1,38 @@
+#include "session_accept.h"
+
+#include <climits>
+
+namespace safe_udp {
+bool SessionAccept::Parse(const DataSegment &segment, SessionAccept *accept) {
+  if (!segment.synFlag || segment.ackFlag ||
+      segment.dataLength != SESSION_ACCEPT_LENGTH) {
+    return false;
+  }
+  uint32_t window = LoadBigEndian32(segment.data_ + 4);
+  if (window == 0 || window > INT_MAX) {
+    return false;
+  }
+  accept->connectionId = segment.connectionId;
+  accept->initialSeqNumber = segment.seqNumber;
+  accept->clientToken = LoadBigEndian32(segment.data_);
+  accept->window = (int)window;
+  accept->maxSegmentSize = LoadBigEndian16(segment.data_ + 8);
+  accept->features = LoadBigEndian16(segment.data_ + 10);
+  return true;
+}
+
+void SessionAccept::ToSegment(char *payload, DataSegment *segment) const {
+  StoreBigEndian32(payload, clientToken);
+  StoreBigEndian32(payload + 4, window);
+  StoreBigEndian16(payload + 8, maxSegmentSize);
+  StoreBigEndian16(payload + 10, features);
+  segment->connectionId = connectionId;
+  segment->seqNumber = initialSeqNumber;
+  segment->ackNum = 0;
+  segment->ackFlag = false;
+  segment->finflag = false;
+  segment->synFlag = true;
+  segment->dataLength = SESSION_ACCEPT_LENGTH;
+  segment->data_ = payload;
+}
+}  // namespace safe_udp
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+#include "data_segment.h"
+
+namespace safe_udp {
+/** SessionAccept 载荷的长度 */
+constexpr int SESSION_ACCEPT_LENGTH = 12;
+
+/**
+ * SessionAccept 是服务器对传输请求的回复，握手的第二步。它是一个带 SYN 标志的
+ * 数据段：头部的连接 ID 是服务器分配的连接 ID，序列号是本次传输的初始序列号，
+ * 时间戳由客户端在确认 ACK 中回显，作为第一个 RTT 样本。
+ * 载荷（多字节字段为网络字节序）：
+ *   0  客户端令牌（4 字节，回显请求中的令牌）
+ *   4  协商后的窗口（4 字节，数据段个数）
+ *   8  最大载荷长度（2 字节）
+ *   10 协商后的功能标志（2 字节，双方都支持的 FEATURE_*）
+ * 客户端收到后发送一个确认号等于初始序列号的 ACK，服务器收到后才开始发送数据；
+ * 确认丢失时服务器按 RTO 重发 SessionAccept，客户端再次确认。
+ */
+struct SessionAccept {
+  uint32_t connectionId = 0;   /* 服务器分配的连接 ID */
+  uint32_t clientToken = 0;    /* 请求中的客户端令牌 */
+  int initialSeqNumber = 0;    /* 初始序列号 */
+  int window = 0;              /* 协商后的窗口（数据段个数） */
+  int maxSegmentSize = MAX_DATA_SIZE; /* 数据段的最大载荷长度 */
+  uint16_t features = 0;       /* 协商后的功能标志 */
+
+  /**
+   * 从握手数据段解析
+   * @return 是 SYN 数据段且载荷长度正确返回 true
+   */
+  static bool Parse(const DataSegment &segment, SessionAccept *accept);
+
+  /**
+   * 填写握手数据段，载荷写入 payload（SESSION_ACCEPT_LENGTH 字节），
+   * segment 的 data_ 指向 payload
+   */
+  void ToSegment(char *payload, DataSegment *segment) const;
+};
+}  // namespace safe_udp
@@ -3,14 +3,25 @@
 namespace safe_udp
 {
 /**
- * 构造函数，初始化滑动窗口相关状态变量
+ * 构造函数，初始化滑动窗口相关状态变量，并一次性分配环形缓冲区
  */
-SlidingWindow::SlidingWindow()
+SlidingWindow::SlidingWindow(int initial_seq_number, int max_window)
 {
   lastSendPacketSeq = -1; /**< 最后一个已发送的数据包索引 */
   lastAckedPacketSeq = -1; /**< 最后一个被确认的数据包索引 */
   sendBaseSeq = -1; /**< 当前发送窗口的基序号 */
   dupAckNum = 0; /**< 重复 ACK 计数，用于快速重传判断 */
+  highestSackedPacketSeq = -1; /**< 尚未收到任何 SACK */
+  highRetransmitSeq = -1; /**< 尚未重传任何空洞 */
+  initial_seq_number_ = initial_seq_number;
+
+  int capacity = 1;
+  while (capacity < max_window)
+  {
+    capacity <<= 1;
+  }
+  mask_ = capacity - 1;
+  sliding_window_buffers_.resize(capacity);
 }
 
 /**
@@ -21,13 +32,64 @@ SlidingWindow::~SlidingWindow()
 }
 
 /**
- * 将数据缓冲区添加到滑动窗口缓冲区列表中
- * @param buffer 待添加的滑动窗口缓冲区对象
- * @return 返回添加后的索引位置
+ * 将新发送的数据段记录到环形缓冲区中
+ * @param seq_number 数据段序列号
+ * @param data_length 数据段载荷长度
+ * @return 返回该数据段的下标
+ */
+int SlidingWindow::AddToBuffer(int seq_number, int data_length)
+{
+  int index = lastSendPacketSeq + 1;
+  SlidWinBuffer& buffer = At(index);
+  buffer.currSeqNum = seq_number;
+  buffer.dataLength = data_length;
+  buffer.retransmitCount = 0;
+  buffer.sacked = false;
+  return index; /**< 返回插入位置的索引 */
+}
+
+/**
+ * 标记 SACK 块覆盖的数据段，只处理仍在窗口内的部分
+ * @param start_seq 区间起始序列号
+ * @param end_seq 区间结束序列号（不含）
+ */
+void SlidingWindow::MarkSacked(int start_seq, int end_seq)
+{
+  if (end_seq <= start_seq)
+  {
+    return;
+  }
+  int first = IndexOf(start_seq);
+  int last = IndexOf(end_seq - 1);
+  if (first <= lastAckedPacketSeq)
+  {
+    first = lastAckedPacketSeq + 1;
+  }
+  if (last > lastSendPacketSeq)
+  {
+    last = lastSendPacketSeq;
+  }
+  for (int i = first; i <= last; i++)
+  {
+    At(i).sacked = true;
+  }
+  if (last >= first && last > highestSackedPacketSeq)
+  {
+    highestSackedPacketSeq = last;
+  }
+}
+
+/**
+ * 按序列号直接定位数据段，O(1)
  */
-int SlidingWindow::AddToBuffer(const SlidWinBuffer& buffer)
+SlidWinBuffer* SlidingWindow::Find(int seq_number)
 {
-  sliding_window_buffers_.push_back(buffer); /**< 将缓冲区压入向量 */
-  return (sliding_window_buffers_.size() - 1); /**< 返回插入位置的索引 */
+  int index = IndexOf(seq_number);
+  if (index <= lastAckedPacketSeq || index > lastSendPacketSeq)
+  {
+    return nullptr;
+  }
+  SlidWinBuffer& buffer = At(index);
+  return buffer.currSeqNum == seq_number ? &buffer : nullptr;
 }
-} // namespace safe_udp
\ No newline at end of file
+} // namespace safe_udp
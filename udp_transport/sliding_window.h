@@ -1,23 +1,77 @@
 #pragma once
 #include <vector>
 #include "buffer.h"
+#include "data_segment.h"
 
 namespace safe_udp
 {
-/** 滑动窗口类，用于管理数据包的发送与确认 */
+/**
+ * 滑动窗口类，用于管理数据包的发送与确认。
+ * 已发送未确认的数据段保存在容量为 2 的幂的环形缓冲区中，
+ * 第 i 个数据段（序列号 initial_seq + i * MAX_DATA_SIZE）存放在槽位 i & mask 上，
+ * 内存占用只与最大窗口有关，与文件大小无关。
+ */
 class SlidingWindow
 {
 public:
-  /** 构造函数 */
-  SlidingWindow();
+  /**
+   * 构造函数
+   * @param initial_seq_number 第一个数据段的序列号
+   * @param max_window 同时在途的最大数据段数，容量向上取整为 2 的幂
+   */
+  SlidingWindow(int initial_seq_number, int max_window);
   /** 析构函数 */
   ~SlidingWindow();
 
-  /** 将数据包添加到滑动窗口缓冲区 */
-  int AddToBuffer(const SlidWinBuffer& buffer);
+  /**
+   * 记录下一个新发送的数据段，调用前需保证窗口未满
+   * @return 该数据段的下标
+   */
+  int AddToBuffer(int seq_number, int data_length);
+
+  /** 按下标取数据段记录，下标须位于 (lastAckedPacketSeq, lastSendPacketSeq] */
+  SlidWinBuffer& At(int index) { return sliding_window_buffers_[index & mask_]; }
+
+  /** 数据段下标对应的环形缓冲区槽位 */
+  int SlotOf(int index) const { return index & mask_; }
+
+  /**
+   * 槽位上当前在途数据段的下标，
+   * 槽位须对应 (lastAckedPacketSeq, lastSendPacketSeq] 内的数据段
+   */
+  int IndexOfSlot(int slot) const
+  {
+    int base = lastAckedPacketSeq + 1;
+    return base + ((slot - base) & mask_);
+  }
+
+  /** 由序列号计算数据段下标 */
+  int IndexOf(int seq_number) const
+  {
+    return (seq_number - initial_seq_number_) / MAX_DATA_SIZE;
+  }
+
+  /**
+   * 按序列号查找已发送未确认的数据段
+   * @return 数据段记录，不在窗口内时返回 nullptr
+   */
+  SlidWinBuffer* Find(int seq_number);
+
+  /**
+   * 根据 SACK 块 [start_seq, end_seq) 标记窗口内已被接收方收到的数据段，
+   * 并更新 highestSackedPacketSeq
+   */
+  void MarkSacked(int start_seq, int end_seq);
+
+  /** 在途数据段是否已占满环形缓冲区 */
+  bool IsFull() const
+  {
+    return lastSendPacketSeq - lastAckedPacketSeq >= capacity();
+  }
+
+  /** 环形缓冲区容量 */
+  int capacity() const { return mask_ + 1; }
 
-  /** 存储滑动窗口中的数据包缓冲区 */
-  std::vector<SlidWinBuffer> sliding_window_buffers_;
   /** 最后一个发送的数据包的序列号 */
   int lastSendPacketSeq;
   /** 最后一个被确认的数据包的序列号 */
@@ -26,5 +80,17 @@ public:
   int sendBaseSeq;
   /** 重复确认的数量 */
   int dupAckNum;
+  /** 被 SACK 的最大数据段下标，-1 表示没有 */
+  int highestSackedPacketSeq;
+  /** 本轮恢复中已经检查并重传到的最大下标（RFC 6675 HighRxt） */
+  int highRetransmitSeq;
+
+private:
+  /** 存储滑动窗口中的数据包缓冲区（环形） */
+  std::vector<SlidWinBuffer> sliding_window_buffers_;
+  /** 下标掩码，容量减一 */
+  int mask_;
+  /** 第一个数据段的序列号 */
+  int initial_seq_number_;
 };
-} // namespace safe_udp
\ No newline at end of file
+} // namespace safe_udp
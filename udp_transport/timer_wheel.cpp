@@ -0,0 +1,124 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace safe_udp {
+TimerWheel::TimerWheel(int capacity, int64_t tick_us)
+    : tick_us_(std::max<int64_t>(1, tick_us)),
+      current_(0),
+      size_(0),
+      nodes_(capacity),
+      heads_(LEVELS * SLOTS, -1) {}
+
+void TimerWheel::Schedule(int id, int64_t deadline_us, int64_t now_us) {
+  Cancel(id);
+  /** 空闲时直接跳到当前时间，不逐个刻度推进 */
+  if (size_ == 0) {
+    current_ = std::max(current_, now_us / tick_us_);
+  }
+  nodes_[id].expires = (deadline_us + tick_us_ - 1) / tick_us_;
+  insert(id, current_ + 1);
+  size_++;
+}
+
+void TimerWheel::Cancel(int id) {
+  if (!IsScheduled(id)) {
+    return;
+  }
+  unlink(id);
+  size_--;
+}
+
+void TimerWheel::Advance(int64_t now_us, std::vector<int> *expired) {
+  int64_t target = now_us / tick_us_;
+  while (current_ < target) {
+    if (size_ == 0) {
+      current_ = target;
+      return;
+    }
+    int64_t tick = current_ + 1;
+    /** 先下放最高层，再下放第 1 层，保证本刻度到期的定时器都回到第 0 层 */
+    if ((tick & ((1 << (2 * SLOT_BITS)) - 1)) == 0) {
+      cascade(2, tick);
+    }
+    if ((tick & SLOT_MASK) == 0) {
+      cascade(1, tick);
+    }
+
+    int bucket = tick & SLOT_MASK;
+    while (heads_[bucket] != -1) {
+      int id = heads_[bucket];
+      unlink(id);
+      size_--;
+      expired->push_back(id);
+    }
+    current_ = tick;
+  }
+}
+
+int64_t TimerWheel::NextExpiry() const {
+  if (size_ == 0) {
+    return -1;
+  }
+  for (int64_t tick = current_ + 1; tick <= current_ + SLOTS; tick++) {
+    if ((tick & SLOT_MASK) == 0) {
+      break;
+    }
+    if (heads_[tick & SLOT_MASK] != -1) {
+      return tick * tick_us_;
+    }
+  }
+  /** 第 0 层在本圈内为空，下一次需要处理的是第 1 层的下放 */
+  return (((current_ >> SLOT_BITS) + 1) << SLOT_BITS) * tick_us_;
+}
+
+void TimerWheel::insert(int id, int64_t base) {
+  Node &node = nodes_[id];
+  int64_t expires = std::max(node.expires, base);
+  int64_t delta = expires - base;
+
+  int bucket;
+  if (delta < SLOTS) {
+    bucket = expires & SLOT_MASK;
+  } else if (delta < (1 << (2 * SLOT_BITS))) {
+    bucket = SLOTS + ((expires >> SLOT_BITS) & SLOT_MASK);
+  } else {
+    /** 超出时间轮范围的先放在最高层最远的槽位，下放时再重新分配 */
+    int64_t limit = base + (1 << (3 * SLOT_BITS)) - 1;
+    expires = std::min(expires, limit);
+    bucket = 2 * SLOTS + ((expires >> (2 * SLOT_BITS)) & SLOT_MASK);
+  }
+
+  node.bucket = bucket;
+  node.prev = -1;
+  node.next = heads_[bucket];
+  if (node.next != -1) {
+    nodes_[node.next].prev = id;
+  }
+  heads_[bucket] = id;
+}
+
+void TimerWheel::unlink(int id) {
+  Node &node = nodes_[id];
+  if (node.prev != -1) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    heads_[node.bucket] = node.next;
+  }
+  if (node.next != -1) {
+    nodes_[node.next].prev = node.prev;
+  }
+  node.prev = node.next = node.bucket = -1;
+}
+
+void TimerWheel::cascade(int level, int64_t tick) {
+  int bucket = level * SLOTS + ((tick >> (level * SLOT_BITS)) & SLOT_MASK);
+  int id = heads_[bucket];
+  heads_[bucket] = -1;
+  while (id != -1) {
+    int next = nodes_[id].next;
+    insert(id, tick);
+    id = next;
+  }
+}
+}  // namespace safe_udp
@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+#include <vector>
+
+namespace safe_udp {
+/**
+ * TimerWheel 类是一个三层的分层时间轮，为固定数量的定时器（按 id 索引，
+ * 0 <= id < capacity）维护到期时间。每层 64 个槽位，第 0 层一个槽位一个刻度，
+ * 上层一个槽位覆盖下一层一整圈；上层槽位轮到时把其中的定时器重新分配到下层。
+ * 启动、取消都是 O(1)，推进时只访问经过的槽位，到期时间以刻度为粒度向上取整，
+ * 不会提前到期。定时器节点预先分配，运行中不申请内存。
+ */
+class TimerWheel {
+ public:
+  /**
+   * 构造函数
+   * @param capacity 定时器数量
+   * @param tick_us 刻度（微秒）
+   */
+  TimerWheel(int capacity, int64_t tick_us);
+
+  /**
+   * 启动（或重新启动）定时器
+   * @param id 定时器 id
+   * @param deadline_us 到期时间（微秒）
+   * @param now_us 当前时间（微秒）
+   */
+  void Schedule(int id, int64_t deadline_us, int64_t now_us);
+
+  /** 取消定时器，未启动时什么也不做 */
+  void Cancel(int id);
+
+  /** 定时器是否已经启动 */
+  bool IsScheduled(int id) const { return nodes_[id].bucket >= 0; }
+
+  /**
+   * 推进到当前时间，并取出所有已经到期的定时器
+   * @param now_us 当前时间（微秒）
+   * @param expired 追加到期的定时器 id
+   */
+  void Advance(int64_t now_us, std::vector<int> *expired);
+
+  /**
+   * 下一次需要推进的时间（微秒）：最近一个非空的第 0 层槽位，
+   * 或者上层槽位下一次下放的时间；没有定时器时返回 -1
+   */
+  int64_t NextExpiry() const;
+
+  /** 已启动的定时器数量 */
+  int size() const { return size_; }
+
+ private:
+  static constexpr int LEVELS = 3;
+  static constexpr int SLOT_BITS = 6;
+  static constexpr int SLOTS = 1 << SLOT_BITS;
+  static constexpr int SLOT_MASK = SLOTS - 1;
+
+  struct Node {
+    int prev = -1;
+    int next = -1;
+    int bucket = -1;       /* 所在槽位（level * SLOTS + slot），-1 表示未启动 */
+    int64_t expires = 0;   /* 到期刻度 */
+  };
+
+  /** 按到期刻度与 base（第一个尚未处理的刻度）的距离放入对应层的槽位 */
+  void insert(int id, int64_t base);
+  /** 从所在槽位的链表中摘除 */
+  void unlink(int id);
+  /** 把上层的一个槽位重新分配到下层 */
+  void cascade(int level, int64_t tick);
+
+  int64_t tick_us_;           /* 刻度（微秒） */
+  int64_t current_;           /* 已经处理到的刻度 */
+  int size_;                  /* 已启动的定时器数量 */
+  std::vector<Node> nodes_;   /* 定时器节点，按 id 索引 */
+  std::vector<int> heads_;    /* 每个槽位链表的头节点，-1 表示空 */
+};
+}  // namespace safe_udp
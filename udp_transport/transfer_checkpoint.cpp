@@ -0,0 +1,117 @@
+#include "transfer_checkpoint.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <glog/logging.h>
+
+namespace safe_udp {
+/** 检查点文件第一行，格式变化时修改版本号 */
+constexpr char CHECKPOINT_HEADER[] = "safe-udp-checkpoint 1";
+
+TransferCheckpoint::TransferCheckpoint(const std::string &file_path)
+    : path_(file_path + CHECKPOINT_SUFFIX), file_size_(0) {}
+
+bool TransferCheckpoint::Load(int64_t file_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ranges_.clear();
+  std::ifstream in(path_);
+  std::string header;
+  std::string key;
+  int64_t recorded_size = -1;
+  if (!std::getline(in, header) || header != CHECKPOINT_HEADER ||
+      !(in >> key >> recorded_size) || key != "size" ||
+      recorded_size != file_size) {
+    return false;
+  }
+  file_size_ = file_size;
+
+  int64_t start, end;
+  while (in >> start >> end) {
+    if (start < 0 || end <= start || end > file_size_) {
+      ranges_.clear();
+      return false;
+    }
+    ranges_[start] = end;
+  }
+  return in.eof();
+}
+
+void TransferCheckpoint::Reset(int64_t file_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  file_size_ = file_size;
+  ranges_.clear();
+  save();
+}
+
+void TransferCheckpoint::Update(int data_fd, int64_t start, int64_t end) {
+  if (end <= start) {
+    return;
+  }
+  /** 数据先落盘，检查点才能声明它已经写入 */
+  if (data_fd >= 0 && fdatasync(data_fd) < 0) {
+    LOG(ERROR) << "Failed to sync data before checkpoint !!!";
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  /** 与前面相接或重叠的区间合并 */
+  auto it = ranges_.upper_bound(start);
+  if (it != ranges_.begin() && std::prev(it)->second >= start) {
+    --it;
+    start = it->first;
+    end = std::max(end, it->second);
+  }
+  /** 吞并后面被覆盖或相接的区间 */
+  while (it != ranges_.end() && it->first <= end) {
+    end = std::max(end, it->second);
+    it = ranges_.erase(it);
+  }
+  ranges_[start] = end;
+  save();
+}
+
+std::vector<std::pair<int64_t, int64_t>> TransferCheckpoint::MissingRanges()
+    const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<int64_t, int64_t>> missing;
+  int64_t position = 0;
+  for (const auto &range : ranges_) {
+    if (range.first > position) {
+      missing.emplace_back(position, range.first);
+    }
+    position = std::max(position, range.second);
+  }
+  if (position < file_size_) {
+    missing.emplace_back(position, file_size_);
+  }
+  return missing;
+}
+
+void TransferCheckpoint::Remove() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  unlink(path_.c_str());
+}
+
+void TransferCheckpoint::save() {
+  std::string temp_path = path_ + ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::trunc);
+    out << CHECKPOINT_HEADER << "\n" << "size " << file_size_ << "\n";
+    for (const auto &range : ranges_) {
+      out << range.first << " " << range.second << "\n";
+    }
+    if (!out) {
+      LOG(ERROR) << "Failed to write checkpoint " << temp_path << " !!!";
+      return;
+    }
+  }
+  if (rename(temp_path.c_str(), path_.c_str()) < 0) {
+    LOG(ERROR) << "Failed to replace checkpoint " << path_ << " !!!";
+  }
+}
+}  // namespace safe_udp
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace safe_udp {
+/** 检查点文件名后缀 */
+constexpr char CHECKPOINT_SUFFIX[] = ".ckpt";
+
+/**
+ * TransferCheckpoint 类是断点续传使用的旁路检查点文件（<文件>.ckpt），
+ * 记录本地文件中已经完整写入的字节区间。各流在接收过程中周期性地报告
+ * 自己按序写入的前缀；更新时先同步数据文件，再写临时文件并 rename 替换，
+ * 所以检查点中的区间在崩溃后仍然有效。重新运行时只需请求缺失的区间。
+ * 多个流线程共用一个检查点，内部加锁。
+ */
+class TransferCheckpoint {
+ public:
+  /**
+   * 构造函数
+   * @param file_path 本地数据文件路径，检查点为 file_path + CHECKPOINT_SUFFIX
+   */
+  explicit TransferCheckpoint(const std::string &file_path);
+
+  /**
+   * 读取已有的检查点
+   * @param file_size 服务器上的文件大小
+   * @return 检查点存在、格式正确且记录的文件大小一致时返回 true
+   */
+  bool Load(int64_t file_size);
+
+  /**
+   * 丢弃已有记录，从空的检查点重新开始并立即保存
+   * @param file_size 服务器上的文件大小
+   */
+  void Reset(int64_t file_size);
+
+  /**
+   * 记录 [start, end) 已经写入，与已有区间合并后保存
+   * @param data_fd 数据文件描述符，保存前先 fdatasync
+   */
+  void Update(int data_fd, int64_t start, int64_t end);
+
+  /** 尚未写入的区间 [start, end)，按起点递增 */
+  std::vector<std::pair<int64_t, int64_t>> MissingRanges() const;
+
+  /** 传输完成后删除检查点文件 */
+  void Remove();
+
+ private:
+  /** 写临时文件并 rename 替换检查点，调用者持有锁 */
+  void save();
+
+  std::string path_;                  /* 检查点文件路径 */
+  int64_t file_size_;                 /* 文件大小 */
+  std::map<int64_t, int64_t> ranges_; /* 已写入的区间，起点 -> 终点，互不相邻 */
+  mutable std::mutex mutex_;
+};
+}  // namespace safe_udp
@@ -1,15 +1,49 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
 #include <stdlib.h>
-#include <fstream>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <glog/logging.h>
 /* 引入其他所需的自己写的头文件*/
 #include "udp_client.h"
 #include "data_segment.h"
+#include "datagram_batch.h"
+#include "file_request.h"
+#include "rtt_estimator.h"
+#include "session_accept.h"
 
 namespace safe_udp
 {
+    /** 请求（文件大小查询和握手）的重发间隔和次数 */
+    constexpr int REQUEST_TIMEOUT_MS = 200;
+    constexpr int REQUEST_RETRIES = 5;
+    /** 服务器的错误回复，不带头部的纯文本 */
+    static const char kFileNotFound[] = "FILE NOT FOUND";
+    /** 检查点的更新间隔（微秒），中断后最多重传这段时间内收到的数据 */
+    constexpr int64_t CHECKPOINT_INTERVAL_US = 100 * 1000;
+    /**
+     * 接收的空闲期限（微秒）：服务器在会话存活期间至少每个 RTO 重传一次，
+     * RTO 不超过 MAX_RTO_US，超过这段时间没有任何数据报说明服务器已经放弃了会话
+     */
+    constexpr int64_t IDLE_TIMEOUT_US = MAX_RTO_US + 5 * 1000 * 1000;
+    /** 多文件传输中按序字节积累到该长度后才写出到各文件，减少小块拷贝 */
+    constexpr int BUNDLE_DRAIN_BYTES = 256 * 1024;
+
+    /** 单调时钟的当前时间（微秒），用于 ACK 延迟定时 */
+    static int64_t nowMicros()
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return (int64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+    }
+
     /**
      * 构造函数，初始化客户端接收数据包的状态变量
      */
@@ -18,30 +52,50 @@ namespace safe_udp
         lastPacketInOrder = -1; /**< 最后一个按序到达的数据包索引 */
         lastPacketReceived = -1; /**< 最后一个接收到的数据包索引 */
         isFinFlagReceived = false; /**< 是否接收到结束标志 FIN */
+        batchSize = MAX_BATCH_SIZE; /**< 单次 recvmmsg 最多接收的数据报数量 */
+        isGro = false; /**< 默认不开启 UDP GRO */
+        ackEvery = DEFAULT_ACK_EVERY; /**< 默认每两个按序数据段确认一次 */
+        ackDelayUs = DEFAULT_ACK_DELAY_US; /**< ACK 最长延迟 */
+        file_fd_ = -1;
+        connection_id_ = 0;
+        client_token_ = 0;
+        next_seq_expected_ = 0;
+        duplicate_segments_ = 0;
+        acks_sent_ = 0;
+        fec_parity_received_ = 0;
+        rangeOffset = 0; /**< 默认请求整个文件 */
+        rangeLength = -1;
+        checkpoint = nullptr;
+        checkpoint_bytes_ = 0;
+        isCorrupt = false;
+        corrupt_segments_ = 0;
+        compression = Compression::NONE; /**< 默认不压缩 */
+        stream_fd_ = -1;
+        next_block_first_ = 0;
+        raw_prefix_ = 0;
+        bundle = false; /**< 默认请求单个文件 */
+        bundle_parsed_ = false;
+        bundle_entry_ = 0;
+        bundle_out_fd_ = -1;
+        bundle_drained_ = 0;
+        bundle_files_written_ = 0;
+        write_failed_ = false;
     }
 
     /**
      * 发送文件请求并接收文件内容
      * @param file_name 请求的文件名
+     * @return 收到 FIN 且所有数据都已写入文件返回 true
      */
-    void UdpClient::SendFileRequest(const std::string& file_name)
+    bool UdpClient::SendFileRequest(const std::string& file_name)
     {
         int n;
-        int next_seq_expected;
-        int segments_in_between = 0;
-        initSeqNum = 67; /**< 初始化起始序列号 */
 
         if (receiverWindow == 0)
         {
             receiverWindow = 100; /**< 设置默认接收窗口大小 */
         }
 
-        /**
-         * 分配接收缓冲区
-         */
-        unsigned char* buffer =
-            (unsigned char*)calloc(MAX_PACKET_SIZE, sizeof(unsigned char));
-
         /**
          * 打印服务器地址信息
          */
@@ -50,216 +104,911 @@ namespace safe_udp
         LOG(INFO) << "server_add_family::" << server_address_.sin_family;
 
         /**
-         * 向服务器发送文件请求
+         * 请求同时是握手的第一步：带上接收窗口、最大载荷长度和支持的功能，
+         * 服务器回复 SessionAccept 后才知道连接 ID 和初始序列号
          */
-        n = sendto(sockfd_, file_name.c_str(), file_name.size(), 0,
-                   (struct sockaddr*)&(server_address_), sizeof(struct sockaddr_in));
-        if (n < 0)
+        client_token_ = std::random_device{}();
+        FileRequest request;
+        request.fileName = file_name;
+        /** 多文件请求中的名字以换行分隔，整个字节流按原样发送，不压缩 */
+        if (bundle)
         {
-            LOG(ERROR) << "Failed to write to socket !!!";
+            std::replace(request.fileName.begin(), request.fileName.end(), ',', '\n');
+            request.bundle = true;
+            if (compression != Compression::NONE)
+            {
+                LOG(INFO) << "Compression is not used for a bundle";
+                compression = Compression::NONE;
+            }
+        }
+        request.offset = rangeOffset;
+        request.length = rangeLength;
+        request.compression = compression;
+        request.clientToken = client_token_;
+        request.window = receiverWindow;
+        request.maxSegmentSize = MAX_DATA_SIZE;
+        request.features = FEATURE_FEC;
+        std::string request_data = request.Serialize();
+        if (request_data.size() > (size_t)MAX_PACKET_SIZE)
+        {
+            LOG(ERROR) << "The request of " << request_data.size()
+                << " bytes does not fit in one datagram !!!";
+            return false;
+        }
+        int64_t accept_timestamp = 0;
+        if (!handshake(request_data, &accept_timestamp))
+        {
+            return false;
         }
-        memset(buffer, 0, MAX_PACKET_SIZE);
 
         /**
-         * 打开本地文件准备写入
+         * 打开本地文件准备写入，数据段到达后直接按偏移写入。
+         * 只接收一个范围时文件由调用者创建，其他范围可能正在并行写入，不能截断
          */
-        std::fstream file;
-        std::string file_path = std::string(CLIENT_FILE_PATH) + file_name;
-        file.open(file_path.c_str(), std::ios::out);
+        if (!bundle)
+        {
+            std::string file_path = std::string(CLIENT_FILE_PATH) + file_name;
+            int open_flags = O_RDWR | O_CREAT | (rangeLength < 0 ? O_TRUNC : 0);
+            file_fd_ = open(file_path.c_str(), open_flags, 0644);
+            if (file_fd_ < 0)
+            {
+                LOG(ERROR) << "Failed to open " << file_path << " !!!";
+                write_failed_ = true;
+            }
+        }
 
         /**
-         * 循环接收数据包
+         * 压缩时数据段先写入匿名暂存文件，分组收齐后再解压写入输出文件；
+         * 多文件传输同样先写入暂存文件，按序到达后再拷贝到各自的文件
          */
-        while ((n = recvfrom(sockfd_, buffer, MAX_PACKET_SIZE, 0, NULL, NULL)) > 0)
+        stream_fd_ = file_fd_;
+        if (compression != Compression::NONE || bundle)
         {
-            char buffer2[20];
-            memcpy(buffer2, buffer, 20);
-            if (strstr("FILE NOT FOUND", buffer2) != NULL)
+            char spool_path[] = "/tmp/safe_udp_stream_XXXXXX";
+            stream_fd_ = mkstemp(spool_path);
+            if (stream_fd_ < 0)
             {
-                LOG(ERROR) << "File not found !!!";
-                return;
+                LOG(ERROR) << "Failed to create the stream spool file !!!";
+                write_failed_ = true;
+            }
+            else
+            {
+                unlink(spool_path);
             }
+        }
 
-            /**
-             * 反序列化数据包
-             */
-            std::unique_ptr<DataSegment> data_segment = std::make_unique<DataSegment>();
-            data_segment->DeserializeToDataSegment(buffer, n);
+        /**
+         * 接收窗口内的乱序数据段只记录到达位图，内存与文件大小无关
+         */
+        reorder_buffer_ = std::make_unique<ReorderBuffer>(receiverWindow);
+        ack_policy_ = std::make_unique<AckPolicy>(ackEvery, ackDelayUs);
+        fec_decoder_ = std::make_unique<FecDecoder>();
+        next_seq_expected_ = initSeqNum;
 
-            LOG(INFO) << "packet received with seqNumber:"
-                << data_segment->seqNumber;
+        /**
+         * 准备好接收后确认 SessionAccept，服务器收到确认才开始发送
+         */
+        send_ack(initSeqNum, accept_timestamp);
 
-            /**
-             * 模拟随机丢包
-             */
-            if (isPacketDrop&& rand() %100 < probValue
-            )
+        /**
+         * 循环批量接收数据包：recvmmsg 阻塞到至少一个数据报到达，
+         * 然后一次取走所有已经排队的数据报。
+         * 有延迟的 ACK 时先用 ppoll 等到延迟期限，期间没有新数据就发出 ACK
+         */
+        /**
+         * 接收超时作为空闲期限：recvmmsg 阻塞等待第一个数据报时受 SO_RCVTIMEO 限制，
+         * 服务器放弃会话（包括握手确认丢失）后不会永远阻塞，检查点随后照常保存。
+         * 不在每批接收前另做一次 ppoll，接收路径不增加系统调用
+         */
+        struct timeval idle_timeout = {(time_t)(IDLE_TIMEOUT_US / 1000000),
+                                       (suseconds_t)(IDLE_TIMEOUT_US % 1000000)};
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &idle_timeout,
+                       sizeof(idle_timeout)) < 0)
+        {
+            LOG(ERROR) << "Failed to set the receive timeout !!!";
+        }
+        RecvBatch recv_batch(batchSize);
+        if (isGro)
+        {
+            recv_batch.EnableGro(sockfd_);
+        }
+        int64_t start_time = nowMicros();
+        int64_t checkpoint_time = start_time;
+        bool receiving = true;
+        while (receiving)
+        {
+            if (ack_policy_->pending())
             {
-                LOG(INFO) << "Dropping this packet with seq "
-                    << data_segment->seqNumber;
-                continue;
+                int64_t wait_us =
+                    std::max<int64_t>(0, ack_policy_->deadline() - nowMicros());
+                struct pollfd pfd = {sockfd_, POLLIN, 0};
+                struct timespec timeout = {(time_t)(wait_us / 1000000),
+                                           (long)(wait_us % 1000000) * 1000};
+                if (wait_us == 0 || ppoll(&pfd, 1, &timeout, NULL) <= 0)
+                {
+                    flushAck();
+                }
+            }
+            if ((n = recv_batch.Receive(sockfd_, MSG_WAITFORONE)) <= 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    LOG(ERROR) << "No data from the server for "
+                        << IDLE_TIMEOUT_US / 1000000 << " s, giving up !!!";
+                }
+                break;
             }
+            for (int i = 0; i < n && receiving; i++)
+            {
+                receiving = handleSegment(recv_batch.data(i),
+                                          recv_batch.length(i));
+            }
+            if (checkpoint != nullptr &&
+                nowMicros() - checkpoint_time >= CHECKPOINT_INTERVAL_US)
+            {
+                updateCheckpoint();
+                checkpoint_time = nowMicros();
+            }
+        }
+        updateCheckpoint();
+        if (bundle)
+        {
+            drainBundle(true);
+        }
 
-            /**
-             * 模拟随机延迟
-             */
-            if (isDelay&& rand() %100 < probValue
-            )
+        double elapsed = std::max<int64_t>(1, nowMicros() - start_time) / 1e6;
+        LOG(INFO) << "Client recv syscalls: " << recv_batch.syscall_count()
+            << " datagrams: " << recv_batch.datagram_count()
+            << " duplicate segments: " << duplicate_segments_
+            << " corrupt segments: " << corrupt_segments_;
+        LOG(INFO) << "Client ACKs sent: " << acks_sent_
+            << " datagrams/s: " << recv_batch.datagram_count() / elapsed
+            << " ACKs/s: " << acks_sent_ / elapsed;
+        LOG(INFO) << "Client FEC parity received: " << fec_parity_received_
+            << " segments recovered: " << fec_decoder_->recovered_count();
+        if (compression != Compression::NONE)
+        {
+            LOG(INFO) << "Client compression: " << BlockCodec::Name(compression)
+                << " stream bytes: " << next_seq_expected_ - initSeqNum
+                << " raw bytes: " << raw_prefix_;
+        }
+        if (bundle)
+        {
+            LOG(INFO) << "Client bundle: " << bundle_files_written_ << " of "
+                << bundle_manifest_.entries.size() << " files written, stream bytes: "
+                << next_seq_expected_ - initSeqNum;
+            if (bundle_out_fd_ >= 0)
             {
-                int sleep_time = (rand() % 10) * 1000;
-                LOG(INFO) << "Delaying this packet with seq " << data_segment->seqNumber
-                    << " for " << sleep_time << "us";
-                usleep(sleep_time);
+                close(bundle_out_fd_);
+                bundle_out_fd_ = -1;
             }
+        }
 
-            /**
-             * 确定下一个期望的序列号
-             */
-            if (lastPacketInOrder == -1)
+        /**
+         * 关闭文件
+         */
+        if (stream_fd_ >= 0 && stream_fd_ != file_fd_)
+        {
+            close(stream_fd_);
+        }
+        stream_fd_ = -1;
+        if (file_fd_ >= 0)
+        {
+            close(file_fd_);
+            file_fd_ = -1;
+        }
+
+        /**
+         * 只有收到 FIN、之前的数据段全部按序到达且都写入了文件才算完成；
+         * 接收出错或写入失败时输出文件可能不完整
+         */
+        bool complete = isFinFlagReceived && lastPacketInOrder == lastPacketReceived &&
+            !write_failed_;
+        if (bundle)
+        {
+            complete = complete && bundle_parsed_ &&
+                bundle_files_written_ == (int)bundle_manifest_.entries.size();
+        }
+        if (!complete)
+        {
+            LOG(ERROR) << "Transfer of " << file_name << " is incomplete !!!";
+        }
+        return complete;
+    }
+
+    /**
+     * 发送文件大小查询并等待 "SIZE <n>" 回复，查询或回复丢失时重发
+     * @param file_name 文件名
+     * @return 文件大小，文件不存在或服务器无响应返回 -1
+     */
+    int UdpClient::QueryFileSize(const std::string& file_name)
+    {
+        FileRequest request;
+        request.fileName = file_name;
+        request.sizeQuery = true;
+        std::string request_data = request.Serialize();
+
+        char reply[MAX_PACKET_SIZE];
+        for (int attempt = 0; attempt < REQUEST_RETRIES; attempt++)
+        {
+            if (sendto(sockfd_, request_data.data(), request_data.size(), 0,
+                       (struct sockaddr*)&(server_address_),
+                       sizeof(struct sockaddr_in)) < 0)
             {
-                next_seq_expected = initSeqNum;
+                LOG(ERROR) << "Failed to write to socket !!!";
+                return -1;
             }
-            else
+            struct pollfd pfd = {sockfd_, POLLIN, 0};
+            if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0)
+            {
+                continue;
+            }
+            int n = recv(sockfd_, reply, sizeof(reply) - 1, 0);
+            if (n <= 0)
             {
-                next_seq_expected = data_segments_[lastPacketInOrder].seqNumber +
-                    data_segments_[lastPacketInOrder].dataLength;
+                continue;
+            }
+            reply[n] = '\0';
+            int size;
+            if (sscanf(reply, "SIZE %d", &size) == 1)
+            {
+                return size;
             }
+            LOG(ERROR) << "File not found !!!";
+            return -1;
+        }
+        LOG(ERROR) << "No reply to the size query !!!";
+        return -1;
+    }
 
-            /**
-             * 处理旧数据包，直接发送 ACK
-             */
-            if (next_seq_expected > data_segment->seqNumber &&
-                !data_segment->finflag)
+    /**
+     * 发送请求并等待对应的 SessionAccept，请求或回复丢失时重发请求。
+     * 令牌不符的数据报（例如同一端口上之前会话的迟到数据段）被忽略
+     * @param request_data 序列化的请求
+     * @param accept_timestamp 输出 SessionAccept 的时间戳，在确认中回显
+     * @return 握手成功返回 true，文件不存在或服务器无响应返回 false
+     */
+    bool UdpClient::handshake(const std::string& request_data,
+                              int64_t* accept_timestamp)
+    {
+        unsigned char reply[MAX_PACKET_SIZE];
+        for (int attempt = 0; attempt < REQUEST_RETRIES; attempt++)
+        {
+            if (sendto(sockfd_, request_data.data(), request_data.size(), 0,
+                       (struct sockaddr*)&(server_address_),
+                       sizeof(struct sockaddr_in)) < 0)
+            {
+                LOG(ERROR) << "Failed to write to socket !!!";
+                return false;
+            }
+            struct pollfd pfd = {sockfd_, POLLIN, 0};
+            if (poll(&pfd, 1, REQUEST_TIMEOUT_MS) <= 0)
             {
-                send_ack(next_seq_expected);
                 continue;
             }
+            int n = recv(sockfd_, reply, sizeof(reply), 0);
+            if (n == (int)strlen(kFileNotFound) &&
+                memcmp(reply, kFileNotFound, n) == 0)
+            {
+                LOG(ERROR) << "File not found !!!";
+                return false;
+            }
 
-            /**
-             * 计算当前数据段在缓冲区中的索引
-             */
-            segments_in_between =
-                (data_segment->seqNumber - next_seq_expected) / MAX_DATA_SIZE;
-            int this_segment_index = lastPacketInOrder + segments_in_between + 1;
-
-            /**
-             * 判断是否超出接收窗口，超出则丢弃
-             */
-            if (this_segment_index - lastPacketInOrder > receiverWindow)
+            DataSegment segment;
+            SessionAccept accept;
+            if (n <= 0 || !segment.DeserializeToDataSegment(reply, n) ||
+                !SessionAccept::Parse(segment, &accept) ||
+                accept.clientToken != client_token_)
             {
-                LOG(INFO) << "Packet dropped " << this_segment_index;
                 continue;
             }
+            if (accept.maxSegmentSize != MAX_DATA_SIZE)
+            {
+                LOG(ERROR) << "Unsupported segment size "
+                    << accept.maxSegmentSize << " !!!";
+                return false;
+            }
+            connection_id_ = accept.connectionId;
+            initSeqNum = accept.initialSeqNumber;
+            *accept_timestamp = segment.timestamp;
+            LOG(INFO) << "Session accepted, connection id: " << connection_id_
+                << " initial seq: " << initSeqNum << " window: " << accept.window
+                << " features: " << accept.features;
+            return true;
+        }
+        LOG(ERROR) << "No reply to the file request !!!";
+        return false;
+    }
+
+    /**
+     * 处理一个收到的数据报：模拟丢包/延迟、插入缓冲区、按序写入文件并发送 ACK
+     * @param buffer 数据报内容
+     * @param n 数据报长度
+     * @return 需要继续接收返回 true，传输结束或出错返回 false
+     */
+    bool UdpClient::handleSegment(unsigned char* buffer, int n)
+    {
+        /**
+         * 模拟传输中的比特错误：随机翻转数据报中的一个比特
+         */
+        if (isCorrupt && rand() % 100 < probValue)
+        {
+            buffer[rand() % n] ^= 1 << (rand() % 8);
+        }
+
+        /**
+         * 反序列化数据包，载荷仍指向接收缓冲区。
+         * 校验和错误的数据段当作丢失，由发送方的 SACK 快速重传或超时重传补上
+         */
+        DataSegment data_segment;
+        if (!data_segment.DeserializeToDataSegment(buffer, n))
+        {
+            corrupt_segments_++;
+            LOG(INFO) << "Dropping a corrupt segment";
+            return true;
+        }
+
+        /**
+         * 同一端口上之前会话的迟到数据段属于其他连接，直接丢弃
+         */
+        if (data_segment.connectionId != connection_id_)
+        {
+            return true;
+        }
+
+        LOG(INFO) << "packet received with seqNumber:"
+            << data_segment.seqNumber;
+
+        /**
+         * 模拟随机丢包
+         */
+        if (isPacketDrop&& rand() %100 < probValue
+        )
+        {
+            LOG(INFO) << "Dropping this packet with seq "
+                << data_segment.seqNumber;
+            return true;
+        }
+
+        /**
+         * 模拟随机延迟
+         */
+        if (isDelay&& rand() %100 < probValue
+        )
+        {
+            int sleep_time = (rand() % 10) * 1000;
+            LOG(INFO) << "Delaying this packet with seq " << data_segment.seqNumber
+                << " for " << sleep_time << "us";
+            usleep(sleep_time);
+        }
+
+        /**
+         * 重发的 SessionAccept 说明之前的确认丢失了，再确认一次
+         */
+        if (data_segment.synFlag)
+        {
+            send_ack(next_seq_expected_, data_segment.timestamp);
+            return true;
+        }
+
+        /**
+         * FEC 校验段不占用序列号空间，单独处理
+         */
+        if (!data_segment.ackFlag && FecInfo::IsParity(data_segment.ackNum))
+        {
+            return handleParity(data_segment);
+        }
+
+        /**
+         * 处理旧数据包，立即发送 ACK：说明之前的 ACK 可能丢失了
+         */
+        if (next_seq_expected_ > data_segment.seqNumber &&
+            !data_segment.finflag)
+        {
+            duplicate_segments_++;
+            onSegmentReceived(data_segment.timestamp, true);
+            return true;
+        }
+
+        /**
+         * 数据段下标由序列号直接算出
+         */
+        int this_segment_index =
+            (data_segment.seqNumber - initSeqNum) / MAX_DATA_SIZE;
+
+        /**
+         * 判断是否超出接收窗口，超出则丢弃
+         */
+        if (!reorder_buffer_->InWindow(this_segment_index))
+        {
+            LOG(INFO) << "Packet dropped " << this_segment_index;
+            return true;
+        }
+
+        /**
+         * 检查是否收到结束标志 FIN
+         */
+        if (data_segment.finflag)
+        {
+            LOG(INFO) << "Fin flag received !!!";
+            isFinFlagReceived = true;
+        }
+
+        /**
+         * 只有恰好是下一个期望的数据段、且之前没有乱序数据时才可以延迟确认；
+         * 其余情况（乱序、重复、填补空洞）都要立即确认
+         */
+        bool in_order = this_segment_index == lastPacketInOrder + 1 &&
+            lastPacketReceived == lastPacketInOrder;
+        bool immediate = !in_order || data_segment.finflag;
+
+        /**
+         * 首次到达的数据段立即按字节偏移写入文件，无论是否按序；
+         * 它可能使所在分组凑够了恢复其余丢失数据段所需的校验段
+         */
+        if (storeSegment(this_segment_index, data_segment.data_,
+                         data_segment.dataLength))
+        {
+            if (CompressedSegmentInfo::IsCompressed(data_segment.ackNum))
+            {
+                onCompressedSegment(this_segment_index, data_segment.ackNum);
+            }
+            if (recoverBlock(this_segment_index) > 0)
+            {
+                immediate = true;
+            }
+        }
+        else
+        {
+            duplicate_segments_++;
+            immediate = true;
+        }
+
+        return advanceAndAck(data_segment.timestamp, immediate);
+    }
+
+    /**
+     * 处理一个 FEC 校验段：保存到所在分组，凑够后恢复丢失的数据段。
+     * 校验段本身不需要确认，只有恢复出数据段时才立即发送 ACK
+     * @param parity_segment 校验段
+     * @return 需要继续接收返回 true，传输结束返回 false
+     */
+    bool UdpClient::handleParity(const DataSegment& parity_segment)
+    {
+        FecInfo info = FecInfo::Unpack(parity_segment.ackNum);
+        int first_index = (parity_segment.seqNumber - initSeqNum) / MAX_DATA_SIZE;
+        fec_parity_received_++;
+
+        /**
+         * 分组已经全部按序收到，或者超出接收窗口（恢复出的数据段无处存放）时忽略
+         */
+        if (first_index + info.count <= lastPacketInOrder + 1 ||
+            !reorder_buffer_->InWindow(first_index + info.count - 1))
+        {
+            return true;
+        }
+
+        fec_decoder_->AddParity(first_index, info, parity_segment.data_,
+                                parity_segment.dataLength);
+        if (recoverBlock(first_index) == 0)
+        {
+            return true;
+        }
+        return advanceAndAck(parity_segment.timestamp, true);
+    }
 
-            /**
-             * 检查是否收到结束标志 FIN
-             */
-            if (data_segment->finflag)
+    /**
+     * 记录一个首次到达（或由 FEC 恢复）的数据段，并按字节偏移写入文件
+     * @param index 数据段下标
+     * @param data 载荷
+     * @param length 载荷长度
+     * @return 首次到达返回 true，重复到达返回 false
+     */
+    bool UdpClient::storeSegment(int index, const char* data, int length)
+    {
+        if (!reorder_buffer_->Insert(index, length))
+        {
+            return false;
+        }
+        if (stream_fd_ >= 0 && length > 0 &&
+            pwrite(stream_fd_, data, length, streamOffset(index)) < 0)
+        {
+            LOG(ERROR) << "Failed to write segment " << index;
+            write_failed_ = true;
+        }
+        if (index > lastPacketReceived)
+        {
+            lastPacketReceived = index;
+        }
+        return true;
+    }
+
+    /**
+     * 如果第 index 个数据段所在分组收到的校验段不少于缺失的数据段，
+     * 则用已写入文件的数据段和校验段恢复缺失的数据段
+     * @param index 分组内任一数据段的下标
+     * @return 恢复出的数据段数量
+     */
+    int UdpClient::recoverBlock(int index)
+    {
+        int first_index = fec_decoder_->FindBlock(index);
+        if (first_index < 0)
+        {
+            return 0;
+        }
+        const FecInfo& info = fec_decoder_->info(first_index);
+        std::vector<bool> present(info.count);
+        int missing = 0;
+        for (int i = 0; i < info.count; i++)
+        {
+            present[i] = reorder_buffer_->Contains(first_index + i);
+            missing += present[i] ? 0 : 1;
+        }
+        if (missing == 0 || missing > fec_decoder_->parity_count(first_index))
+        {
+            return 0;
+        }
+
+        auto read = [this, first_index](int i, char* buffer, int length)
+        {
+            return pread(stream_fd_, buffer, length,
+                         streamOffset(first_index + i)) == length;
+        };
+        std::vector<const char*> recovered;
+        if (!fec_decoder_->Recover(first_index, present, read, &recovered))
+        {
+            return 0;
+        }
+        for (int i = 0; i < info.count; i++)
+        {
+            if (present[i])
+            {
+                continue;
+            }
+            bool last = i == info.count - 1;
+            storeSegment(first_index + i, recovered[i],
+                         last ? info.last_length : MAX_DATA_SIZE);
+            if (last && info.fin)
             {
-                LOG(INFO) << "Fin flag received !!!";
                 isFinFlagReceived = true;
             }
+            LOG(INFO) << "FEC recovered segment " << first_index + i;
+        }
+        return missing;
+    }
 
-            /**
-             * 将数据插入缓冲区
-             */
-            insert(this_segment_index, *data_segment);
+    /**
+     * 记录压缩流中首次到达的数据段，所在分组的数据段全部到达后立即解压，
+     * 不等待之前的分组，丢包或乱序只影响所在的分组
+     * @param index 数据段下标
+     * @param ack_num 数据段头部携带的分组信息
+     */
+    void UdpClient::onCompressedSegment(int index, int ack_num)
+    {
+        CompressedSegmentInfo info = CompressedSegmentInfo::Unpack(ack_num);
+        int first_index = index - info.position;
+        if (info.count == 0 || first_index < next_block_first_ ||
+            decoded_blocks_.count(first_index) > 0)
+        {
+            return;
+        }
+        auto it = block_missing_.emplace(first_index, info.count).first;
+        if (--it->second > 0)
+        {
+            return;
+        }
+        block_missing_.erase(it);
+        decodeBlock(first_index, info.count);
+    }
+
+    /**
+     * 解压一个收齐的分组并按原始偏移写入输出文件，
+     * 然后推进按序解压的前缀（检查点据此记录原始字节范围）
+     * @param first_index 分组第一个数据段的下标
+     * @param count 分组的数据段数
+     */
+    void UdpClient::decodeBlock(int first_index, int count)
+    {
+        block_buffer_.resize((size_t)count * MAX_DATA_SIZE);
+        int n = pread(stream_fd_, block_buffer_.data(), block_buffer_.size(),
+                      streamOffset(first_index));
+        CompressedBlockHeader header;
+        if (n < 0 || !CompressedBlockHeader::Parse(block_buffer_.data(), n, &header))
+        {
+            LOG(ERROR) << "Malformed compressed block " << first_index;
+            write_failed_ = true;
+            return;
+        }
+
+        const char* payload = block_buffer_.data() + COMPRESSED_BLOCK_HEADER_LENGTH;
+        const char* raw = payload;
+        if (header.method != Compression::NONE)
+        {
+            raw_buffer_.resize(header.rawLength);
+            if (!BlockCodec::Decompress(header.method, payload,
+                                        header.compressedLength,
+                                        raw_buffer_.data(), header.rawLength))
+            {
+                LOG(ERROR) << "Failed to decompress block " << first_index;
+                write_failed_ = true;
+                return;
+            }
+            raw = raw_buffer_.data();
+        }
+        else if (header.compressedLength != header.rawLength)
+        {
+            LOG(ERROR) << "Malformed stored block " << first_index;
+            write_failed_ = true;
+            return;
+        }
+        if (file_fd_ >= 0 && header.rawLength > 0 &&
+            pwrite(file_fd_, raw, header.rawLength,
+                   rangeOffset + header.rawOffset) < 0)
+        {
+            LOG(ERROR) << "Failed to write block " << first_index;
+            write_failed_ = true;
+        }
+
+        decoded_blocks_[first_index] =
+            std::make_pair(count, (int)(header.rawOffset + header.rawLength));
+        auto it = decoded_blocks_.find(next_block_first_);
+        while (it != decoded_blocks_.end())
+        {
+            next_block_first_ += it->second.first;
+            raw_prefix_ = it->second.second;
+            decoded_blocks_.erase(it);
+            it = decoded_blocks_.find(next_block_first_);
+        }
+    }
+
+    /**
+     * 多文件传输：字节流开头的清单按序到达后解析，
+     * 之后每积累 BUNDLE_DRAIN_BYTES 字节，把暂存文件中按序的部分拷贝到各文件
+     * @param final 是否是最后一次，为 true 时写出所有按序到达的字节
+     */
+    void UdpClient::drainBundle(bool final)
+    {
+        int prefix = next_seq_expected_ - initSeqNum;
+        if (!bundle_parsed_)
+        {
+            char header[BUNDLE_MANIFEST_HEADER_LENGTH];
+            if (prefix < BUNDLE_MANIFEST_HEADER_LENGTH ||
+                pread(stream_fd_, header, sizeof(header), 0) != sizeof(header))
+            {
+                return;
+            }
+            int length = BundleManifest::Length(header);
+            if (length >= BUNDLE_MANIFEST_HEADER_LENGTH && prefix < length)
+            {
+                return;
+            }
+            std::vector<char> data(std::max(length, 0));
+            if (length < BUNDLE_MANIFEST_HEADER_LENGTH ||
+                pread(stream_fd_, data.data(), length, 0) != length ||
+                !BundleManifest::Parse(data.data(), length, &bundle_manifest_))
+            {
+                LOG(ERROR) << "Malformed bundle manifest !!!";
+                bundle_manifest_.entries.clear();
+                write_failed_ = true;
+            }
+            bundle_parsed_ = true;
+            bundle_drained_ = std::max(length, 0);
+            LOG(INFO) << "Bundle manifest: " << bundle_manifest_.entries.size()
+                << " files";
+        }
+        if (!final && prefix - bundle_drained_ < BUNDLE_DRAIN_BYTES)
+        {
+            return;
+        }
 
-            /**
-             * 写入文件并更新已接收的最后一个有序包索引
-             */
-            for (int i = lastPacketInOrder + 1; i <= lastPacketReceived; i++)
+        raw_buffer_.resize(BUNDLE_DRAIN_BYTES);
+        while (bundle_entry_ < bundle_manifest_.entries.size())
+        {
+            const BundleEntry& entry = bundle_manifest_.entries[bundle_entry_];
+            if (prefix < entry.offset)
+            {
+                break;
+            }
+            if (bundle_out_fd_ < 0)
             {
-                if (data_segments_[i].seqNumber != -1)
+                std::string file_path = std::string(CLIENT_FILE_PATH) + entry.name;
+                /** 清单中的文件名来自服务器，只写入客户端目录之内 */
+                if (BundleManifest::IsSafeName(entry.name))
                 {
-                    if (file.is_open())
-                    {
-                        file << data_segments_[i].data_;
-                        lastPacketInOrder = i;
-                    }
+                    bundle_out_fd_ = open(file_path.c_str(),
+                                          O_WRONLY | O_CREAT | O_TRUNC, 0644);
                 }
-                else
+                if (bundle_out_fd_ < 0)
                 {
-                    break;
+                    LOG(ERROR) << "Failed to open " << file_path << " !!!";
+                    write_failed_ = true;
+                    bundle_entry_++;
+                    continue;
                 }
             }
 
-            /**
-             * 如果所有数据包已接收且收到 FIN，结束接收
-             */
-            if (isFinFlagReceived&& lastPacketInOrder
-            ==
-            lastPacketReceived
-            )
+            int end = std::min(prefix, entry.offset + entry.size);
+            int from = std::max(bundle_drained_, entry.offset);
+            while (from < end)
+            {
+                int chunk = std::min(end - from, BUNDLE_DRAIN_BYTES);
+                if (pread(stream_fd_, raw_buffer_.data(), chunk, from) != chunk ||
+                    pwrite(bundle_out_fd_, raw_buffer_.data(), chunk,
+                           from - entry.offset) != chunk)
+                {
+                    LOG(ERROR) << "Failed to write " << entry.name << " !!!";
+                    write_failed_ = true;
+                    break;
+                }
+                from += chunk;
+            }
+            bundle_drained_ = std::max(bundle_drained_, end);
+            if (end < entry.offset + entry.size)
             {
                 break;
             }
+            close(bundle_out_fd_);
+            bundle_out_fd_ = -1;
+            bundle_entry_++;
+            bundle_files_written_++;
+        }
+    }
 
-            /**
-             * 发送 ACK 确认当前最后一个有序包
-             */
-            send_ack(data_segments_[lastPacketInOrder].seqNumber +
-                data_segments_[lastPacketInOrder].dataLength);
+    off_t UdpClient::streamOffset(int index) const
+    {
+        /** 未压缩时数据段直接写入输出文件中请求范围的位置 */
+        off_t base = stream_fd_ == file_fd_ ? rangeOffset : 0;
+        return base + (off_t)index * MAX_DATA_SIZE;
+    }
 
-            /**
-             * 清空缓冲区准备下一次接收
-             */
-            memset(buffer, 0, MAX_PACKET_SIZE);
+    /**
+     * 把已经到达的数据段按序移出接收窗口，按 ACK 策略确认，并判断传输是否结束
+     * @param timestamp 触发本次处理的数据段的时间戳
+     * @param immediate 是否必须立即确认
+     * @return 需要继续接收返回 true，传输结束返回 false
+     */
+    bool UdpClient::advanceAndAck(int64_t timestamp, bool immediate)
+    {
+        /**
+         * 更新已接收的最后一个有序包索引
+         */
+        int length;
+        while (reorder_buffer_->PopInOrder(&length))
+        {
+            lastPacketInOrder++;
+            next_seq_expected_ =
+                initSeqNum + lastPacketInOrder * MAX_DATA_SIZE + length;
         }
+        fec_decoder_->Release(lastPacketInOrder + 1);
+        if (bundle)
+        {
+            drainBundle(false);
+        }
+
+        /**
+         * 按 ACK 策略确认当前最后一个有序包
+         */
+        onSegmentReceived(timestamp, immediate);
 
         /**
-         * 释放缓冲区并关闭文件
+         * 如果所有数据包已接收且收到 FIN，结束接收。
+         * 最后一个 ACK 必须发出，服务器据此关闭会话。
          */
-        free(buffer);
-        file.close();
+        if (isFinFlagReceived&& lastPacketInOrder
+        ==
+        lastPacketReceived
+        )
+        {
+            if (ack_policy_->pending())
+            {
+                flushAck();
+            }
+            return false;
+        }
+        return true;
+
     }
 
     /**
-     * 将数据段添加到数据段向量中
-     * @param data_segment 待添加的数据段
-     * @return 插入后向量中该元素的索引位置
+     * 记录一个收到的数据段，ACK 策略要求时立即发送累积的 ACK
+     * @param timestamp 数据段携带的发送时间戳
+     * @param immediate 是否必须立即确认
      */
-    int UdpClient::add_to_data_segment_vector(const DataSegment& data_segment)
+    void UdpClient::onSegmentReceived(int64_t timestamp, bool immediate)
     {
-        data_segments_.push_back(data_segment); /**< 将数据段压入向量 */
-        return data_segments_.size() - 1; /**< 返回插入位置的索引 */
+        if (ack_policy_->OnSegment(timestamp, immediate, nowMicros()))
+        {
+            flushAck();
+        }
+    }
+
+    /**
+     * 发送一个确认到目前为止所有按序数据的 ACK
+     */
+    void UdpClient::flushAck()
+    {
+        send_ack(next_seq_expected_, ack_policy_->echo_timestamp());
+        ack_policy_->OnAckSent();
+    }
+
+    /**
+     * 把 [rangeOffset, rangeOffset + 按序字节数) 报告给检查点，
+     * 乱序到达的数据段最多一个接收窗口，中断后重新请求即可。
+     * 压缩时报告按序解压写入的原始字节数
+     */
+    void UdpClient::updateCheckpoint()
+    {
+        int bytes = compression != Compression::NONE
+            ? raw_prefix_
+            : next_seq_expected_ - initSeqNum;
+        if (checkpoint == nullptr || file_fd_ < 0 || bytes <= checkpoint_bytes_)
+        {
+            return;
+        }
+        checkpoint->Update(file_fd_, rangeOffset + checkpoint_bytes_,
+                           rangeOffset + bytes);
+        checkpoint_bytes_ = bytes;
     }
 
     /**
      * 发送 ACK 确认包给服务器
      * @param ackNumber 要确认的序列号
+     * @param echoTimestamp 触发该 ACK 的数据段的时间戳，服务器据此计算 RTT
      */
-    void UdpClient::send_ack(int ackNumber)
+    void UdpClient::send_ack(int ackNumber, int64_t echoTimestamp)
     {
         LOG(INFO) << "Sending an ack :" << ackNumber;
         int n = 0;
 
         /**
-         * 创建一个新的 ACK 数据段
+         * 由乱序重组位图生成 SACK 块，告诉服务器累计确认之后还收到了哪些数据段
          */
-        DataSegment* ack_segment = new DataSegment();
-        ack_segment->ackFlag = true; /**< 设置 ACK 标志 */
-        ack_segment->ackNum = ackNumber; /**< 设置确认号 */
-        ack_segment->finflag = false; /**< 不是 FIN 包 */
-        ack_segment->dataLength = 0; /**< 数据长度为 0 */
-        ack_segment->seqNumber = 0; /**< 序列号为 0（ACK 包不需要） */
+        char sack_payload[MAX_SACK_BLOCKS * SACK_BLOCK_LENGTH];
+        SegmentRange ranges[MAX_SACK_BLOCKS];
+        int sack_count = 0;
+        if (reorder_buffer_ != nullptr)
+        {
+            sack_count = reorder_buffer_->ReceivedRanges(lastPacketReceived,
+                                                         ranges, MAX_SACK_BLOCKS);
+        }
+        for (int i = 0; i < sack_count; i++)
+        {
+            SackBlock block;
+            block.start = initSeqNum + ranges[i].first * MAX_DATA_SIZE;
+            block.end = initSeqNum + ranges[i].last * MAX_DATA_SIZE +
+                reorder_buffer_->length(ranges[i].last);
+            block.SerializeTo(sack_payload + i * SACK_BLOCK_LENGTH);
+        }
 
         /**
-         * 序列化数据段为字节数组
+         * 在栈上创建 ACK 数据段，SACK 块作为载荷
          */
-        char* data = ack_segment->SerializeToCharArray();
+        DataSegment ack_segment;
+        ack_segment.connectionId = connection_id_; /**< 服务器按连接 ID 查找会话 */
+        ack_segment.ackFlag = true; /**< 设置 ACK 标志 */
+        ack_segment.ackNum = ackNumber; /**< 设置确认号 */
+        ack_segment.finflag = false; /**< 不是 FIN 包 */
+        ack_segment.dataLength = sack_count * SACK_BLOCK_LENGTH; /**< SACK 块长度 */
+        ack_segment.seqNumber = 0; /**< 序列号为 0（ACK 包不需要） */
+        ack_segment.timestamp = echoTimestamp; /**< 回显数据段的时间戳 */
+        ack_segment.data_ = sack_payload;
+
+        /**
+         * ACK 只包含头部和 SACK 块，不再填充到 MAX_PACKET_SIZE
+         */
+        char data[MAX_PACKET_SIZE];
+        int length = ack_segment.SerializeTo(data);
 
         /**
          * 发送 ACK 到服务器
          */
-        n = sendto(sockfd_, data, MAX_PACKET_SIZE, 0,
+        n = sendto(sockfd_, data, length, 0,
                    (struct sockaddr*)&(server_address_), sizeof(struct sockaddr_in));
         if (n < 0)
         {
             LOG(INFO) << "Sending ack failed !!!";
         }
-
-        free(data); /**< 释放序列化后的数据内存 */
+        acks_sent_++;
     }
 
     /**
@@ -306,36 +1055,4 @@ namespace safe_udp
         sockfd_ = sfd; /**< 保存创建的套接字描述符 */
         this->server_address_ = server_address_; /**< 保存服务器地址信息 */
     }
-
-    /**
-     * 将数据段插入到缓冲区的指定索引位置
-     * @param index 插入的目标索引
-     * @param data_segment 要插入的数据段
-     */
-    void UdpClient::insert(int index, const DataSegment& data_segment)
-    {
-        if (index > lastPacketReceived)
-        {
-            /**
-             * 如果索引大于最后一个接收包索引，则逐个填充空段并添加新段
-             */
-            for (int i = lastPacketReceived + 1; i <= index; i++)
-            {
-                if (i == index)
-                {
-                    data_segments_.push_back(data_segment); /**< 添加目标数据段 */
-                }
-                else
-                {
-                    DataSegment data_segment; /**< 创建默认数据段填充空位 */
-                    data_segments_.push_back(data_segment);
-                }
-            }
-            lastPacketReceived = index; /**< 更新最后收到的数据包索引 */
-        }
-        else
-        {
-            data_segments_[index] = data_segment; /**< 替换已有索引位置的数据段 */
-        }
-    }
-}
\ No newline at end of file
+}
@@ -5,11 +5,18 @@
 #include <sys/types.h>  /** 鏁版嵁绫诲瀷瀹氫箟 */
 #include <unistd.h>     /** 鎻愪緵 POSIX 鎿嶄綔绯荤粺 API 鐨勮闂紝濡?close() */
 
+#include <map>
 #include <memory> /** 鎻愪緵鏅鸿兘鎸囬拡绛夊姛鑳?*/
 #include <string> /** C++ 鏍囧噯搴撳瓧绗︿覆绫?*/
 #include <vector> /** C++ 鏍囧噯搴撳姩鎬佹暟缁勫鍣?*/
 
+#include "ack_policy.h"   /** 延迟确认策略 */
+#include "bundle_manifest.h" /** 多文件传输的清单 */
+#include "compressed_stream.h" /** 压缩流的分组格式 */
 #include "data_segment.h" /** 鑷畾涔夋暟鎹绫伙紝鐢ㄤ簬 UDP 浼犺緭 */
+#include "fec_decoder.h"    /** FEC 校验段保存与恢复 */
+#include "reorder_buffer.h" /** 接收窗口内的乱序重组位图 */
+#include "transfer_checkpoint.h" /** 断点续传检查点 */
 
 namespace safe_udp {
 /** 客户端默认文件存储路径 */
@@ -37,11 +44,21 @@ class UdpClient {
   ~UdpClient() { close(sockfd_); }
 
   /**
-   * 向服务器发送文件请求
+   * 向服务器发送文件请求并接收文件
    *
    * @param file_name 请求的文件名
+   * @return 收到 FIN 且所有数据都已写入文件返回 true；握手失败、接收中断
+   *         或写入失败返回 false
    */
-  void SendFileRequest(const std::string& file_name);
+  bool SendFileRequest(const std::string& file_name);
+
+  /**
+   * 查询服务器上文件的大小，超时后重发查询
+   *
+   * @param file_name 文件名
+   * @return 文件大小（字节），文件不存在或服务器无响应返回 -1
+   */
+  int QueryFileSize(const std::string& file_name);
 
   /**
    * 创建 socket 并连接到指定的服务器地址和端口
@@ -52,45 +69,160 @@ class UdpClient {
   void CreateSocketAndServerConnection(const std::string& server_address,
                                        const std::string& port);
 
-  int initSeqNum;    /** 初始序列号 */
+  int initSeqNum;    /** 初始序列号，由服务器在 SessionAccept 中给出 */
   bool isPacketDrop; /** 是否启用丢包模拟 */
   bool isDelay;      /** 是否启用延迟模拟 */
+  bool isCorrupt;    /** 是否启用比特错误模拟 */
   int probValue;     /** 丢包或延迟的概率值 */
 
   int lastPacketInOrder;  /** 最后一个按序到达的数据包编号 */
   int lastPacketReceived; /** 最后收到的数据包编号 */
   int receiverWindow;     /** 接收窗口大小 */
   bool isFinFlagReceived; /** 是否已收到 FIN 标志 */
+  int batchSize;          /** 单次 recvmmsg 最多接收的数据报数量 */
+  bool isGro;             /** 是否开启 UDP GRO 接收 */
+  int ackEvery;           /** 每收到多少个按序数据段发送一个 ACK */
+  int64_t ackDelayUs;     /** ACK 最长延迟（微秒） */
+  int rangeOffset;        /** 请求的字节范围起点，也是写入本地文件的偏移 */
+  int rangeLength;        /** 请求的字节范围长度，-1 表示整个文件 */
+  TransferCheckpoint *checkpoint; /** 断点续传检查点，nullptr 表示不记录 */
+  Compression compression; /** 请求服务器使用的压缩方法 */
+  bool bundle;             /** 多文件请求：文件名是以逗号分隔的文件名或 glob 模式 */
 
  private:
   /**
-   * 发送 ACK 确认信息给服务器
+   * 握手：发送请求并等待对应的 SessionAccept，丢失时重发请求
    *
-   * @param ackNumber 要确认的序列号
+   * @param request_data 序列化的请求
+   * @param accept_timestamp 输出 SessionAccept 的时间戳
+   * @return 握手成功返回 true
    */
-  void send_ack(int ackNumber);
+  bool handshake(const std::string& request_data, int64_t* accept_timestamp);
 
   /**
-   * 将数据包插入到数据段向量中
+   * 处理一个收到的数据报
    *
-   * @param index 插入位置索引
-   * @param data_segment 待插入的数据段
+   * @param buffer 数据报内容
+   * @param n 数据报长度
+   * @return 需要继续接收返回 true，传输结束或出错返回 false
    */
-  void insert(int index, const DataSegment& data_segment);
+  bool handleSegment(unsigned char *buffer, int n);
 
   /**
-   * 将数据段添加到数据段向量中
+   * 把收到的数据段交给 ACK 策略，需要时立即发送 ACK
    *
-   * @param data_segment 待添加的数据段
-   * @return 返回插入的位置索引
+   * @param timestamp 数据段携带的发送时间戳
+   * @param immediate 是否必须立即确认（乱序、重复、填补空洞或 FIN）
+   */
+  void onSegmentReceived(int64_t timestamp, bool immediate);
+
+  /**
+   * 处理一个 FEC 校验段
+   *
+   * @param parity_segment 校验段
+   * @return 需要继续接收返回 true，传输结束返回 false
+   */
+  bool handleParity(const DataSegment &parity_segment);
+
+  /**
+   * 记录首次到达（或恢复出）的数据段并写入文件
+   *
+   * @return 首次到达返回 true
+   */
+  bool storeSegment(int index, const char *data, int length);
+
+  /**
+   * 用校验段恢复第 index 个数据段所在分组中丢失的数据段
+   *
+   * @return 恢复出的数据段数量
+   */
+  int recoverBlock(int index);
+
+  /**
+   * 压缩流中首次到达的数据段：分组的数据段全部到达后解压该分组
+   *
+   * @param index 数据段下标
+   * @param ack_num 数据段头部携带的分组信息
+   */
+  void onCompressedSegment(int index, int ack_num);
+
+  /**
+   * 从暂存文件读出一个收齐的压缩分组，解压后按原始偏移写入文件
+   *
+   * @param first_index 分组第一个数据段的下标
+   * @param count 分组的数据段数
+   */
+  void decodeBlock(int first_index, int count);
+
+  /**
+   * 多文件传输：清单到达后解析，之后把按序到达的字节写入各自的文件
+   *
+   * @param final 是否是最后一次，为 false 时积累到一定字节数才写出
+   */
+  void drainBundle(bool final);
+
+  /**
+   * 第 index 个数据段在接收字节流（输出文件或压缩流暂存文件）中的偏移
+   */
+  off_t streamOffset(int index) const;
+
+  /**
+   * 按序移出已到达的数据段，按 ACK 策略确认，并判断传输是否结束
+   *
+   * @param timestamp 触发本次处理的数据段的时间戳
+   * @param immediate 是否必须立即确认
+   * @return 需要继续接收返回 true，传输结束返回 false
+   */
+  bool advanceAndAck(int64_t timestamp, bool immediate);
+
+  /**
+   * 发送累积的 ACK 并清空 ACK 策略的待确认状态
+   */
+  void flushAck();
+
+  /**
+   * 把按序写入的前缀报告给检查点
+   */
+  void updateCheckpoint();
+
+  /**
+   * 发送 ACK 确认信息给服务器
+   *
+   * @param ackNumber 要确认的序列号
+   * @param echoTimestamp 回显触发该 ACK 的数据段的时间戳
    */
-  int add_to_data_segment_vector(const DataSegment& data_segment);
+  void send_ack(int ackNumber, int64_t echoTimestamp);
 
   int sockfd_;                             /** socket 文件描述符 */
   int seq_number_;                         /** 当前使用的序列号 */
   int ack_number_;                         /** 当前使用的确认号 */
   int16_t length_;                         /** 数据长度 */
   struct sockaddr_in server_address_;      /** 服务器地址结构体 */
-  std::vector<DataSegment> data_segments_; /** 存储接收的数据段 */
+  uint32_t connection_id_;                 /** 服务器分配的连接 ID */
+  uint32_t client_token_;                  /** 本次请求的客户端令牌 */
+  int file_fd_;                            /** 输出文件描述符 */
+  int next_seq_expected_;                  /** 下一个期望按序到达的序列号 */
+  int duplicate_segments_;                 /** 重复到达（已收到过）的数据段数量 */
+  std::unique_ptr<ReorderBuffer> reorder_buffer_; /** 接收窗口乱序重组 */
+  std::unique_ptr<AckPolicy> ack_policy_;  /** 何时发送 ACK */
+  long acks_sent_;                         /** 已发送的 ACK 数量 */
+  std::unique_ptr<FecDecoder> fec_decoder_;  /** FEC 校验段与恢复 */
+  long fec_parity_received_;               /** 收到的 FEC 校验段数量 */
+  int checkpoint_bytes_;                   /** 已报告给检查点的按序字节数 */
+  long corrupt_segments_;                  /** 校验和错误而丢弃的数据段数量 */
+  int stream_fd_;                          /** 数据段写入的文件，压缩时为匿名暂存文件 */
+  std::map<int, int> block_missing_;       /** 未收齐的压缩分组：第一个数据段下标 -> 缺少的数据段数 */
+  std::map<int, std::pair<int, int>> decoded_blocks_; /** 已解压但不连续的分组：下标 -> (数据段数, 原始数据末尾) */
+  int next_block_first_;                   /** 按序解压前缀之后的第一个分组下标 */
+  int raw_prefix_;                         /** 按序解压写入文件的原始字节数 */
+  std::vector<char> block_buffer_;         /** 压缩分组的读取缓冲区 */
+  std::vector<char> raw_buffer_;           /** 解压缓冲区，多文件传输时用作拷贝缓冲区 */
+  BundleManifest bundle_manifest_;         /** 多文件传输的清单 */
+  bool bundle_parsed_;                     /** 清单是否已经解析 */
+  size_t bundle_entry_;                    /** 正在写出的文件在清单中的下标 */
+  int bundle_out_fd_;                      /** 正在写出的文件，-1 表示尚未打开 */
+  int bundle_drained_;                     /** 已经写出到各文件的字节流前缀长度 */
+  int bundle_files_written_;               /** 已经写完的文件数 */
+  bool write_failed_;                      /** 是否有数据没能写入文件 */
 };
 }  // namespace safe_udp
\ No newline at end of file
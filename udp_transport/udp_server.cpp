@@ -1,40 +1,49 @@
 #include "udp_server.h"
 #include <arpa/inet.h>
+#include <errno.h>
+#include <linux/filter.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
-#include <sys/time.h>
 #include <sys/types.h>
-#include <time.h>
 #include <algorithm>
-#include <cmath>
-#include <sstream>
-#include <vector>
 #include <glog/logging.h>
 
+#include "file_request.h"
+
 namespace safe_udp
 {
-    UdpServer::UdpServer()
-    {
-        sliding_window_ = std::make_unique<SlidingWindow>();
-        packet_statistics_ = std::make_unique<PacketStatistics>(); /** 创建数据包统计模块，用于记录发送和重传情况 */
+    /** epoll_wait 单次返回的最大事件数 */
+    constexpr int MAX_EPOLL_EVENTS = 256;
+    /**
+     * 初始序列号在 [0, INITIAL_SEQ_NUMBER_RANGE) 中随机选择。
+     * 旧连接的数据段已经由连接 ID 区分，范围取小一些，
+     * 使序列号加上文件长度仍然在 int 的范围内
+     */
+    constexpr uint32_t INITIAL_SEQ_NUMBER_RANGE = 1 << 20;
 
+    UdpServer::UdpServer() : random_(std::random_device{}())
+    {
         sockfd_ = 0; /** 初始化 socket 文件描述符为 0 */
-        smoothed_rtt_ = 20000; /** 平滑往返时间（Smoothed RTT）初始值设为 20000 微秒 */
-        smoothed_timeout_ = 30000; /** 初始超时时间设置为 30000 微秒 */
-        dev_rtt_ = 0; /** RTT 偏差初始化为 0 */
-
-        initial_seq_number_ = 67; /** 设置初始序列号为 67 */
-        start_byte_ = 0; /** 当前传输起始字节位置初始化为 0 */
-
-        ssthresh_ = 128; /** 慢启动阈值初始化为 128 */
-        cwnd_ = 1; /** 拥塞窗口初始大小为 1 */
+        epoll_fd_ = -1; /** epoll 描述符在 StartServer 中创建 */
+    }
 
-        is_slow_start_ = true; /** 标记当前处于慢启动阶段 */
-        is_cong_avd_ = false; /** 标记当前不在拥塞避免阶段 */
-        is_fast_recovery_ = false; /** 标记当前不在快速恢复阶段 */
+    UdpServer::~UdpServer()
+    {
+        handshakes_.clear();
+        sessions_.clear();
+        timer_sessions_.clear();
+        if (epoll_fd_ >= 0)
+        {
+            close(epoll_fd_);
+        }
+        close(sockfd_);
     }
 
-    int UdpServer::StartServer(int port)
+    int UdpServer::StartServer(int port, bool reuse_port)
     {
         int sfd; /** 定义 socket 文件描述符 */
         struct sockaddr_in server_addr; /** 定义服务器地址结构体 */
@@ -42,7 +51,7 @@ namespace safe_udp
         LOG(INFO) << "Starting the webserver... port: " << port;
 
         /** 创建 UDP socket，AF_INET 表示 IPv4，SOCK_DGRAM 表示无连接的数据报套接字 */
-        sfd = socket(AF_INET, SOCK_DGRAM, 0);
+        sfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 
         /** 检查 socket 是否创建成功 */
         if (sfd < 0)
@@ -51,6 +60,15 @@ namespace safe_udp
             exit(0); /** 创建失败，退出程序 */
         }
 
+        /** 多个工作线程共享同一端口时，必须在绑定前设置 SO_REUSEPORT */
+        int enable = 1;
+        if (reuse_port &&
+            setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+        {
+            LOG(ERROR) << "Failed to set SO_REUSEPORT !!!";
+            exit(0);
+        }
+
         /** 清空 server_addr 结构体，确保初始化为 0 */
         memset(&server_addr, 0, sizeof(server_addr));
 
@@ -79,6 +97,30 @@ namespace safe_udp
         /** 日志输出地址族信息 */
         LOG(INFO) << "**Server Bind set to family: " << server_addr.sin_family;
 
+        /** 创建 epoll 实例，并注册服务器 socket 的可读事件 */
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0)
+        {
+            LOG(ERROR) << "Failed to create epoll !!!";
+            exit(0);
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = sfd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sfd, &event) < 0)
+        {
+            LOG(ERROR) << "Failed to add socket to epoll !!!";
+            exit(0);
+        }
+
+        /** 如果请求了 GSO，先确认内核支持 UDP_SEGMENT，否则退回普通批量发送 */
+        if (session_config_.gso && !SendBatch::ProbeGso(sfd))
+        {
+            LOG(WARNING) << "UDP_SEGMENT not supported, GSO disabled";
+            session_config_.gso = false;
+        }
+
         /** 日志输出服务器启动成功信息 */
         LOG(INFO) << "Started successfully";
 
@@ -88,620 +130,344 @@ namespace safe_udp
     }
 
     /**
-     * 打开指定的文件以进行传输。
-     *
-     * @param file_name 要打开的文件名
-     * @return 如果文件成功打开则返回 true，否则返回 false
+     * 绑定调用线程到指定 CPU。失败只影响性能，不影响正确性，记录后继续运行。
      */
-    bool UdpServer::OpenFile(const std::string& file_name)
+    void UdpServer::PinToCpu(int cpu)
     {
-        LOG(INFO) << "Opening the file " << file_name;
-
-        /** 使用输入模式打开文件 */
-        file_.open(file_name.c_str(), std::ios::in);
-
-        /** 检查文件是否成功打开 */
-        if (!this->file_.is_open())
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
         {
-            LOG(INFO) << "File: " << file_name << " opening failed";
-            return false; /** 文件打开失败，返回 false */
+            LOG(WARNING) << "Failed to pin worker to cpu " << cpu;
+            return;
         }
-        else
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) < 0)
         {
-            LOG(INFO) << "File: " << file_name << " opening success";
-            return true; /** 文件打开成功，返回 true */
+            LOG(WARNING) << "Failed to set SO_INCOMING_CPU to " << cpu;
         }
-    }
-
-    /** 文件传输函数 */
-    void UdpServer::StartFileTransfer()
-    {
-        LOG(INFO) << "Starting the file_ transfer ";
-
-        /** 将文件指针移动到文件末尾以获取文件大小 */
-        file_.seekg(0, std::ios::end);
-        file_length_ = file_.tellg(); /** 获取文件总长度 */
-
-        /** 将文件指针重置到文件开头 */
-        file_.seekg(0, std::ios::beg);
-
-        /** 开始发送文件数据 */
-        send();
+        LOG(INFO) << "Worker pinned to cpu " << cpu;
     }
 
     /**
-     * 向客户端发送错误信息（文件未找到）。
+     * 挂载按 CPU 选择 socket 的 CBPF 程序：A = cpu; A %= workers; return A。
+     * 返回值超出组内 socket 数量时内核退回默认的哈希选择。
      */
-    void UdpServer::SendError()
+    bool UdpServer::AttachCpuSteering(int workers)
     {
-        std::string error("FILE NOT FOUND");
-
-        /** 发送错误消息到客户端 */
-        sendto(sockfd_, error.c_str(), error.size(), 0,
-               (struct sockaddr*)&cli_address_, sizeof(cli_address_));
+        struct sock_filter code[] = {
+            {BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU)},
+            {BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)workers},
+            {BPF_RET | BPF_A, 0, 0, 0},
+        };
+        struct sock_fprog program;
+        program.len = sizeof(code) / sizeof(code[0]);
+        program.filter = code;
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                       sizeof(program)) < 0)
+        {
+            LOG(ERROR) << "Failed to attach reuseport CBPF program !!!";
+            return false;
+        }
+        LOG(INFO) << "Steering datagrams by cpu across " << workers << " workers";
+        return true;
     }
 
     /**
-     * 发送函数，用于通过 UDP 发送文件数据，支持滑动窗口机制和拥塞控制。
+     * 事件循环：等待 socket 可读或会话定时器到期，并分发处理。
+     *
+     * @param file_path 服务器文件目录
      */
-    void UdpServer::send()
+    void UdpServer::Run(const std::string& file_path)
     {
-        LOG(INFO) << "Entering Send()";
-
-        int sent_count = 1;
-        int sent_count_limit = 1;
-
-        struct timeval process_start_time;
-        struct timeval process_end_time;
-        gettimeofday(&process_start_time, NULL); /** 记录发送过程开始时间 */
-
-        /** 如果是第一次发送，重置起始字节位置为 0 */
-        if (sliding_window_->lastSendPacketSeq == -1)
-        {
-            start_byte_ = 0;
-        }
+        file_path_ = file_path;
+        recv_batch_ = std::make_unique<RecvBatch>(session_config_.batch_size);
+        struct epoll_event events[MAX_EPOLL_EVENTS];
 
-        /** 循环发送数据直到所有字节都被传输 */
-        while (start_byte_ <= file_length_)
+        LOG(INFO) << "Entering event loop";
+        while (true)
         {
-            fd_set rfds; /** 文件描述符集合，用于 select */
-            struct timeval tv; /** 超时时间结构体 */
-            int res; /** select 返回结果 */
-
-            sent_count = 1;
-            sent_count_limit = std::min(rwnd_, cwnd_); /** 窗口允许的最大发送数 */
-
-            LOG(INFO) << "SEND START  !!!!";
-            LOG(INFO) << "Before the window rwnd_: " << rwnd_ << " cwnd_: " << cwnd_
-                << " window used: "
-                << sliding_window_->lastSendPacketSeq -
-                sliding_window_->lastAckedPacketSeq;
-
-            /**
-             * 发送数据包，直到窗口已满或没有更多数据可发送
-             */
-            while (sliding_window_->lastSendPacketSeq -
-                sliding_window_->lastAckedPacketSeq <=
-                std::min(rwnd_, cwnd_) &&
-                sent_count <= sent_count_limit)
+            int n = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+            if (n < 0)
             {
-                sendpacket(start_byte_ + initial_seq_number_, start_byte_);
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                LOG(ERROR) << "Error in epoll_wait";
+                break;
+            }
 
-                /** 统计慢启动阶段发送的数据包数量 */
-                if (is_slow_start_)
+            for (int i = 0; i < n; i++)
+            {
+                if (events[i].data.fd == sockfd_)
                 {
-                    packet_statistics_->slowStartPacketTxStatistics++;
+                    handleDatagrams();
                 }
-                else if (is_cong_avd_)
+                else
                 {
-                    /** 统计拥塞避免阶段发送的数据包数量 */
-                    packet_statistics_->congAvdPacketTxStatistics++;
+                    handleTimer(events[i].data.fd);
                 }
+            }
+        }
+    }
 
-                /** 更新下一个要发送的起始字节位置 */
-                start_byte_ = start_byte_ + MAX_DATA_SIZE;
-                if (start_byte_ > file_length_)
+    /**
+     * 读取 socket 上所有待处理的数据报。以请求魔数开头的是文件请求，
+     * 其余的按头部的连接 ID 作为 ACK 交给对应的会话。
+     */
+    void UdpServer::handleDatagrams()
+    {
+        while (true)
+        {
+            int n = recv_batch_->Receive(sockfd_, MSG_DONTWAIT);
+            if (n < 0)
+            {
+                if (errno == EINTR)
                 {
-                    LOG(INFO) << "No more data left to be sent";
-                    break;
+                    continue;
                 }
-                sent_count++;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG(ERROR) << "Error in recvmmsg";
+                }
+                return;
             }
 
-            LOG(INFO) << "SEND END !!!!!";
-
-            /** 设置 select 超时时间 */
-            FD_ZERO(&rfds);
-            FD_SET(sockfd_, &rfds);
+            acked_sessions_.clear();
+            for (int i = 0; i < n; i++)
+            {
+                unsigned char* buffer = recv_batch_->data(i);
+                int length = recv_batch_->length(i);
+                const struct sockaddr_in& client_address = recv_batch_->address(i);
 
-            tv.tv_sec = (int64_t)smoothed_timeout_ / 1000000;
-            tv.tv_usec = smoothed_timeout_ - tv.tv_sec;
+                if (FileRequest::IsRequest(reinterpret_cast<char*>(buffer), length))
+                {
+                    handleRequest(client_address, reinterpret_cast<char*>(buffer),
+                                  length);
+                    continue;
+                }
 
-            LOG(INFO) << "SELECT START:" << smoothed_timeout_ << "!!!";
-            while (true)
-            {
-                /** 等待 ACK 或超时 */
-                res = select(sockfd_ + 1, &rfds, NULL, NULL, &tv);
-                if (res == -1)
+                /** 已结束会话的迟到 ACK 和未知的连接 ID 直接忽略 */
+                uint32_t connection_id;
+                if (!DataSegment::PeekConnectionId(buffer, length, &connection_id))
                 {
-                    LOG(ERROR) << "Error in select";
+                    continue;
                 }
-                else if (res > 0)
+                auto it = sessions_.find(connection_id);
+                if (it == sessions_.end())
                 {
-                    // 收到 ACK
-                    waitForAck();
-
-                    /** 检查是否进入拥塞避免阶段 */
-                    if (cwnd_ >= ssthresh_)
-                    {
-                        LOG(INFO) << "CHANGE TO CONG AVD";
-                        is_cong_avd_ = true;
-                        is_slow_start_ = false;
-
-                        cwnd_ = 1;
-                        ssthresh_ = 64;
-                    }
-
-                    /**
-                     * 如果所有已发送数据包都被确认，则根据拥塞控制算法调整窗口大小
-                     */
-                    if (sliding_window_->lastAckedPacketSeq ==
-                        sliding_window_->lastSendPacketSeq)
-                    {
-                        if (is_slow_start_)
-                        {
-                            cwnd_ = cwnd_ * 2; /** 慢启动阶段：指数增长 */
-                        }
-                        else
-                        {
-                            cwnd_ = cwnd_ + 1; /** 拥塞避免阶段：线性增长 */
-                        }
-                        break;
-                    }
+                    continue;
                 }
-                else
+
+                UdpSession* session = it->second.get();
+                session->OnAck(buffer, length, client_address);
+                if (std::find(acked_sessions_.begin(), acked_sessions_.end(),
+                              session) == acked_sessions_.end())
                 {
-                    // 超时
-                    LOG(INFO) << "Timeout occurred SELECT::" << smoothed_timeout_;
-
-                    /** 拥塞控制：慢启动阈值调整 */
-                    ssthresh_ = cwnd_ / 2;
-                    if (ssthresh_ < 1)
-                    {
-                        ssthresh_ = 1;
-                    }
-                    cwnd_ = 1;
-
-                    /** 如果处于快速恢复阶段，则切换回慢启动 */
-                    if (is_fast_recovery_)
-                    {
-                        is_fast_recovery_ = false;
-                    }
-                    is_slow_start_ = true;
-                    is_cong_avd_ = false;
-
-                    /**
-                     * 重新传输所有未被确认的数据包
-                     */
-                    for (int i = sliding_window_->lastAckedPacketSeq + 1;
-                         i <= sliding_window_->lastSendPacketSeq; i++)
-                    {
-                        int retransmit_start_byte = 0;
-                        if (sliding_window_->lastAckedPacketSeq != -1)
-                        {
-                            retransmit_start_byte =
-                                sliding_window_
-                                ->sliding_window_buffers_[sliding_window_
-                                    ->lastAckedPacketSeq]
-                                .firstByteSeq +
-                                MAX_DATA_SIZE;
-                        }
-                        LOG(INFO) << "Timeout Retransmit seq number"
-                            << retransmit_start_byte + initial_seq_number_;
-                        retransmitSegment(retransmit_start_byte);
-                        packet_statistics_->retransStatistics++; /** 统计重传次数 */
-                        LOG(INFO) << "Timeout: retransmission at " << retransmit_start_byte;
-                    }
-
-                    break;
+                    acked_sessions_.push_back(session);
                 }
             }
-            LOG(INFO) << "SELECT END !!!";
-            LOG(INFO) << "current byte ::" << start_byte_ << " file_length_ "
-                << file_length_;
-        }
 
-        gettimeofday(&process_end_time, NULL); /** 记录结束时间 */
+            /** 整批 ACK 处理完后，再统一评估拥塞窗口并发送 */
+            for (UdpSession* session : acked_sessions_)
+            {
+                session->OnAckBatchEnd();
+                reapSession(session);
+            }
 
-        /**
-         * 计算整个传输过程的总时间
-         */
-        int64_t total_time =
-            (process_end_time.tv_sec * 1000000 + process_end_time.tv_usec) -
-            (process_start_time.tv_sec * 1000000 + process_start_time.tv_usec);
-
-        int total_packet_sent = packet_statistics_->slowStartPacketTxStatistics +
-            packet_statistics_->congAvdPacketTxStatistics;
-        LOG(INFO) << "\n";
-        LOG(INFO) << "========================================";
-        LOG(INFO) << "Total Time: " << (float)total_time / pow(10, 6) << " secs";
-        LOG(INFO) << "Statistics: 拥塞控制--慢启动: "
-            << packet_statistics_->slowStartPacketTxStatistics
-            << " 拥塞控制--拥塞避免: "
-            << packet_statistics_->congAvdPacketTxStatistics;
-        LOG(INFO) << "Statistics: Slow start: "
-            << ((float)packet_statistics_->slowStartPacketTxStatistics /
-                total_packet_sent) *
-            100
-            << "% CongAvd: "
-            << ((float)packet_statistics_->congAvdPacketTxStatistics /
-                total_packet_sent) *
-            100
-            << "%";
-        LOG(INFO) << "Statistics: Retransmissions: "
-            << packet_statistics_->retransStatistics;
-        LOG(INFO) << "========================================";
+            if (n < session_config_.batch_size)
+            {
+                return;
+            }
+        }
     }
 
     /**
-     * 发送单个数据包，处理滑动窗口中的缓冲区更新，并准备发送数据。
-     *
-     * @param seq_number 数据包的序列号
-     * @param start_byte 当前数据块在文件中的起始字节位置
+     * 接收新客户端的请求，创建会话并开始文件传输。
      */
-    void UdpServer::sendpacket(int seq_number, int start_byte)
+    void UdpServer::handleRequest(const struct sockaddr_in& cli_address,
+                                  const char* request, int length)
     {
-        bool lastPacket = false; /** 标记是否是最后一个数据包 */
-        int dataLength = 0; /** 定义本次发送的数据长度 */
-
-        /**
-         * 判断当前要发送的数据块是否是最后一个数据包
-         * 如果剩余字节数小于等于最大数据长度，则表示这是最后一个包
-         */
-        if (file_length_ <= start_byte + MAX_DATA_SIZE)
-        {
-            LOG(INFO) << "Last packet to be sent !!!";
-            dataLength = file_length_ - start_byte;
-            lastPacket = true;
-        }
-        else
+        FileRequest file_request;
+        if (!FileRequest::Parse(request, length, &file_request))
         {
-            dataLength = MAX_DATA_SIZE; /** 否则按最大数据长度发送 */
+            LOG(ERROR) << "Malformed request ignored";
+            return;
         }
 
-        struct timeval time;
-
-        gettimeofday(&time, NULL); /** 获取当前时间戳，用于 RTT 计算 */
+        /** 记录接收到的请求信息 */
+        LOG(INFO) << "***Request received is: " << file_request.fileName
+            << " offset: " << file_request.offset << " length: " << file_request.length
+            << " compression: " << BlockCodec::Name(file_request.compression)
+            << (file_request.sizeQuery ? " (size query)" : "");
 
         /**
-         * 如果已存在已发送但未确认的数据包，并且当前要发送的是之前已经发过的包（重传）
-         * 则更新该数据包的时间戳
+         * SessionAccept 或客户端的确认丢失时客户端会重发请求：
+         * 同一个令牌和地址只重发 SessionAccept，不建立第二个会话
          */
-        if (sliding_window_->lastSendPacketSeq != -1 &&
-            start_byte <
-            sliding_window_
-            ->sliding_window_buffers_[sliding_window_->lastSendPacketSeq]
-            .firstByteSeq)
+        auto pending = handshakes_.find(file_request.clientToken);
+        if (pending != handshakes_.end())
         {
-            for (int i = sliding_window_->lastAckedPacketSeq + 1;
-                 i < sliding_window_->lastSendPacketSeq; i++)
+            const struct sockaddr_in& address = pending->second->cli_address();
+            if (address.sin_addr.s_addr == cli_address.sin_addr.s_addr &&
+                address.sin_port == cli_address.sin_port)
             {
-                if (sliding_window_->sliding_window_buffers_[i].firstByteSeq ==
-                    start_byte)
+                if (!pending->second->IsEstablished())
                 {
-                    sliding_window_->sliding_window_buffers_[i].timeSentStamp = time;
-                    break;
+                    pending->second->SendAccept();
                 }
+                return;
             }
         }
-        else
+
+        /** 数据段的载荷长度固定为 MAX_DATA_SIZE，客户端必须能接收 */
+        if (!file_request.sizeQuery && file_request.maxSegmentSize < MAX_DATA_SIZE)
         {
-            /**
-             * 否则将新数据包信息加入滑动窗口缓冲区
-             */
-            SlidWinBuffer slidingWindowBuffer;
-            slidingWindowBuffer.firstByteSeq = start_byte; /** 设置该数据包的起始字节位置 */
-            slidingWindowBuffer.dataLength = dataLength; /** 设置该数据包的数据长度 */
-            slidingWindowBuffer.currSeqNum = initial_seq_number_ + start_byte; /** 设置序列号 */
-            struct timeval time;
-            gettimeofday(&time, NULL);
-            slidingWindowBuffer.timeSentStamp = time; /** 记录发送时间，用于 RTT 计算 */
-
-            /**
-             * 将新的缓冲区加入滑动窗口
-             */
-            sliding_window_->lastSendPacketSeq =
-                sliding_window_->AddToBuffer(slidingWindowBuffer);
+            LOG(ERROR) << "Client segment size " << file_request.maxSegmentSize
+                << " is below " << MAX_DATA_SIZE << ", request ignored";
+            return;
         }
 
         /**
-         * 从文件中读取指定范围的数据并发送
-         */
-        readFileAndSend(lastPacket, start_byte, start_byte + dataLength);
-    }
-
-    /**
-     * 等待并处理客户端的 ACK 响应。
-     */
-    void UdpServer::waitForAck()
-    {
-        /** 定义接收缓冲区并初始化为 0 */
-        unsigned char buffer[MAX_PACKET_SIZE];
-        memset(buffer, 0, MAX_PACKET_SIZE);
-
-        /** 客户端地址信息 */
-        socklen_t addr_size;
-        struct sockaddr_in client_address;
-        addr_size = sizeof(client_address);
-
-        int n = 0;
-        int ack_number;
-
-        /**
-         * 循环接收数据直到成功收到数据包
-         * recvfrom 用于接收 UDP 数据包
+         * 协商：窗口取双方的较小值，功能取双方都支持的部分
          */
-        while ((n = recvfrom(sockfd_, buffer, MAX_PACKET_SIZE, 0,
-                             (struct sockaddr*)&client_address, &addr_size)) <= 0)
+        SessionAccept accept;
+        accept.connectionId = newConnectionId();
+        accept.clientToken = file_request.clientToken;
+        accept.initialSeqNumber = random_() % INITIAL_SEQ_NUMBER_RANGE;
+        accept.window = file_request.window > 0
+            ? std::min(session_config_.rwnd, file_request.window)
+            : session_config_.rwnd;
+        accept.window = std::max(1, accept.window);
+        accept.features = file_request.features &
+            (session_config_.fec_block > 0 ? FEATURE_FEC : 0);
+
+        std::unique_ptr<UdpSession> session = std::make_unique<UdpSession>(
+            sockfd_, cli_address, session_config_, accept);
+        UdpSession* raw_session = session.get();
+
+        /** 多文件请求不支持范围和压缩，所有文件按原样连续发送 */
+        bool opened;
+        if (file_request.bundle)
         {
-        };
-
-        /** 反序列化接收到的数据为数据段对象 */
-        DataSegment ack_segment;
-        ack_segment.DeserializeToDataSegment(buffer, n);
-
-        /** 获取最后一个已确认的数据包 */
-        SlidWinBuffer last_packet_acked_buffer =
-            sliding_window_
-            ->sliding_window_buffers_[sliding_window_->lastAckedPacketSeq];
-
-        /** 如果收到 ACK 标志 */
-        if (ack_segment.ackFlag)
-        {
-            /**
-             * 如果收到的是当前发送窗口基地址的 ACK，
-             * 则视为重复 ACK（DUP ACK）
-             */
-            if (ack_segment.ackNum == sliding_window_->sendBaseSeq)
+            if (file_request.compression != Compression::NONE)
             {
-                LOG(INFO) << "DUP ACK Received: ack_number: " << ack_segment.ackNum;
-                sliding_window_->dupAckNum++;
-
-                /**
-                 * 如果连续收到 3 次重复 ACK，则触发快速重传
-                 */
-                if (sliding_window_->dupAckNum == 3)
-                {
-                    packet_statistics_->retransStatistics++;
-                    LOG(INFO) << "Fast Retransmit seq_number: " << ack_segment.ackNum;
-                    retransmitSegment(ack_segment.ackNum - initial_seq_number_);
-                    sliding_window_->dupAckNum = 0;
-
-                    if (cwnd_ > 1)
-                    {
-                        cwnd_ = cwnd_ / 2;
-                    }
-                    ssthresh_ = cwnd_;
-                    is_fast_recovery_ = true;
-                }
-            }
-            /**
-             * 如果收到新的 ACK，表示数据包已被正确接收
-             */
-            else if (ack_segment.ackNum > sliding_window_->sendBaseSeq)
-            {
-                /**
-                 * 如果处于快速恢复阶段，则调整拥塞控制参数
-                 */
-                if (is_fast_recovery_)
-                {
-                    cwnd_++;
-                    is_fast_recovery_ = false;
-                    is_cong_avd_ = true;
-                    is_slow_start_ = false;
-                }
-
-                sliding_window_->dupAckNum = 0;
-                sliding_window_->sendBaseSeq = ack_segment.ackNum;
-
-                /**
-                 * 如果是第一个已确认的数据包，则初始化相关变量
-                 */
-                if (sliding_window_->lastAckedPacketSeq == -1)
-                {
-                    sliding_window_->lastAckedPacketSeq = 0;
-                    last_packet_acked_buffer =
-                        sliding_window_
-                        ->sliding_window_buffers_[sliding_window_->lastAckedPacketSeq];
-                }
-
-                ack_number = last_packet_acked_buffer.currSeqNum +
-                    last_packet_acked_buffer.dataLength;
-
-                /**
-                 * 更新已确认的数据包信息
-                 */
-                while (ack_number < ack_segment.ackNum)
-                {
-                    sliding_window_->lastAckedPacketSeq++;
-                    last_packet_acked_buffer =
-                        sliding_window_
-                        ->sliding_window_buffers_[sliding_window_->lastAckedPacketSeq];
-                    ack_number = last_packet_acked_buffer.currSeqNum +
-                        last_packet_acked_buffer.dataLength;
-                }
-
-                /**
-                 * 计算 RTT 和超时时间
-                 */
-                struct timeval startTime = last_packet_acked_buffer.timeSentStamp;
-                struct timeval endTime;
-                gettimeofday(&endTime, NULL);
-                calculateRttAndTime(startTime, endTime);
+                LOG(INFO) << "Compression is not applied to a bundle";
             }
+            opened = session->OpenBundle(file_path_, file_request.fileName);
         }
-    }
-
-    /**
-     * 计算 RTT（往返时间）和超时时间。
-     *
-     * @param start_time RTT 开始时间
-     * @param end_time RTT 结束时间
-     */
-    void UdpServer::calculateRttAndTime(struct timeval start_time,
-                                           struct timeval end_time)
-    {
-        /** 如果开始时间为 0，则不进行计算 */
-        if (start_time.tv_sec == 0 && start_time.tv_usec == 0)
+        else
+        {
+            std::string file_name = file_path_ + file_request.fileName;
+            opened = session->OpenFile(file_name, (int)file_request.offset,
+                                       (int)file_request.length,
+                                       file_request.compression);
+        }
+        if (!opened)
         {
+            session->SendError();
             return;
         }
 
-        /** 计算样本 RTT（单位：微秒） */
-        long sample_rtt = (end_time.tv_sec * 1000000 + end_time.tv_usec) -
-            (start_time.tv_sec * 1000000 + start_time.tv_usec);
-
-        /** 使用加权平均算法更新平滑 RTT */
-        smoothed_rtt_ = smoothed_rtt_ + 0.125 * (sample_rtt - smoothed_rtt_);
-
-        /** 更新 RTT 偏差 */
-        dev_rtt_ = 0.75 * dev_rtt_ + 0.25 * (abs(smoothed_rtt_ - sample_rtt));
-
-        /** 计算超时时间 */
-        smoothed_timeout_ = smoothed_rtt_ + 4 * dev_rtt_;
+        /** 大小查询只需要一个回复，不建立传输 */
+        if (file_request.sizeQuery)
+        {
+            session->SendFileSize();
+            return;
+        }
 
-        /** 如果超时时间过长，则随机设置一个较小值 */
-        if (smoothed_timeout_ > 1000000)
+        /** 将会话的重传定时器注册到 epoll */
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = session->timer_fd();
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, session->timer_fd(), &event) < 0)
         {
-            smoothed_timeout_ = rand() % 30000;
+            LOG(ERROR) << "Failed to add timer to epoll !!!";
+            return;
         }
-    }
 
-    /**
-     * 重新传输指定起始字节位置的数据段。
-     *
-     * @param index_number 要重传的数据段的起始字节位置
-     */
-    void UdpServer::retransmitSegment(int index_number)
-    {
-        /** 查找滑动窗口中需要重传的数据包并更新发送时间 */
-        for (int i = sliding_window_->lastAckedPacketSeq + 1;
-             i < sliding_window_->lastSendPacketSeq; i++)
+        timer_sessions_[session->timer_fd()] = raw_session;
+
+        /** 开启 pacing 时发送定时器同样由 epoll 分发 */
+        if (session->pacing_timer_fd() >= 0)
         {
-            if (sliding_window_->sliding_window_buffers_[i].firstByteSeq ==
-                index_number)
+            event.data.fd = session->pacing_timer_fd();
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, session->pacing_timer_fd(), &event) < 0)
             {
-                struct timeval time;
-                gettimeofday(&time, NULL);
-                sliding_window_->sliding_window_buffers_[i].timeSentStamp = time;
-                break;
+                LOG(ERROR) << "Failed to add pacing timer to epoll !!!";
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session->timer_fd(), NULL);
+                timer_sessions_.erase(session->timer_fd());
+                return;
             }
+            timer_sessions_[session->pacing_timer_fd()] = raw_session;
         }
+        sessions_[accept.connectionId] = std::move(session);
+        handshakes_[accept.clientToken] = raw_session;
+        LOG(INFO) << "Session " << accept.connectionId << " window: "
+            << accept.window << " features: " << accept.features
+            << ", active sessions: " << sessions_.size();
 
-        /** 从指定位置读取文件数据并发送 */
-        readFileAndSend(false, index_number, index_number + MAX_DATA_SIZE);
+        raw_session->SendAccept();
     }
 
     /**
-     * 从文件中读取指定范围的数据并发送到客户端。
-     *
-     * @param fin_flag 是否是最后一个数据包
-     * @param start_byte 数据块在文件中的起始字节位置
-     * @param end_byte 数据块在文件中的结束字节位置
+     * 将定时器事件分发给对应会话。
      */
-    void UdpServer::readFileAndSend(bool fin_flag, int start_byte,
-                                       int end_byte)
+    void UdpServer::handleTimer(int timer_fd)
     {
-        int datalength = end_byte - start_byte;
-
-        /** 如果剩余数据量小于最大数据长度，则这是最后一个数据包 */
-        if (file_length_ - start_byte < datalength)
+        auto it = timer_sessions_.find(timer_fd);
+        if (it == timer_sessions_.end())
         {
-            datalength = file_length_ - start_byte;
-            fin_flag = true;
+            return;
         }
-
-        /** 分配内存用于存储读取的文件数据 */
-        char* fileData = reinterpret_cast<char*>(calloc(datalength, sizeof(char)));
-
-        /** 检查文件是否已经打开 */
-        if (!file_.is_open())
+        UdpSession* session = it->second;
+        if (timer_fd == session->pacing_timer_fd())
         {
-            LOG(ERROR) << "File open failed !!!";
-            return;
+            session->OnPacingTimer();
         }
-
-        /** 定位到文件中的指定位置并读取数据 */
-        file_.seekg(start_byte);
-        file_.read(fileData, datalength);
-
-        /** 创建数据段对象并设置相关字段 */
-        DataSegment* data_segment = new DataSegment();
-        data_segment->seqNumber = start_byte + initial_seq_number_;
-        data_segment->ackNum = 0;
-        data_segment->ackFlag = false;
-        data_segment->finflag = fin_flag;
-        data_segment->dataLength = datalength;
-        data_segment->data_ = fileData;
-
-        /** 发送数据段 */
-        sendDataSegment(data_segment);
-        LOG(INFO) << "Packet sent:seq number: " << data_segment->seqNumber;
-
-        /** 释放分配的内存 */
-        free(fileData);
-        free(data_segment);
+        else
+        {
+            session->OnTimeout();
+        }
+        reapSession(session);
     }
 
     /**
-     * 接收客户端请求并返回接收到的数据。
-     *
-     * @param client_sockfd 客户端 socket 文件描述符
-     * @return 返回接收到的数据缓冲区指针
+     * 移除已经结束的会话。
      */
-    char* UdpServer::GetRequest(int client_sockfd)
+    void UdpServer::reapSession(UdpSession* session)
     {
-        /** 分配内存用于存储接收的请求数据 */
-        char* buffer =
-            reinterpret_cast<char*>(calloc(MAX_PACKET_SIZE, sizeof(char)));
-        struct sockaddr_in client_address;
-        socklen_t addr_size;
-
-        /** 清空缓冲区 */
-        memset(buffer, 0, MAX_PACKET_SIZE);
-
-        /** 获取客户端地址长度 */
-        addr_size = sizeof(client_address);
-
-        /** 接收来自客户端的数据 */
-        recvfrom(client_sockfd, buffer, MAX_PACKET_SIZE, 0,
-                 (struct sockaddr*)&client_address, &addr_size);
-
-        /** 记录接收到的请求信息 */
-        LOG(INFO) << "***Request received is: " << buffer;
-
-        /** 保存客户端地址，供后续发送数据使用 */
-        cli_address_ = client_address;
-
-        /** 返回接收到的数据缓冲区 */
-        return buffer;
+        if (!session->IsFinished())
+        {
+            return;
+        }
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session->timer_fd(), NULL);
+        timer_sessions_.erase(session->timer_fd());
+        if (session->pacing_timer_fd() >= 0)
+        {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, session->pacing_timer_fd(), NULL);
+            timer_sessions_.erase(session->pacing_timer_fd());
+        }
+        auto pending = handshakes_.find(session->client_token());
+        if (pending != handshakes_.end() && pending->second == session)
+        {
+            handshakes_.erase(pending);
+        }
+        sessions_.erase(session->connection_id());
+        LOG(INFO) << "Session closed, active sessions: " << sessions_.size();
+        LOG(INFO) << "Server recv syscalls: " << recv_batch_->syscall_count()
+            << " datagrams: " << recv_batch_->datagram_count();
     }
 
-    /**
-     * 发送数据段到客户端。
-     *
-     * @param data_segment 要发送的数据段对象
-     */
-    void UdpServer::sendDataSegment(DataSegment* data_segment)
+    uint32_t UdpServer::newConnectionId()
     {
-        /** 将数据段序列化为字节数组 */
-        char* datagramChars = data_segment->SerializeToCharArray();
-
-        /** 发送数据到客户端 */
-        sendto(sockfd_, datagramChars, MAX_PACKET_SIZE, 0,
-               (struct sockaddr*)&cli_address_, sizeof(cli_address_));
-
-        /** 释放序列化后的数据内存 */
-        free(datagramChars);
+        uint32_t connection_id;
+        do
+        {
+            connection_id = random_();
+        } while (connection_id == 0 || sessions_.count(connection_id) > 0);
+        return connection_id;
     }
 } // namespace safe_udp
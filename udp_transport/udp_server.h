@@ -1,136 +1,120 @@
 #pragma once
 #include <netinet/in.h>     // 定义 sockaddr_in 结构体等网络相关数据结构
+#include <stdint.h>
 #include <unistd.h>         // 提供 POSIX 操作系统 API 的访问，如 close()
-#include <fstream>          // 文件流，用于读写文件
-#include <iostream>         // 输入输出流，用于打印调试信息等
 #include <memory>           // 智能指针支持，如 unique_ptr
+#include <random>           // 连接 ID 和初始序列号
 #include <string>           // 使用 std::string 存储字符串数据
+#include <unordered_map>    // 会话表
+#include <vector>
 /*自定义头文件实现数据*/
-#include "data_segment.h"       // 自定义头文件：数据分段类定义
-#include "packet_statistics.h"  // 自定义头文件：统计发送/接收的数据包信息
-#include "sliding_window.h"     // 自定义头文件：滑动窗口机制实现
+#include "datagram_batch.h" // 自定义头文件：批量收发数据报
+#include "udp_session.h"    // 自定义头文件：单个客户端的传输会话
 
 namespace safe_udp {
 
 /**
  * UdpServer 类
- * 实现一个基于 UDP 协议的服务器，提供可靠的数据传输功能，包括流量控制、拥塞控制、RTT 测量等。
+ * 实现一个基于 UDP 协议的常驻服务器。所有客户端共享同一个 socket，
+ * 每次传输的状态保存在独立的 UdpSession 中，按握手时分配的连接 ID 索引：
+ * 同一个地址上可以有多个会话。会话只接受握手时客户端地址发来的 ACK，
+ * 客户端地址变化（NAT 重新映射）后会话超时结束，由客户端续传。
+ * 服务器使用 epoll 同时等待 socket 上的数据报和各会话的重传定时器、
+ * 发送定时器（timerfd）。
  */
 class UdpServer {
  public:
   /**
    * 构造函数
-   * 初始化成员变量，建立连接前的准备操作（具体初始化可能在 StartServer 中进行）
+   * 初始化成员变量，建立连接前的准备操作（具体初始化在 StartServer 中进行）
    */
   UdpServer();
 
   /**
    * 析构函数
-   * 关闭 socket 和打开的文件流，释放资源
+   * 释放所有会话，关闭 socket 和 epoll 描述符
    */
-  ~UdpServer() {
-    close(sockfd_);
-    file_.close();
-  }
+  ~UdpServer();
 
   /**
-   * 接收客户端请求
-   * @param client_sockfd 客户端 socket 描述符
-   * @return 返回接收到的请求数据指针
+   * 启动服务器，绑定指定端口并创建 epoll 实例
+   * @param port 监听端口
+   * @param reuse_port 是否设置 SO_REUSEPORT，多个工作线程各自绑定同一端口，
+   *                   由内核按四元组哈希把每个客户端固定分给其中一个
+   * @return 返回 socket 描述符
    */
-  char *GetRequest(int client_sockfd);
+  int StartServer(int port, bool reuse_port = false);
 
   /**
-   * 打开指定文件
-   * @param file_name 要打开的文件名
-   * @return 成功打开返回 true，否则 false
+   * 把调用线程绑定到指定的 CPU，并把 socket 的 SO_INCOMING_CPU 设为该 CPU，
+   * 使会话状态、socket 缓冲区和软中断处理尽量留在同一个核的缓存中
+   * @param cpu CPU 编号
    */
-  bool OpenFile(const std::string &file_name);
+  void PinToCpu(int cpu);
 
   /**
-   * 开始文件传输流程
+   * 给 SO_REUSEPORT 组挂载 CBPF 程序，按接收数据报的 CPU（cpu % workers）
+   * 选择 socket，代替默认的四元组哈希。各工作线程的 socket 必须按编号顺序
+   * 绑定。只有同一个流的数据报总在同一个 CPU 上接收时（网卡 RSS，
+   * 或本机回环上发送方固定在一个核上），会话才会始终留在同一个工作线程
+   * @param workers 工作线程数量
+   * @return 挂载成功返回 true
    */
-  void StartFileTransfer();
+  bool AttachCpuSteering(int workers);
 
   /**
-   * 向客户端发送错误信息
+   * 运行事件循环，持续处理新请求、ACK 与重传超时
+   * @param file_path 服务器文件目录，请求的文件名相对于该目录
    */
-  void SendError();
+  void Run(const std::string &file_path);
 
-  /**
-   * 拥塞控制与流量控制相关变量
-   */
-  int rwnd_;            // 接收窗口大小（Receiver Window）
-  int cwnd_;            // 拥塞窗口大小（Congestion Window）
-  int ssthresh_;        // 慢启动阈值（Slow Start Threshold）
-  int start_byte_;      // 当前传输起始字节位置
-  bool is_slow_start_;  // 是否处于慢启动阶段
-  bool is_cong_avd_;    // 是否处于拥塞避免阶段
-  bool is_fast_recovery_; // 是否处于快速恢复阶段
-  int StartServer(int port); // 启动服务器，绑定指定端口并监听
+  SessionConfig session_config_;  // 新会话使用的配置（窗口、批量、GSO 等）
 
  private:
   /**
-   * 组件对象
+   * 用 recvmmsg 读取 socket 上所有待处理的数据报并分发给对应的会话，
+   * 每批数据报处理完后再让收到 ACK 的会话评估拥塞窗口
    */
-  std::unique_ptr<SlidingWindow> sliding_window_;      // 滑动窗口管理器
-  std::unique_ptr<PacketStatistics> packet_statistics_; // 数据包统计工具
+  void handleDatagrams();
 
   /**
-   * 私有成员变量
+   * 处理一个文件请求：创建会话并回复 SessionAccept，客户端确认后开始传输；
+   * 重发的请求只重发 SessionAccept
+   * @param cli_address 客户端地址
+   * @param request 请求数据（FileRequest）
+   * @param length 请求长度
    */
-  int sockfd_;                    // 服务器 socket 描述符
-  std::fstream file_;             // 文件流对象
-  struct sockaddr_in cli_address_;// 客户端地址结构体
-  int initial_seq_number_;        // 初始序列号
-  int file_length_;               // 文件总长度（字节数）
-  double smoothed_rtt_;           // 平滑往返时间（Smoothed RTT）
-  double dev_rtt_;                // RTT 偏差（Deviation RTT）
-  double smoothed_timeout_;       // 平滑超时时间（Smoothed Timeout）
+  void handleRequest(const struct sockaddr_in &cli_address,
+                     const char *request, int length);
 
   /**
-   * 内部方法声明
+   * 处理会话定时器到期事件
+   * @param timer_fd 到期的定时器描述符
    */
-  void send(); // 发送数据主逻辑
+  void handleTimer(int timer_fd);
 
   /**
-   * 发送指定序号和起始字节的数据包
-   * @param seq_number 序列号
-   * @param start_byte 起始字节位置
+   * 如果会话已结束，将其从会话表和 epoll 中移除
+   * @param session 待检查的会话
    */
-  void sendpacket(int seq_number, int start_byte);
+  void reapSession(UdpSession *session);
 
   /**
-   * 计算 RTT（往返时间）及超时时间
-   * @param start_time 请求开始时间
-   * @param end_time 响应结束时间
+   * 分配一个非 0 且未被使用的随机连接 ID
    */
-  void calculateRttAndTime(struct timeval start_time,
-                              struct timeval end_time);
+  uint32_t newConnectionId();
 
-  /**
-   * 重传指定索引的数据段
-   * @param index_number 数据段索引
-   */
-  void retransmitSegment(int index_number);
-
-  /**
-   * 从文件中读取数据并发送
-   * @param fin_flag 是否是最后一个数据段
-   * @param start_byte 起始字节
-   * @param end_byte 结束字节
-   */
-  void readFileAndSend(bool fin_flag, int start_byte, int end_byte);
-
-  /**
-   * 发送数据段
-   * @param data_segment 待发送的数据段对象
-   */
-  void sendDataSegment(DataSegment *data_segment);
-
-  /**
-   * 等待客户端 ACK 回复
-   */
-  void waitForAck();
+  int sockfd_;            // 服务器 socket 描述符
+  int epoll_fd_;          // epoll 实例描述符
+  std::string file_path_; // 服务器文件目录
+  std::mt19937 random_;   // 连接 ID 和初始序列号的随机数
+  /** 按连接 ID 索引的会话表 */
+  std::unordered_map<uint32_t, std::unique_ptr<UdpSession>> sessions_;
+  /** 客户端令牌到会话的映射，用于识别重发的请求 */
+  std::unordered_map<uint32_t, UdpSession *> handshakes_;
+  /** 定时器描述符（重传与发送）到会话的映射，用于分发定时器事件 */
+  std::unordered_map<int, UdpSession *> timer_sessions_;
+  std::unique_ptr<RecvBatch> recv_batch_;   // 批量接收缓冲区
+  std::vector<UdpSession *> acked_sessions_; // 本批收到 ACK 的会话
 };
-}  // namespace safe_udp
\ No newline at end of file
+}  // namespace safe_udp
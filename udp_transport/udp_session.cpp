@@ -0,0 +1,1012 @@
+#include "udp_session.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "crc32c.h"
+#include "file_request.h"
+#include "gf256.h"
+
+namespace safe_udp {
+/** 连续超时的上限，RTO 每次加倍，约等待 2^10 倍 RTO 后认为客户端已经失联 */
+constexpr int MAX_TIMEOUT_COUNT = 10;
+/** SessionAccept 的最多重发次数，之后放弃这次握手 */
+constexpr int MAX_ACCEPT_RETRIES = 5;
+/** 重传定时器轮的刻度（微秒），也是 RTO 计算中的时钟粒度 */
+constexpr int64_t RTO_TIMER_TICK_US = 1000;
+/** 空洞之后至少有这么多数据段被 SACK，才认为该空洞丢失（RFC 6675 DupThresh） */
+constexpr int DUP_THRESH = 3;
+/**
+ * 拥塞控制器不提供速率时按 gain * cwnd / SRTT 发送：
+ * 慢启动阶段窗口每轮翻倍，速率也要翻倍才不会限制窗口增长
+ */
+constexpr double PACING_GAIN_SLOW_START = 2;
+constexpr double PACING_GAIN_CONG_AVD = 1.25;
+/**
+ * 校验段数量 = 1 + ceil(FEC_LOSS_GAIN * 丢包率 * 分组大小)：
+ * 测得的丢包率是 FEC 之后仍需重传的部分，偏低，按两倍预留
+ */
+constexpr double FEC_LOSS_GAIN = 2;
+static_assert(MAX_DATA_SIZE <= CHUNK_OVERLAP,
+              "a segment must be contiguous in a cached chunk");
+
+/** 单调时钟的当前时间（纳秒），与 timerfd 使用同一个时钟，也是数据段时间戳的单位 */
+static int64_t nowNanos() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/** 单调时钟的当前时间（微秒），用于定时器与拥塞控制 */
+static int64_t nowMicros() { return nowNanos() / 1000; }
+
+/**
+ * 构造函数，初始化会话的拥塞控制、RTT 估计以及重传定时器
+ */
+UdpSession::UdpSession(int sockfd, const struct sockaddr_in &cli_address,
+                       const SessionConfig &config,
+                       const SessionAccept &accept) {
+  packet_statistics_ = std::make_unique<PacketStatistics>();
+  send_batch_ =
+      std::make_unique<SendBatch>(sockfd, cli_address, config.batch_size);
+  send_batch_->SetGso(config.gso);
+
+  sockfd_ = sockfd;
+  cli_address_ = cli_address;
+  accept_ = accept;
+  is_established_ = false;
+  rwnd_ = accept.window;
+
+  initial_seq_number_ = accept.initialSeqNumber;
+  /** 在途数据段最多为 min(rwnd, cwnd) + 1 个，环形缓冲区按 rwnd 一次分配 */
+  sliding_window_ =
+      std::make_unique<SlidingWindow>(initial_seq_number_, rwnd_ + 1);
+  /** 每个环形缓冲区槽位一个重传定时器 */
+  rto_timers_ = std::make_unique<TimerWheel>(sliding_window_->capacity(),
+                                             RTO_TIMER_TICK_US);
+  start_byte_ = 0;          /** 当前传输起始字节位置初始化为 0 */
+  range_offset_ = 0;
+  file_length_ = 0;
+
+  /** 拥塞控制算法由会话配置选择，速率按线上的数据报字节数计算 */
+  congestion_controller_ =
+      CongestionController::Create(config.congestion_control, MAX_PACKET_SIZE);
+  is_fast_recovery_ = false;
+  recovery_point_ = -1;
+
+  /** 客户端支持 FEC 且开启时预先分配一个数据报大小的编码缓冲区 */
+  fec_block_ = (accept.features & FEATURE_FEC)
+                   ? std::min(std::max(config.fec_block, 0), MAX_FEC_BLOCK)
+                   : 0;
+  if (fec_block_ > 0) {
+    fec_packet_.resize(MAX_PACKET_SIZE);
+  }
+
+  chunk_cache_ = config.chunk_cache;
+
+  timeout_count_ = 0;
+  is_all_sent_ = false;
+  is_finished_ = false;
+  memset(&process_start_time_, 0, sizeof(process_start_time_));
+
+  /** 每个会话拥有独立的单调时钟定时器，按时间轮上最近的重传期限唤醒 */
+  timer_deadline_ = -1;
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd_ < 0) {
+    LOG(ERROR) << "Failed to create timerfd !!!";
+  }
+
+  /** 开启 pacing 时另建一个发送定时器，令牌不足时由它唤醒继续发送 */
+  pacing_timer_fd_ = -1;
+  pacing_timer_armed_ = false;
+  if (config.pacing) {
+    pacing_timer_fd_ =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (pacing_timer_fd_ < 0) {
+      LOG(ERROR) << "Failed to create pacing timerfd, pacing disabled !!!";
+    }
+  }
+}
+
+/**
+ * 析构函数，关闭定时器；文件映射由 FileSource 释放
+ */
+UdpSession::~UdpSession() {
+  if (timer_fd_ >= 0) {
+    close(timer_fd_);
+  }
+  if (pacing_timer_fd_ >= 0) {
+    close(pacing_timer_fd_);
+  }
+}
+
+/**
+ * 打开指定的文件以进行传输。
+ *
+ * @param file_name 要打开的文件名
+ * @return 如果文件成功打开则返回 true，否则返回 false
+ */
+bool UdpSession::OpenFile(const std::string &file_name, int offset,
+                          int length, Compression compression) {
+  LOG(INFO) << "Opening the file " << file_name;
+
+  if (!file_source_.Open(file_name, chunk_cache_)) {
+    LOG(INFO) << "File: " << file_name << " opening failed";
+    return false;
+  }
+  /**
+   * 偏移和序列号在会话中是 int（线上为无符号 32 位），整个文件加初始序列号
+   * 都必须在 INT_MAX 之内；压缩流每个分组多出头部和补齐到数据段边界的部分
+   */
+  int64_t size = file_source_.size();
+  int64_t stream_limit = size;
+  if (compression != Compression::NONE) {
+    int64_t blocks = (size + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE;
+    stream_limit += blocks * (COMPRESSED_BLOCK_HEADER_LENGTH + MAX_DATA_SIZE);
+  }
+  if (stream_limit > INT_MAX - initial_seq_number_) {
+    LOG(ERROR) << "File: " << file_name << " of " << size
+               << " bytes exceeds the sequence space";
+    return false;
+  }
+  range_offset_ = std::min<int64_t>(offset, size);
+  file_length_ = length < 0 ? size - range_offset_
+                            : std::min<int64_t>(length, size - range_offset_);
+  LOG(INFO) << "File: " << file_name << " opening success, range: "
+            << range_offset_ << " + " << file_length_;
+
+  if (compression != Compression::NONE) {
+    Compression method = BlockCodec::Resolve(compression);
+    compressed_stream_ = std::make_unique<CompressedStream>(
+        &file_source_, range_offset_, file_length_, method);
+    file_length_ = 0;
+    LOG(INFO) << "Compression requested: " << BlockCodec::Name(compression)
+              << " using: " << BlockCodec::Name(method);
+    /** 校验段按数据段下标分组，与按压缩分组编号的数据段不兼容，压缩时不发送 */
+    if (fec_block_ > 0) {
+      LOG(INFO) << "FEC disabled for the compressed transfer";
+      fec_block_ = 0;
+    }
+  }
+  return true;
+}
+
+/**
+ * 多文件传输：所有文件排成一个字节流，序列号按字节流编号，
+ * 拥塞窗口和 RTT 估计在文件之间保留，小文件共用数据段
+ */
+bool UdpSession::OpenBundle(const std::string &directory,
+                            const std::string &names) {
+  std::vector<std::string> patterns;
+  size_t start = 0;
+  while (start <= names.size()) {
+    size_t end = names.find('\n', start);
+    if (end == std::string::npos) {
+      end = names.size();
+    }
+    patterns.push_back(names.substr(start, end - start));
+    start = end + 1;
+  }
+
+  bundle_ = std::make_unique<FileBundle>();
+  if (!bundle_->Open(directory, patterns, chunk_cache_)) {
+    bundle_.reset();
+    return false;
+  }
+  if (bundle_->size() > INT_MAX - initial_seq_number_) {
+    LOG(ERROR) << "Bundle of " << bundle_->size()
+               << " bytes exceeds the sequence space";
+    bundle_.reset();
+    return false;
+  }
+  range_offset_ = 0;
+  file_length_ = bundle_->size();
+  return true;
+}
+
+/**
+ * 发送 SessionAccept。它不进入滑动窗口，丢失时由定时器按 RTO 退避重发，
+ * 客户端重发的请求也会触发一次重发
+ */
+void UdpSession::SendAccept() {
+  char payload[SESSION_ACCEPT_LENGTH];
+  char packet[HEADER_LENGTH + SESSION_ACCEPT_LENGTH];
+  DataSegment accept_segment;
+  accept_.ToSegment(payload, &accept_segment);
+  accept_segment.timestamp = nowNanos();
+  int length = accept_segment.SerializeTo(packet);
+  send_batch_->Append(packet, length);
+  send_batch_->Flush();
+  armTimerAt(accept_segment.timestamp / 1000 + rtt_estimator_.rto());
+}
+
+/** 文件传输函数：获取文件长度并发送第一个窗口 */
+void UdpSession::StartFileTransfer() {
+  LOG(INFO) << "Starting the file_ transfer ";
+
+  gettimeofday(&process_start_time_, NULL);
+  start_byte_ = 0;
+  sendWindow();
+  armTimer();
+}
+
+/**
+ * 向客户端发送错误信息（文件未找到），并结束会话。
+ */
+void UdpSession::SendError() {
+  std::string error("FILE NOT FOUND");
+  sendto(sockfd_, error.c_str(), error.size(), 0,
+         (struct sockaddr *)&cli_address_, sizeof(cli_address_));
+  is_finished_ = true;
+}
+
+/**
+ * 回复文件大小查询，查询不需要传输，会话随即结束。
+ */
+void UdpSession::SendFileSize() {
+  std::string reply("SIZE " + std::to_string(file_source_.size()));
+  sendto(sockfd_, reply.c_str(), reply.size(), 0,
+         (struct sockaddr *)&cli_address_, sizeof(cli_address_));
+  is_finished_ = true;
+}
+
+/**
+ * 按确认时钟发送：在途数据段少于 min(rwnd, cwnd) 时继续发送新数据，
+ * 直到窗口已满或没有更多数据可发送，然后批量发出发送队列。
+ * 开启 pacing 时还要受令牌限制，令牌耗尽后由发送定时器唤醒继续发送。
+ */
+void UdpSession::sendWindow() {
+  int window = std::max(1, std::min(rwnd_, congestion_controller_->cwnd()));
+  int64_t now = nowMicros();
+  if (pacing_timer_fd_ >= 0) {
+    updatePacingRate(now);
+  }
+
+  LOG(INFO) << "SEND START  !!!!";
+  LOG(INFO) << "Before the window rwnd_: " << rwnd_
+            << " cwnd: " << congestion_controller_->cwnd() << " window used: "
+            << sliding_window_->lastSendPacketSeq -
+                   sliding_window_->lastAckedPacketSeq;
+
+  while (!is_all_sent_ && !sliding_window_->IsFull() &&
+         sliding_window_->lastSendPacketSeq -
+                 sliding_window_->lastAckedPacketSeq <
+             window) {
+    if (!pacer_.CanSend(now)) {
+      armPacingTimer();
+      break;
+    }
+    is_all_sent_ = sendpacket(start_byte_ + initial_seq_number_, start_byte_);
+
+    if (congestion_controller_->in_slow_start()) {
+      packet_statistics_->slowStartPacketTxStatistics++;
+    } else {
+      packet_statistics_->congAvdPacketTxStatistics++;
+    }
+
+    start_byte_ = start_byte_ + MAX_DATA_SIZE;
+    if (is_all_sent_) {
+      LOG(INFO) << "No more data left to be sent";
+      break;
+    }
+  }
+
+  send_batch_->Flush();
+  /** 队列中的载荷已经发出，之前用到的缓存块可以释放 */
+  file_source_.Unpin();
+  if (bundle_) {
+    bundle_->Unpin();
+  }
+  LOG(INFO) << "SEND END !!!!!";
+}
+
+/**
+ * 按时间轮上最近的期限以绝对时间启动 timerfd。
+ * 已经按更早的时间启动时保持不变：提前唤醒时时间轮没有到期项，只是重新设置，
+ * 这样确认推进时不需要每次都调用 timerfd_settime
+ */
+void UdpSession::armTimer() {
+  int64_t deadline = rto_timers_->NextExpiry();
+  if (deadline < 0 || (timer_deadline_ >= 0 && timer_deadline_ <= deadline)) {
+    return;
+  }
+  armTimerAt(deadline);
+}
+
+void UdpSession::armTimerAt(int64_t deadline) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = deadline / 1000000;
+  its.it_value.tv_nsec = (deadline % 1000000) * 1000;
+  if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+    LOG(ERROR) << "Failed to arm timerfd !!!";
+    return;
+  }
+  timer_deadline_ = deadline;
+}
+
+/**
+ * 数据段的重传期限为发送时间加上当前 RTO（包含退避）
+ */
+void UdpSession::scheduleRetransmit(int index, int64_t now) {
+  rto_timers_->Schedule(sliding_window_->SlotOf(index),
+                        now + rtt_estimator_.rto(), now);
+}
+
+/**
+ * 拥塞控制器给出速率（BBR）时直接使用，否则按 gain * cwnd / SRTT 计算；
+ * 还没有 RTT 样本时不限速，由初始窗口限制发送量
+ */
+void UdpSession::updatePacingRate(int64_t now) {
+  double rate = congestion_controller_->pacing_rate();
+  if (rate <= 0 && rtt_estimator_.has_sample()) {
+    double gain = congestion_controller_->in_slow_start()
+                      ? PACING_GAIN_SLOW_START
+                      : PACING_GAIN_CONG_AVD;
+    rate = gain * congestion_controller_->cwnd() * MAX_PACKET_SIZE * 1e6 /
+           rtt_estimator_.srtt();
+  }
+  pacer_.SetRate(rate, now);
+}
+
+/**
+ * 按令牌补充到一个发送量子所需的时间启动发送定时器；
+ * 已经启动时不重复设置
+ */
+void UdpSession::armPacingTimer() {
+  if (pacing_timer_armed_) {
+    return;
+  }
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  int64_t delay_us = std::max<int64_t>(1, pacer_.DelayUntilNextSend());
+  its.it_value.tv_sec = delay_us / 1000000;
+  its.it_value.tv_nsec = (delay_us % 1000000) * 1000;
+  if (timerfd_settime(pacing_timer_fd_, 0, &its, NULL) < 0) {
+    LOG(ERROR) << "Failed to arm pacing timerfd !!!";
+    return;
+  }
+  pacing_timer_armed_ = true;
+}
+
+/**
+ * 处理来自客户端的 ACK，更新确认状态和 SACK 记分板；
+ * 快速重传的数据段先进入发送队列。
+ */
+void UdpSession::OnAck(unsigned char *buffer, int length,
+                       const struct sockaddr_in &address) {
+  /**
+   * 会话绑定握手时的客户端地址，不做地址迁移：连接 ID 以明文传输、
+   * CRC32C 不是认证，看到一个数据段的人就能伪造 ACK 把传输引向别处
+   */
+  if (address.sin_addr.s_addr != cli_address_.sin_addr.s_addr ||
+      address.sin_port != cli_address_.sin_port) {
+    return;
+  }
+
+  DataSegment ack_segment;
+  if (!ack_segment.DeserializeToDataSegment(buffer, length)) {
+    /** 损坏的 ACK 当作丢失，后续的累积 ACK 和 SACK 会补上它携带的信息 */
+    packet_statistics_->corruptAckStatistics++;
+    return;
+  }
+  if (!ack_segment.ackFlag || ack_segment.synFlag) {
+    return;
+  }
+
+  /**
+   * 握手阶段的 ACK 确认了 SessionAccept：回显的时间戳给出第一个 RTT 样本，
+   * 第一个窗口就可以按 RTT 设置发送速率
+   */
+  if (!is_established_) {
+    is_established_ = true;
+    timeout_count_ = 0;
+    int64_t now_ns = nowNanos();
+    int64_t rtt_ns = now_ns - ack_segment.timestamp;
+    if (ack_segment.timestamp != 0 && rtt_ns > 0) {
+      rtt_estimator_.OnSample(rtt_ns, 1);
+      congestion_controller_->OnRttSample(rtt_ns / 1000, now_ns / 1000);
+    }
+    LOG(INFO) << "Session " << accept_.connectionId
+              << " established, handshake RTT: " << rtt_estimator_.srtt()
+              << " us";
+    StartFileTransfer();
+    return;
+  }
+
+  if (sliding_window_->lastSendPacketSeq == -1) {
+    return;
+  }
+  timeout_count_ = 0;
+  if (congestion_controller_->in_slow_start()) {
+    packet_statistics_->slowStartPacketRxStatistics++;
+  } else {
+    packet_statistics_->congAvdPacketRxStatistics++;
+  }
+
+  /**
+   * ACK 回显了触发它的数据段的发送时间，重传的数据段带的是重传时的时间，
+   * 不存在 Karn 规则的歧义，重复 ACK 同样是有效样本
+   */
+  if (ack_segment.timestamp != 0) {
+    int64_t now_ns = nowNanos();
+    int64_t rtt_ns = now_ns - ack_segment.timestamp;
+    if (rtt_ns > 0) {
+      int inflight = sliding_window_->lastSendPacketSeq -
+                     sliding_window_->lastAckedPacketSeq;
+      rtt_estimator_.OnSample(rtt_ns, (inflight + 1) / 2);
+      congestion_controller_->OnRttSample(rtt_ns / 1000, now_ns / 1000);
+    }
+  }
+
+  /**
+   * 如果收到的是当前发送窗口基地址的 ACK，则视为重复 ACK（DUP ACK）
+   */
+  if (ack_segment.ackNum == sliding_window_->sendBaseSeq) {
+    LOG(INFO) << "DUP ACK Received: ack_number: " << ack_segment.ackNum;
+    sliding_window_->dupAckNum++;
+
+    /**
+     * 如果连续收到 3 次重复 ACK，则触发快速重传（开启 FEC 时推迟到
+     * 空洞所在分组的校验段有机会到达之后）；
+     * 同一轮恢复中已经重传过的空洞不再重复发送
+     */
+    int first_hole = sliding_window_->lastAckedPacketSeq + 1;
+    if (sliding_window_->dupAckNum >= 3 && first_hole <= lossDetectionLimit()) {
+      if (sliding_window_->highRetransmitSeq < first_hole) {
+        LOG(INFO) << "Fast Retransmit seq_number: " << ack_segment.ackNum;
+        retransmitSegment(ack_segment.ackNum - initial_seq_number_);
+        sliding_window_->highRetransmitSeq = first_hole;
+      }
+      sliding_window_->dupAckNum = 0;
+      onLossDetected();
+    }
+  } else if (ack_segment.ackNum > sliding_window_->sendBaseSeq) {
+    sliding_window_->dupAckNum = 0;
+    sliding_window_->sendBaseSeq = ack_segment.ackNum;
+
+    /**
+     * 更新已确认的数据包信息：数据段整体落在 ACK 号之前才算被确认，
+     * 每个数据段只被检查一次
+     */
+    int newly_acked = -1;
+    int acked_segments = 0;
+    while (sliding_window_->lastAckedPacketSeq <
+           sliding_window_->lastSendPacketSeq) {
+      SlidWinBuffer &next =
+          sliding_window_->At(sliding_window_->lastAckedPacketSeq + 1);
+      if (next.currSeqNum + next.dataLength > ack_segment.ackNum) {
+        break;
+      }
+      newly_acked = ++sliding_window_->lastAckedPacketSeq;
+      acked_segments++;
+      rto_timers_->Cancel(sliding_window_->SlotOf(newly_acked));
+    }
+
+    if (newly_acked != -1) {
+      int64_t now = nowMicros();
+
+      /** 恢复点之前的数据全部被确认，本轮丢包恢复结束 */
+      if (is_fast_recovery_ && newly_acked >= recovery_point_) {
+        is_fast_recovery_ = false;
+      }
+
+      AckSample sample;
+      sample.acked_segments = acked_segments;
+      sample.inflight = sliding_window_->lastSendPacketSeq -
+                        sliding_window_->lastAckedPacketSeq;
+      sample.in_recovery = is_fast_recovery_;
+      sample.now_us = now;
+      congestion_controller_->OnAck(sample);
+    }
+  }
+
+  /** 载荷中的 SACK 块更新记分板 */
+  int sack_count = ack_segment.dataLength / SACK_BLOCK_LENGTH;
+  for (int i = 0; i < sack_count && i < MAX_SACK_BLOCKS; i++) {
+    SackBlock block =
+        SackBlock::Parse(ack_segment.data_ + i * SACK_BLOCK_LENGTH);
+    sliding_window_->MarkSacked(block.start, block.end);
+  }
+}
+
+/**
+ * 一批 ACK 处理完后重传丢失的空洞，按拥塞控制器给出的窗口发送新数据，
+ * 并按新的最近期限设置重传定时器。
+ */
+void UdpSession::OnAckBatchEnd() {
+  if (is_finished_ || sliding_window_->lastSendPacketSeq == -1) {
+    return;
+  }
+
+  /** 所有数据都已发出并被确认，传输结束 */
+  if (is_all_sent_ && sliding_window_->lastAckedPacketSeq ==
+                          sliding_window_->lastSendPacketSeq) {
+    finish();
+    return;
+  }
+
+  /** 重传 SACK 判定丢失的空洞，与本批 ACK 触发的快速重传和新数据一起发出 */
+  retransmitLostSegments();
+  sendWindow();
+  armTimer();
+}
+
+/**
+ * 检测到丢包：一个恢复周期内只通知拥塞控制器一次，
+ * 恢复点为检测时已发送的最大数据段
+ */
+void UdpSession::onLossDetected() {
+  if (is_fast_recovery_) {
+    return;
+  }
+  is_fast_recovery_ = true;
+  recovery_point_ = sliding_window_->lastSendPacketSeq;
+  congestion_controller_->OnLoss(nowMicros());
+}
+
+/**
+ * 重传定时器到期：推进时间轮，只有期限已过且仍未被确认或 SACK 的数据段
+ * 才算超时，期限未到的数据段不会因为一个迟到的数据段被整窗重传。
+ * 每次超时事件 RTO 退避一次（RFC 6298 5.5），拥塞控制器收缩窗口，
+ * 其余在途数据段按退避后的 RTO 重新计时（RFC 6298 5.6）。
+ */
+void UdpSession::OnTimeout() {
+  uint64_t expirations;
+  if (read(timer_fd_, &expirations, sizeof(expirations)) < 0) {
+    return;
+  }
+  timer_deadline_ = -1;
+  if (is_finished_) {
+    return;
+  }
+
+  /** 握手阶段：SessionAccept 或客户端的确认丢失，退避后重发 */
+  if (!is_established_) {
+    if (++timeout_count_ > MAX_ACCEPT_RETRIES) {
+      LOG(ERROR) << "Session " << accept_.connectionId
+                 << " handshake not confirmed, closing the session";
+      is_finished_ = true;
+      return;
+    }
+    rtt_estimator_.Backoff();
+    SendAccept();
+    return;
+  }
+
+  int64_t now = nowMicros();
+  expired_timers_.clear();
+  rto_timers_->Advance(now, &expired_timers_);
+
+  /** 到期且仍未被确认或 SACK 的数据段中最早的一个 */
+  int expired = -1;
+  for (int slot : expired_timers_) {
+    int index = sliding_window_->IndexOfSlot(slot);
+    if (index <= sliding_window_->lastSendPacketSeq &&
+        !sliding_window_->At(index).sacked &&
+        (expired == -1 || index < expired)) {
+      expired = index;
+    }
+  }
+
+  if (expired != -1) {
+    LOG(INFO) << "Timeout occurred RTO: " << rtt_estimator_.rto();
+    if (++timeout_count_ > MAX_TIMEOUT_COUNT) {
+      LOG(ERROR) << "Client not responding, closing the session";
+      finish();
+      return;
+    }
+    packet_statistics_->timeoutStatistics++;
+    rtt_estimator_.Backoff();
+
+    /** 拥塞控制：由控制器收缩窗口，超时结束当前的快速恢复 */
+    congestion_controller_->OnTimeout(now);
+    is_fast_recovery_ = false;
+
+    /**
+     * 同一批发出的数据段往往在同一个刻度到期，只重传其中最早的一个
+     * （RFC 6298 5.4），其余的由恢复后的 SACK 判定或各自的下一次期限处理。
+     * 超时后重新开始一轮恢复，之前重传过的空洞可以再次被 SACK 判定丢失并重传
+     */
+    SlidWinBuffer &buffer = sliding_window_->At(expired);
+    LOG(INFO) << "Timeout Retransmit seq number " << buffer.currSeqNum;
+    retransmitSegment(buffer.currSeqNum - initial_seq_number_);
+    sliding_window_->highRetransmitSeq = expired;
+
+    for (int i = sliding_window_->lastAckedPacketSeq + 1;
+         i <= sliding_window_->lastSendPacketSeq; i++) {
+      if (!sliding_window_->At(i).sacked) {
+        scheduleRetransmit(i, now);
+      }
+    }
+  }
+
+  sendWindow();
+  armTimer();
+}
+
+/**
+ * 发送定时器到期：继续发送被令牌限制的数据
+ */
+void UdpSession::OnPacingTimer() {
+  uint64_t expirations;
+  if (read(pacing_timer_fd_, &expirations, sizeof(expirations)) < 0) {
+    return;
+  }
+  pacing_timer_armed_ = false;
+  if (is_finished_) {
+    return;
+  }
+  sendWindow();
+  /** 上次重传定时器到期时时间轮可能为空，新发出的数据段需要重新启动 timerfd */
+  armTimer();
+}
+
+/**
+ * 发送单个数据包，处理滑动窗口中的缓冲区更新，并准备发送数据。
+ *
+ * @param seq_number 数据包的序列号
+ * @param start_byte 当前数据块在文件中的起始字节位置
+ * @return 该数据包是否是文件的最后一个数据包
+ */
+bool UdpSession::sendpacket(int seq_number, int start_byte) {
+  bool lastPacket = false;
+  int dataLength = 0;
+
+  /** 压缩流在发送推进到时才生成，多生成一个字节才能判断是否是最后一个数据包 */
+  if (compressed_stream_) {
+    compressed_stream_->EnsureAvailable(start_byte + MAX_DATA_SIZE + 1);
+    file_length_ = compressed_stream_->size();
+  }
+
+  /** 判断当前要发送的数据块是否是最后一个数据包 */
+  if (file_length_ <= start_byte + MAX_DATA_SIZE) {
+    LOG(INFO) << "Last packet to be sent !!!";
+    dataLength = file_length_ - start_byte;
+    lastPacket = true;
+  } else {
+    dataLength = MAX_DATA_SIZE;
+  }
+
+  int64_t time_ns = nowNanos();
+  int64_t time = time_ns / 1000;
+
+  /** 如果当前要发送的是之前已经发过的包（重传），则重新设置它的重传期限 */
+  if (sliding_window_->IndexOf(seq_number) <=
+      sliding_window_->lastSendPacketSeq) {
+    if (sliding_window_->Find(seq_number) != nullptr) {
+      scheduleRetransmit(sliding_window_->IndexOf(seq_number), time);
+    }
+    readFileAndSend(lastPacket, start_byte, start_byte + dataLength, time_ns);
+  } else {
+    /** 否则将新数据包信息加入滑动窗口缓冲区，并设置它的重传期限 */
+    int index = sliding_window_->AddToBuffer(seq_number, dataLength);
+    sliding_window_->lastSendPacketSeq = index;
+    scheduleRetransmit(index, time);
+    readFileAndSend(lastPacket, start_byte, start_byte + dataLength, time_ns);
+
+    /** 分组的最后一个数据段发出后紧跟着发送该分组的校验段 */
+    if (fec_block_ > 0 && ((index + 1) % fec_block_ == 0 || lastPacket)) {
+      sendParity(index, lastPacket);
+    }
+  }
+  return lastPacket;
+}
+
+/**
+ * 重新传输指定起始字节位置的数据段。
+ *
+ * @param index_number 要重传的数据段的起始字节位置
+ */
+void UdpSession::retransmitSegment(int index_number) {
+  SlidWinBuffer *buffer =
+      sliding_window_->Find(index_number + initial_seq_number_);
+  packet_statistics_->retransStatistics++;
+  packet_statistics_->retransBytesStatistics +=
+      buffer != nullptr ? buffer->dataLength
+                        : std::min(MAX_DATA_SIZE, file_length_ - index_number);
+  int64_t now_ns = nowNanos();
+  if (buffer != nullptr) {
+    if (buffer->retransmitCount < UINT8_MAX) {
+      buffer->retransmitCount++;
+    }
+    scheduleRetransmit(sliding_window_->IndexOf(buffer->currSeqNum),
+                       now_ns / 1000);
+  }
+
+  readFileAndSend(false, index_number, index_number + MAX_DATA_SIZE, now_ns);
+}
+
+/**
+ * 重传被 SACK 判定为丢失的空洞：在 highRetransmitSeq 之后、
+ * 距离最高 SACK 下标至少 DUP_THRESH 个数据段且没有被 SACK 的数据段。
+ * highRetransmitSeq 只前进，同一轮恢复中每个空洞最多重传一次。
+ */
+void UdpSession::retransmitLostSegments() {
+  int first = std::max(sliding_window_->highRetransmitSeq,
+                       sliding_window_->lastAckedPacketSeq) +
+              1;
+  int last = std::min(sliding_window_->highestSackedPacketSeq - DUP_THRESH,
+                      lossDetectionLimit());
+  for (int i = first; i <= last; i++) {
+    SlidWinBuffer &buffer = sliding_window_->At(i);
+    if (!buffer.sacked) {
+      LOG(INFO) << "SACK Retransmit seq number " << buffer.currSeqNum;
+      retransmitSegment(buffer.currSeqNum - initial_seq_number_);
+      onLossDetected();
+    }
+  }
+  if (last >= first) {
+    sliding_window_->highRetransmitSeq = last;
+  }
+}
+
+int UdpSession::lossDetectionLimit() const {
+  if (fec_block_ == 0) {
+    return sliding_window_->lastSendPacketSeq;
+  }
+  int limit = sliding_window_->highestSackedPacketSeq - DUP_THRESH;
+  if (limit < 0) {
+    return limit;
+  }
+  /**
+   * 只推迟校验段已经发出的分组。分组还没有发完时（窗口太小，
+   * 或者是不满的最后一个分组）等待只会拖到超时，按普通规则判定
+   */
+  int block_start = limit - limit % fec_block_;
+  int block_end = block_start + fec_block_ - 1;
+  if (block_end > limit && block_end <= sliding_window_->lastSendPacketSeq) {
+    return block_start - 1;
+  }
+  return limit;
+}
+
+int UdpSession::fecParityCount() const {
+  int sent = packet_statistics_->slowStartPacketTxStatistics +
+             packet_statistics_->congAvdPacketTxStatistics;
+  double loss =
+      sent > 0 ? (double)packet_statistics_->retransStatistics / sent : 0;
+  int parity = 1 + (int)std::ceil(FEC_LOSS_GAIN * loss * fec_block_);
+  return std::min(parity, std::min(MAX_FEC_PARITY, fec_block_));
+}
+
+/**
+ * 发送一个分组的校验段。数据段直接取自文件映射区，
+ * 每个校验段编码到同一个缓冲区，Append 时连同头部一起拷贝进发送队列。
+ * 校验段不进入滑动窗口，不占用拥塞窗口，也不会被重传，但消耗发送令牌。
+ */
+void UdpSession::sendParity(int last_index, bool fin) {
+  int first_index = last_index - last_index % fec_block_;
+  FecInfo info;
+  info.count = last_index - first_index + 1;
+  info.fin = fin;
+  info.last_length =
+      std::min(MAX_DATA_SIZE, file_length_ - last_index * MAX_DATA_SIZE);
+  info.parity = fecParityCount();
+  int length = info.count > 1 ? MAX_DATA_SIZE : info.last_length;
+  if (length <= 0) {
+    return;
+  }
+
+  const char *data[MAX_FEC_BLOCK];
+  int lengths[MAX_FEC_BLOCK];
+  for (int i = 0; i < info.count; i++) {
+    data[i] = streamData((first_index + i) * MAX_DATA_SIZE);
+    lengths[i] = i == info.count - 1 ? info.last_length : MAX_DATA_SIZE;
+  }
+
+  DataSegment parity_segment;
+  parity_segment.connectionId = accept_.connectionId;
+  parity_segment.seqNumber = first_index * MAX_DATA_SIZE + initial_seq_number_;
+  parity_segment.ackFlag = false;
+  parity_segment.finflag = false;
+  parity_segment.dataLength = length;
+  parity_segment.timestamp = nowNanos();
+  parity_segment.data_ = fec_packet_.data() + HEADER_LENGTH;
+  for (int j = 0; j < info.parity; j++) {
+    info.index = j;
+    parity_segment.ackNum = info.Pack();
+    FecCodec::Encode(j, data, lengths, info.count,
+                     fec_packet_.data() + HEADER_LENGTH, length);
+    parity_segment.SerializeHeader(fec_packet_.data());
+    send_batch_->Append(fec_packet_.data(), HEADER_LENGTH + length);
+    pacer_.OnSent(HEADER_LENGTH + length);
+    packet_statistics_->fecParityStatistics++;
+  }
+}
+
+/**
+ * 从文件映射区取出指定范围的数据并发送到客户端。
+ * 载荷直接指向映射区，重传时同样只是指针运算，不做 seek/read 和内存拷贝。
+ *
+ * @param fin_flag 是否是最后一个数据包
+ * @param start_byte 数据块在文件中的起始字节位置
+ * @param end_byte 数据块在文件中的结束字节位置
+ * @param timestamp 发送时间（单调时钟纳秒），由客户端在 ACK 中回显
+ */
+void UdpSession::readFileAndSend(bool fin_flag, int start_byte, int end_byte,
+                                 int64_t timestamp) {
+  int datalength = end_byte - start_byte;
+
+  /**
+   * 到达字节流末尾的数据段带 FIN，由这里统一判断：长度恰好是 MAX_DATA_SIZE
+   * 整数倍时最后一个数据段是满的，重传时也必须带上 FIN
+   */
+  if (file_length_ - start_byte <= datalength) {
+    datalength = file_length_ - start_byte;
+    fin_flag = true;
+  }
+
+  if (!file_source_.is_open() && !bundle_) {
+    LOG(ERROR) << "File open failed !!!";
+    return;
+  }
+
+  DataSegment data_segment;
+  data_segment.connectionId = accept_.connectionId;
+  data_segment.seqNumber = start_byte + initial_seq_number_;
+  /** 压缩流的数据段在 ackNum 中携带所属分组的信息，客户端据此判断分组是否收齐 */
+  data_segment.ackNum =
+      compressed_stream_ ? compressed_stream_->SegmentInfo(start_byte /
+                                                           MAX_DATA_SIZE)
+                         : 0;
+  data_segment.ackFlag = false;
+  data_segment.finflag = fin_flag;
+  data_segment.dataLength = datalength;
+  data_segment.timestamp = timestamp;
+  data_segment.data_ = streamData(start_byte);
+
+  /** 文件数据的载荷校验和来自块缓存，压缩流的每次现算 */
+  uint32_t payload_crc;
+  if (compressed_stream_) {
+    payload_crc = Crc32c::Value(data_segment.data_, datalength);
+  } else if (bundle_) {
+    payload_crc = bundle_->PayloadCrc(start_byte, datalength);
+  } else {
+    payload_crc = file_source_.PayloadCrc(range_offset_ + start_byte, datalength);
+  }
+  sendDataSegment(&data_segment, payload_crc);
+  LOG(INFO) << "Packet sent:seq number: " << data_segment.seqNumber;
+}
+
+const char *UdpSession::streamData(int offset) {
+  if (compressed_stream_) {
+    return compressed_stream_->Data(offset);
+  }
+  return bundle_ ? bundle_->Data(offset)
+                 : file_source_.Data(range_offset_ + offset);
+}
+
+/**
+ * 发送数据段到客户端：头部序列化到栈上，载荷以 iovec 形式挂接。
+ * 载荷的校验和已知，每次发送只计算头部，再合并得到整个数据报的校验和。
+ *
+ * @param data_segment 要发送的数据段对象
+ * @param payload_crc 载荷的 CRC32C
+ */
+void UdpSession::sendDataSegment(DataSegment *data_segment,
+                                 uint32_t payload_crc) {
+  char header[HEADER_LENGTH];
+  data_segment->SerializeHeader(header, payload_crc);
+
+  /** 数据报先进入发送队列，由 sendWindow 或 OnAckBatchEnd 批量发出 */
+  send_batch_->Append(header, HEADER_LENGTH, data_segment->data_,
+                      data_segment->dataLength);
+  /** 重传同样消耗令牌，保证总的发送速率不超过设定值 */
+  pacer_.OnSent(HEADER_LENGTH + data_segment->dataLength);
+}
+
+/**
+ * 结束会话：停止定时器并输出本次传输的统计信息
+ */
+void UdpSession::finish() {
+  is_finished_ = true;
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  timerfd_settime(timer_fd_, 0, &its, NULL);
+  if (pacing_timer_fd_ >= 0) {
+    timerfd_settime(pacing_timer_fd_, 0, &its, NULL);
+  }
+
+  struct timeval process_end_time;
+  gettimeofday(&process_end_time, NULL);
+  int64_t total_time =
+      (process_end_time.tv_sec * 1000000 + process_end_time.tv_usec) -
+      (process_start_time_.tv_sec * 1000000 + process_start_time_.tv_usec);
+
+  int total_packet_sent = packet_statistics_->slowStartPacketTxStatistics +
+                          packet_statistics_->congAvdPacketTxStatistics;
+  LOG(INFO) << "\n";
+  LOG(INFO) << "========================================";
+  LOG(INFO) << "Total Time: " << (float)total_time / pow(10, 6) << " secs";
+  /** 吞吐量按文件数据计算，压缩时为压缩前的字节数，多文件时不含清单和填充 */
+  int64_t payload_bytes = compressed_stream_ ? compressed_stream_->raw_length()
+                          : bundle_          ? bundle_->raw_length()
+                                             : file_length_;
+  LOG(INFO) << "Throughput: "
+            << (total_time > 0 ? payload_bytes / (double)total_time : 0)
+            << " MB/s (GSO " << (send_batch_->gso_enabled() ? "on" : "off")
+            << ")";
+  LOG(INFO) << "Statistics: 拥塞控制--慢启动: "
+            << packet_statistics_->slowStartPacketTxStatistics
+            << " 拥塞控制--拥塞避免: "
+            << packet_statistics_->congAvdPacketTxStatistics;
+  LOG(INFO) << "Statistics: Slow start: "
+            << ((float)packet_statistics_->slowStartPacketTxStatistics /
+                total_packet_sent) *
+                   100
+            << "% CongAvd: "
+            << ((float)packet_statistics_->congAvdPacketTxStatistics /
+                total_packet_sent) *
+                   100
+            << "%";
+  LOG(INFO) << "Statistics: Congestion control: "
+            << congestion_controller_->name()
+            << " final cwnd: " << congestion_controller_->cwnd();
+  LOG(INFO) << "Statistics: Pacing: "
+            << (pacing_timer_fd_ >= 0 ? "on" : "off")
+            << " final rate: " << pacer_.rate() / (1024 * 1024) << " MB/s";
+  LOG(INFO) << "Statistics: Retransmissions: "
+            << packet_statistics_->retransStatistics << " bytes: "
+            << packet_statistics_->retransBytesStatistics
+            << " timeouts: " << packet_statistics_->timeoutStatistics;
+  LOG(INFO) << "Statistics: FEC block: " << fec_block_ << " parity segments: "
+            << packet_statistics_->fecParityStatistics << " kernel: "
+            << Gf256::KernelName();
+  if (compressed_stream_) {
+    LOG(INFO) << "Statistics: Compression: "
+              << BlockCodec::Name(compressed_stream_->method())
+              << " raw bytes: " << payload_bytes
+              << " stream bytes: " << file_length_ << " ratio: "
+              << (double)payload_bytes / std::max(file_length_, 1);
+  }
+  if (bundle_) {
+    LOG(INFO) << "Statistics: Bundle: files: " << bundle_->file_count()
+              << " file bytes: " << payload_bytes
+              << " stream bytes: " << file_length_;
+  }
+  if (chunk_cache_ != nullptr) {
+    ChunkCacheStats cache = chunk_cache_->stats();
+    int64_t lookups = std::max<int64_t>(cache.hits + cache.misses, 1);
+    LOG(INFO) << "Statistics: Chunk cache: hits: " << cache.hits
+              << " misses: " << cache.misses
+              << " hit rate: " << 100.0 * cache.hits / lookups
+              << "% disk reads: " << cache.diskReads
+              << " disk MB: " << cache.diskBytes / (1024.0 * 1024.0)
+              << " evictions: " << cache.evictions
+              << " resident MB: " << cache.residentBytes / (1024.0 * 1024.0);
+  }
+  LOG(INFO) << "Statistics: Packet cache: payload checksum hits: "
+            << (bundle_ ? bundle_->crc_hits() : file_source_.crc_hits())
+            << " computed: "
+            << (bundle_ ? bundle_->crc_misses() : file_source_.crc_misses());
+  LOG(INFO) << "Statistics: SRTT: " << rtt_estimator_.srtt()
+            << " us RTTVAR: " << rtt_estimator_.rttvar()
+            << " us RTO: " << rtt_estimator_.rto() << " us";
+  double megabytes = std::max(file_length_, 1) / (1024.0 * 1024.0);
+  LOG(INFO) << "Statistics: Send syscalls: " << send_batch_->syscall_count()
+            << " datagrams: " << send_batch_->datagram_count()
+            << " syscalls/MB: " << send_batch_->syscall_count() / megabytes;
+  int total_ack_received = packet_statistics_->slowStartPacketRxStatistics +
+                           packet_statistics_->congAvdPacketRxStatistics;
+  double seconds = std::max<int64_t>(total_time, 1) / 1e6;
+  LOG(INFO) << "Statistics: ACKs received: " << total_ack_received
+            << " datagrams/s: " << send_batch_->datagram_count() / seconds
+            << " ACKs/s: " << total_ack_received / seconds
+            << " corrupt: " << packet_statistics_->corruptAckStatistics
+            << " crc32c: " << Crc32c::KernelName();
+  LOG(INFO) << "========================================";
+}
+}  // namespace safe_udp
@@ -0,0 +1,313 @@
+#pragma once
+#include <netinet/in.h>  // 定义 sockaddr_in 结构体等网络相关数据结构
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <memory>   // 智能指针支持，如 unique_ptr
+#include <string>   // 使用 std::string 存储字符串数据
+#include <vector>
+
+#include "compressed_stream.h"      // 按分组压缩的发送字节流
+#include "congestion_controller.h"  // 可插拔的拥塞控制算法
+#include "data_segment.h"       // 数据分段类定义
+#include "datagram_batch.h"     // 批量发送数据报
+#include "fec_codec.h"          // 前向纠错校验段编码
+#include "file_bundle.h"        // 多文件传输的字节流
+#include "file_source.h"        // 内存映射的文件数据源
+#include "pacer.h"              // 发送速率控制
+#include "packet_statistics.h"  // 统计发送/接收的数据包信息
+#include "rtt_estimator.h"      // RFC 6298 RTT 估计与重传超时
+#include "session_accept.h"     // 握手回复
+#include "sliding_window.h"     // 滑动窗口机制实现
+#include "timer_wheel.h"        // 逐数据段的重传定时器
+
+namespace safe_udp {
+
+/**
+ * 会话配置，由 UdpServer 在创建会话时传入
+ */
+struct SessionConfig {
+  int rwnd = 0;                     // 接收窗口大小（Receiver Window）
+  int batch_size = MAX_BATCH_SIZE;  // 单次 sendmmsg 最多发送的数据报数量
+  bool gso = false;                 // 是否使用 UDP GSO 合并发送
+  bool pacing = false;              // 是否按速率平滑发送，而不是整窗突发
+  int fec_block = 0;                // FEC 分组大小（数据段个数），0 表示不发送校验段
+  ChunkCache *chunk_cache = nullptr;  // 服务器共享的文件块缓存，nullptr 表示直接映射文件
+  CongestionAlgorithm congestion_control =
+      CongestionAlgorithm::NEW_RENO;  // 拥塞控制算法
+};
+
+/**
+ * UdpSession 类
+ * 表示服务器上一个客户端的一次文件传输会话，由握手时分配的连接 ID 标识。
+ * 会话保存该客户端独有的全部状态（地址、文件、拥塞窗口、滑动窗口、RTT 等），
+ * 每个在途数据段在时间轮上有自己的重传期限，timerfd 只按最近的期限唤醒。
+ * 会话创建后先发送 SessionAccept，收到客户端的确认 ACK 后才开始传输，
+ * 在此之前定时器用于重发 SessionAccept。
+ * 由 UdpServer 的 epoll 事件循环驱动：收到 ACK 时调用 OnAck，
+ * 重传定时器（timerfd）到期时调用 OnTimeout，开启 pacing 时
+ * 发送定时器到期调用 OnPacingTimer。
+ */
+class UdpSession {
+ public:
+  /**
+   * 构造函数
+   * @param sockfd 服务器共享的 socket 描述符
+   * @param cli_address 客户端地址
+   * @param config 会话配置
+   * @param accept 握手协商的结果：连接 ID、初始序列号、窗口和功能
+   */
+  UdpSession(int sockfd, const struct sockaddr_in &cli_address,
+             const SessionConfig &config, const SessionAccept &accept);
+
+  /**
+   * 析构函数
+   * 关闭定时器描述符
+   */
+  ~UdpSession();
+
+  /**
+   * 打开指定文件，并选定要发送的字节范围。
+   * 范围超出文件时截断到文件末尾，序列号相对于范围起点编号。
+   * 请求压缩时发送的是范围内数据的压缩流，序列号按压缩流编号。
+   * @param file_name 要打开的文件名
+   * @param offset 范围起点（字节）
+   * @param length 范围长度，-1 表示到文件末尾
+   * @param compression 客户端请求的压缩方法
+   * @return 成功打开返回 true，否则 false
+   */
+  bool OpenFile(const std::string &file_name, int offset = 0, int length = -1,
+                Compression compression = Compression::NONE);
+
+  /**
+   * 打开一组文件，作为一个字节流连续发送（布局见 FileBundle）
+   * @param directory 服务器文件目录
+   * @param names 以换行分隔的文件名或 glob 模式
+   * @return 所有文件都成功打开返回 true，否则 false
+   */
+  bool OpenBundle(const std::string &directory, const std::string &names);
+
+  /**
+   * 发送（或重发）SessionAccept，并按当前 RTO 启动重发定时器
+   */
+  void SendAccept();
+
+  /**
+   * 开始文件传输流程：发送第一个窗口并启动重传定时器
+   */
+  void StartFileTransfer();
+
+  /**
+   * 向客户端发送错误信息
+   */
+  void SendError();
+
+  /**
+   * 回复文件大小查询（"SIZE <n>"），并结束会话
+   */
+  void SendFileSize();
+
+  /**
+   * 处理一个来自该客户端的 ACK 数据报，只更新确认状态，
+   * 拥塞窗口在 OnAckBatchEnd 中统一评估。握手阶段的第一个 ACK 完成握手并开始传输。
+   * 连接 ID 明文出现在每个数据段中，不能证明来源，来自其他地址的 ACK 一律丢弃
+   * @param buffer 数据报内容
+   * @param length 数据报长度
+   * @param address 数据报的来源地址
+   */
+  void OnAck(unsigned char *buffer, int length,
+             const struct sockaddr_in &address);
+
+  /**
+   * 一批 ACK 全部处理完后调用：评估拥塞窗口，发送下一轮数据并批量发出
+   */
+  void OnAckBatchEnd();
+
+  /**
+   * 重传定时器到期时的处理：只重传期限已过的数据段
+   */
+  void OnTimeout();
+
+  /**
+   * 发送定时器到期：令牌已经补充，继续发送窗口内的新数据
+   */
+  void OnPacingTimer();
+
+  /**
+   * 会话是否已经结束（全部数据被确认，或客户端长时间无响应）
+   */
+  bool IsFinished() const { return is_finished_; }
+
+  /** 握手是否已经完成 */
+  bool IsEstablished() const { return is_established_; }
+
+  /** 连接 ID */
+  uint32_t connection_id() const { return accept_.connectionId; }
+
+  /** 请求中的客户端令牌 */
+  uint32_t client_token() const { return accept_.clientToken; }
+
+  /**
+   * 返回该会话的重传定时器描述符，用于注册到 epoll
+   */
+  int timer_fd() const { return timer_fd_; }
+
+  /**
+   * 返回该会话的发送定时器描述符，未开启 pacing 时为 -1
+   */
+  int pacing_timer_fd() const { return pacing_timer_fd_; }
+
+  /** 返回客户端地址 */
+  const struct sockaddr_in &cli_address() const { return cli_address_; }
+
+  /**
+   * 流量控制与丢包恢复相关变量，拥塞窗口由 congestion_controller_ 维护
+   */
+  int rwnd_;               // 接收窗口大小（Receiver Window）
+  int start_byte_;         // 当前传输起始字节位置
+  bool is_fast_recovery_;  // 是否处于丢包恢复阶段
+
+ private:
+  /**
+   * 组件对象
+   */
+  std::unique_ptr<SlidingWindow> sliding_window_;        // 滑动窗口管理器
+  std::unique_ptr<PacketStatistics> packet_statistics_;  // 数据包统计工具
+  std::unique_ptr<SendBatch> send_batch_;                // 批量发送队列
+  std::unique_ptr<CongestionController> congestion_controller_;  // 拥塞控制
+  std::unique_ptr<TimerWheel> rto_timers_;  // 在途数据段的重传期限，按槽位索引
+
+  /**
+   * 私有成员变量
+   */
+  int sockfd_;                      // 服务器 socket 描述符（与其他会话共享）
+  int timer_fd_;                    // 重传定时器描述符（timerfd）
+  int64_t timer_deadline_;          // timerfd 当前的到期时间，-1 表示未启动
+  std::vector<int> expired_timers_; // 本次到期的定时器槽位
+  int pacing_timer_fd_;             // 发送定时器描述符，未开启 pacing 时为 -1
+  bool pacing_timer_armed_;         // 发送定时器是否已经启动
+  Pacer pacer_;                     // 发送速率控制
+  FileSource file_source_;          // 内存映射的待发送文件
+  std::unique_ptr<CompressedStream> compressed_stream_;  // 压缩流，未压缩时为空
+  std::unique_ptr<FileBundle> bundle_;  // 多文件传输的字节流，单文件传输时为空
+  struct sockaddr_in cli_address_;  // 客户端地址结构体
+  SessionAccept accept_;            // 握手协商的结果，重发 SessionAccept 时使用
+  bool is_established_;             // 是否已经收到客户端对 SessionAccept 的确认
+  int initial_seq_number_;          // 初始序列号，由服务器随机选择
+  int range_offset_;                // 发送范围在文件中的起点（字节）
+  int file_length_;                 // 发送范围的长度（字节数），压缩时为已生成的压缩流长度
+  RttEstimator rtt_estimator_;      // RTT 估计与重传超时
+  int timeout_count_;               // 连续超时次数，用于清理失联的客户端
+  bool is_all_sent_;                // 最后一个数据包（FIN）是否已经发出
+  bool is_finished_;                // 会话是否结束
+  int recovery_point_;              // 进入恢复时已发送的最大数据段下标
+  int fec_block_;                   // FEC 分组大小，0 表示关闭
+  ChunkCache *chunk_cache_;         // 文件块缓存，nullptr 表示直接映射文件
+  std::vector<char> fec_packet_;    // 校验段数据报的编码缓冲区
+  struct timeval process_start_time_;  // 传输开始时间
+
+  /**
+   * 在拥塞窗口和接收窗口允许的范围内发送新数据
+   */
+  void sendWindow();
+
+  /**
+   * 按时间轮上最近的期限启动 timerfd，已经更早启动时不重复设置
+   */
+  void armTimer();
+
+  /**
+   * 以绝对时间启动 timerfd
+   * @param deadline 到期时间（微秒）
+   */
+  void armTimerAt(int64_t deadline);
+
+  /**
+   * 为刚发出的数据段设置重传期限：当前时间加上当前 RTO
+   * @param index 数据段下标
+   * @param now 发送时间（微秒）
+   */
+  void scheduleRetransmit(int index, int64_t now);
+
+  /**
+   * 根据拥塞控制器的速率或 cwnd / SRTT 更新发送速率
+   * @param now 当前时间（微秒）
+   */
+  void updatePacingRate(int64_t now);
+
+  /**
+   * 令牌不足时启动发送定时器，等令牌补充后继续发送
+   */
+  void armPacingTimer();
+
+  /**
+   * 发送指定序号和起始字节的数据包
+   * @param seq_number 序列号
+   * @param start_byte 起始字节位置
+   * @return 是否是最后一个数据包
+   */
+  bool sendpacket(int seq_number, int start_byte);
+
+  /**
+   * 重传指定索引的数据段
+   * @param index_number 数据段索引
+   */
+  void retransmitSegment(int index_number);
+
+  /**
+   * 检测到丢包时进入恢复阶段，每个恢复周期只通知拥塞控制器一次
+   */
+  void onLossDetected();
+
+  /**
+   * 根据 SACK 记分板重传被判定丢失的空洞
+   */
+  void retransmitLostSegments();
+
+  /**
+   * 可以按丢包重传的最大数据段下标。开启 FEC 时，空洞所在分组的校验段
+   * 已经发出的，要等分组之后又有 DUP_THRESH 个数据段被 SACK，
+   * 才认为接收方无法自行恢复
+   */
+  int lossDetectionLimit() const;
+
+  /**
+   * 分组的最后一个新数据段发出后，计算并发送该分组的校验段
+   * @param last_index 分组最后一个数据段的下标
+   * @param fin 该数据段是否是文件的最后一个数据段
+   */
+  void sendParity(int last_index, bool fin);
+
+  /**
+   * 每个分组的校验段数量：至少一个，按测得的丢包率增加
+   */
+  int fecParityCount() const;
+
+  /**
+   * 发送字节流中指定偏移处的数据：文件映射区或压缩流
+   */
+  const char *streamData(int offset);
+
+  /**
+   * 从文件映射区取出数据并发送
+   * @param fin_flag 是否是最后一个数据段
+   * @param start_byte 起始字节
+   * @param end_byte 结束字节
+   * @param timestamp 发送时间（纳秒），写入数据段头部
+   */
+  void readFileAndSend(bool fin_flag, int start_byte, int end_byte,
+                       int64_t timestamp);
+
+  /**
+   * 发送数据段：头部按会话填写，校验和由载荷的 CRC 合并得到
+   * @param data_segment 待发送的数据段对象
+   * @param payload_crc 载荷的 CRC32C
+   */
+  void sendDataSegment(DataSegment *data_segment, uint32_t payload_crc);
+
+  /**
+   * 结束会话并输出统计信息
+   */
+  void finish();
+};
+}  // namespace safe_udp
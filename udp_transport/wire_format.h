@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+
+namespace safe_udp {
+/**
+ * 数据段头部的线上格式，多字节字段都是网络字节序（大端）：
+ *   0  版本（1 字节）         1  标志（1 字节，ACK / FIN / SYN）
+ *   2  载荷长度（2 字节）     4  连接 ID（4 字节）
+ *   8  序列号（4 字节，无符号） 12 确认号（4 字节）
+ *   16 时间戳（8 字节）       24 CRC32C（4 字节），覆盖前 24 字节和整个载荷
+ * 各字段的偏移只在这里定义，序列化（DataSegment）和解析（SegmentView）都引用这些常量。
+ * 数据报长度总是 HEADER_LENGTH + 载荷长度，不做填充。
+ * 连接 ID 由服务器在握手时分配，服务器按它而不是客户端地址查找会话。
+ */
+constexpr uint8_t WIRE_VERSION = 2;
+constexpr uint8_t WIRE_FLAG_ACK = 0x01;
+constexpr uint8_t WIRE_FLAG_FIN = 0x02;
+/* 握手：服务器接受请求的数据段（SessionAccept） */
+constexpr uint8_t WIRE_FLAG_SYN = 0x04;
+
+constexpr int VERSION_OFFSET = 0;
+constexpr int FLAGS_OFFSET = VERSION_OFFSET + 1;
+constexpr int LENGTH_OFFSET = FLAGS_OFFSET + 1;
+constexpr int CONNECTION_ID_OFFSET = LENGTH_OFFSET + 2;
+constexpr int SEQ_OFFSET = CONNECTION_ID_OFFSET + 4;
+constexpr int ACK_OFFSET = SEQ_OFFSET + 4;
+constexpr int TIMESTAMP_OFFSET = ACK_OFFSET + 4;
+/* 头部中 CRC32C 校验和的偏移，校验和覆盖它之前的头部字段和整个载荷 */
+constexpr int CHECKSUM_OFFSET = TIMESTAMP_OFFSET + 8;
+/* 定义协议头部长度为28字节 */
+constexpr int HEADER_LENGTH = CHECKSUM_OFFSET + 4;
+
+static_assert(HEADER_LENGTH == 28, "the wire header is 28 bytes");
+static_assert(CONNECTION_ID_OFFSET % 4 == 0 && SEQ_OFFSET % 4 == 0 &&
+                  TIMESTAMP_OFFSET % 4 == 0,
+              "32-bit fields stay 4-byte aligned in the datagram");
+
+/** 按网络字节序写入多字节整数，与主机字节序无关 */
+inline void StoreBigEndian16(void *buffer, uint16_t value) {
+  unsigned char *p = static_cast<unsigned char *>(buffer);
+  p[0] = value >> 8;
+  p[1] = value;
+}
+
+inline void StoreBigEndian32(void *buffer, uint32_t value) {
+  unsigned char *p = static_cast<unsigned char *>(buffer);
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+inline void StoreBigEndian64(void *buffer, uint64_t value) {
+  StoreBigEndian32(buffer, value >> 32);
+  StoreBigEndian32(static_cast<unsigned char *>(buffer) + 4, value);
+}
+
+/** 按网络字节序读出多字节整数 */
+inline uint16_t LoadBigEndian16(const void *buffer) {
+  const unsigned char *p = static_cast<const unsigned char *>(buffer);
+  return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+inline uint32_t LoadBigEndian32(const void *buffer) {
+  const unsigned char *p = static_cast<const unsigned char *>(buffer);
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         p[3];
+}
+
+inline uint64_t LoadBigEndian64(const void *buffer) {
+  return (uint64_t)LoadBigEndian32(buffer) << 32 |
+         LoadBigEndian32(static_cast<const unsigned char *>(buffer) + 4);
+}
+}  // namespace safe_udp